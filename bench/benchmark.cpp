@@ -0,0 +1,203 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <thread>
+
+#include <nlohmann/json.hpp>
+#include <sqlite3.h>
+
+#include "../src/utils/utils.h"
+
+namespace
+{
+std::string GetCompiler()
+{
+#if defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#else
+    return "unknown";
+#endif
+}
+
+std::string GetPlatform()
+{
+#if defined(_WIN32)
+    return "windows";
+#elif defined(__linux__)
+    return "linux";
+#else
+    return "unknown";
+#endif
+}
+} // namespace
+
+namespace app::Bench
+{
+BenchmarkRunner::BenchmarkRunner(BenchmarkOptions options)
+    : mOptions(std::move(options))
+    , mBenchmarks()
+{
+}
+
+void BenchmarkRunner::Add(Benchmark benchmark)
+{
+    mBenchmarks.push_back(std::move(benchmark));
+}
+
+bool BenchmarkRunner::Run()
+{
+    std::vector<BenchmarkResult> results;
+    std::printf("%-40s %12s %12s %12s %12s\n", "benchmark", "min ns/op", "median", "mean", "max");
+
+    for (const auto& benchmark : mBenchmarks) {
+        if (!mOptions.filter.empty() && benchmark.name.find(mOptions.filter) == std::string::npos) {
+            continue;
+        }
+
+        results.push_back(Measure(benchmark));
+        const auto& result = results.back();
+        std::printf("%-40s %12.1f %12.1f %12.1f %12.1f\n",
+            result.name.c_str(),
+            result.minNanoseconds,
+            result.medianNanoseconds,
+            result.meanNanoseconds,
+            result.maxNanoseconds);
+        std::fflush(stdout);
+    }
+
+    return mOptions.output.empty() || WriteJson(results);
+}
+
+bool BenchmarkRunner::ParseArguments(int argc, char** argv, BenchmarkOptions& options)
+{
+    for (int i = 1; i < argc; i++) {
+        const char* argument = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", argument);
+            return false;
+        }
+
+        const char* value = argv[++i];
+        if (std::strcmp(argument, "--filter") == 0) {
+            options.filter = value;
+        } else if (std::strcmp(argument, "--label") == 0) {
+            options.label = value;
+        } else if (std::strcmp(argument, "--output") == 0) {
+            options.output = std::filesystem::u8path(value);
+        } else if (std::strcmp(argument, "--repetitions") == 0) {
+            options.repetitions = std::max(1, std::atoi(value));
+        } else {
+            std::fprintf(stderr, "Unknown argument %s\n", argument);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BenchmarkResult BenchmarkRunner::Measure(const Benchmark& benchmark) const
+{
+    BenchmarkResult result{ benchmark.name, benchmark.iterations, {}, 0.0, 0.0, 0.0, 0.0, 0 };
+    result.samples.reserve(static_cast<std::size_t>(mOptions.repetitions));
+
+    // the first pass only warms caches and is not reported
+    for (int repetition = -1; repetition < mOptions.repetitions; repetition++) {
+        if (benchmark.setup) {
+            benchmark.setup();
+        }
+
+        std::size_t checksum = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < benchmark.iterations; i++) {
+            checksum += benchmark.run(i);
+        }
+        const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+
+        if (repetition >= 0) {
+            result.samples.push_back(elapsed.count() / static_cast<double>(benchmark.iterations));
+            result.checksum += checksum;
+        }
+    }
+
+    std::vector<double> sorted = result.samples;
+    std::sort(sorted.begin(), sorted.end());
+    result.minNanoseconds = sorted.front();
+    result.maxNanoseconds = sorted.back();
+    result.medianNanoseconds = sorted.size() % 2 == 1
+                                   ? sorted[sorted.size() / 2]
+                                   : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2.0;
+    result.meanNanoseconds = std::accumulate(sorted.begin(), sorted.end(), 0.0) / static_cast<double>(sorted.size());
+    return result;
+}
+
+bool BenchmarkRunner::WriteJson(const std::vector<BenchmarkResult>& results) const
+{
+    nlohmann::ordered_json benchmarks = nlohmann::ordered_json::array();
+    for (const auto& result : results) {
+        benchmarks.push_back({
+            { "name", result.name },
+            { "iterations", result.iterations },
+            { "repetitions", result.samples.size() },
+            { "min_ns", result.minNanoseconds },
+            { "median_ns", result.medianNanoseconds },
+            { "mean_ns", result.meanNanoseconds },
+            { "max_ns", result.maxNanoseconds },
+            { "samples_ns", result.samples },
+            { "checksum", result.checksum },
+        });
+    }
+
+    const nlohmann::ordered_json document{
+        { "label", mOptions.label },
+        { "timestamp", Utils::ToISODateTime(Utils::UnixTimestamp()) },
+        { "platform", GetPlatform() },
+        { "compiler", GetCompiler() },
+#ifdef NDEBUG
+        { "build", "release" },
+#else
+        { "build", "debug" },
+#endif
+        { "sqlite", sqlite3_libversion() },
+        { "hardware_threads", std::thread::hardware_concurrency() },
+        { "benchmarks", benchmarks },
+    };
+
+    std::ofstream output(mOptions.output, std::ios::out | std::ios::trunc);
+    output << document.dump(2) << '\n';
+    if (!output) {
+        std::fprintf(stderr, "Failed to write results to %s\n", mOptions.output.u8string().c_str());
+        return false;
+    }
+
+    std::printf("Wrote results to %s\n", mOptions.output.u8string().c_str());
+    return true;
+}
+} // namespace app::Bench
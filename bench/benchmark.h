@@ -0,0 +1,86 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace app::Bench
+{
+struct Benchmark {
+    std::string name;
+    // operations timed per repetition, results are reported per operation
+    std::size_t iterations;
+    // runs before every repetition and is not timed
+    std::function<void()> setup;
+    // performs operation i and returns a value folded into the checksum, so the work cannot be optimized away
+    std::function<std::size_t(std::size_t i)> run;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    std::size_t iterations;
+    std::vector<double> samples;
+    double minNanoseconds;
+    double medianNanoseconds;
+    double meanNanoseconds;
+    double maxNanoseconds;
+    std::size_t checksum;
+};
+
+struct BenchmarkOptions {
+    std::string filter;
+    std::string label;
+    std::filesystem::path output;
+    int repetitions = 10;
+};
+
+// Runs every benchmark once untimed to warm caches, then the configured number of timed repetitions, and reports
+// the spread of the per-operation times. Results are printed as a table and optionally written as JSON, so runs
+// of different releases can be compared.
+class BenchmarkRunner final
+{
+public:
+    explicit BenchmarkRunner(BenchmarkOptions options);
+    BenchmarkRunner(const BenchmarkRunner&) = delete;
+    ~BenchmarkRunner() = default;
+
+    BenchmarkRunner& operator=(const BenchmarkRunner&) = delete;
+
+    void Add(Benchmark benchmark);
+
+    // Returns false when the results could not be written
+    bool Run();
+
+    // Parses --filter, --label, --output and --repetitions, returns false on unknown or incomplete arguments
+    static bool ParseArguments(int argc, char** argv, BenchmarkOptions& options);
+
+private:
+    BenchmarkResult Measure(const Benchmark& benchmark) const;
+    bool WriteJson(const std::vector<BenchmarkResult>& results) const;
+
+    BenchmarkOptions mOptions;
+    std::vector<Benchmark> mBenchmarks;
+};
+} // namespace app::Bench
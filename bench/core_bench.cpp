@@ -0,0 +1,283 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+// Benchmarks of the non-GUI subsystems that run at startup and shutdown: database migration, background data
+// migration, persistence restore and save, translation lookup, configuration load and save and timestamp formatting.
+//
+// Usage: taskies_bench [--filter <name part>] [--repetitions <n>] [--output <results.json>] [--label <release>]
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/sinks/null_sink.h>
+
+#include "benchmark.h"
+
+#include "../src/core/configuration.h"
+#include "../src/core/data_migration.h"
+#include "../src/core/database.h"
+#include "../src/core/database_migration.h"
+#include "../src/core/local_time.h"
+#include "../src/core/persistent_object_repository.h"
+#include "../src/ui/translator.h"
+#include "../src/utils/utils.h"
+
+namespace
+{
+constexpr int BackfillRowCount = 100000;
+constexpr int PersistentKeyCount = 1000;
+constexpr int FlushedKeyCount = 50;
+constexpr int TranslationKeyCount = 2000;
+// 2023-03-01 00:00:00 UTC
+constexpr std::int64_t BaseTimestamp = 1677628800;
+
+const std::string ConfigContents = "[general]\n"
+                                   "lang=\"en-US\"\n"
+                                   "\n"
+                                   "[database]\n"
+                                   "databasePath=\"\"\n"
+                                   "journalMode=\"WAL\"\n"
+                                   "synchronous=\"NORMAL\"\n"
+                                   "backupIntervalHours=24\n";
+
+void RemoveDatabase(const std::filesystem::path& databaseFile)
+{
+    std::error_code ec;
+    for (const char* suffix : { "", "-wal", "-shm", "-journal" }) {
+        std::filesystem::path file = databaseFile;
+        file += suffix;
+        std::filesystem::remove(file, ec);
+    }
+}
+
+std::shared_ptr<app::Core::Database> OpenMigrated(const std::filesystem::path& databaseFile,
+    std::shared_ptr<spdlog::logger> logger)
+{
+    auto database = std::make_shared<app::Core::Database>(logger);
+    if (!database->Open(databaseFile) || !app::Core::DatabaseMigration(database, logger).Migrate()) {
+        std::fprintf(stderr, "Failed to create %s\n", databaseFile.u8string().c_str());
+        std::exit(1);
+    }
+    return database;
+}
+
+void AddMigrationBenchmarks(app::Bench::BenchmarkRunner& runner,
+    const std::filesystem::path& directory,
+    std::shared_ptr<spdlog::logger> logger)
+{
+    auto freshDatabase = std::make_shared<std::shared_ptr<app::Core::Database>>();
+    const auto freshFile = directory / "fresh.db";
+    runner.Add({ "migration/fresh_database",
+        1,
+        [=]() {
+            freshDatabase->reset();
+            RemoveDatabase(freshFile);
+            *freshDatabase = std::make_shared<app::Core::Database>(logger);
+            (*freshDatabase)->Open(freshFile);
+        },
+        [=](std::size_t) { return app::Core::DatabaseMigration(*freshDatabase, logger).Migrate() ? 1u : 0u; } });
+
+    auto currentDatabase = OpenMigrated(directory / "current.db", logger);
+    runner.Add({ "migration/up_to_date_database", 100, nullptr, [=](std::size_t) {
+                    return app::Core::DatabaseMigration(currentDatabase, logger).Migrate() ? 1u : 0u;
+                } });
+}
+
+// Time entries written before their day was stored, which the background data migrations fill in
+void AddDataMigrationBenchmarks(app::Bench::BenchmarkRunner& runner,
+    const std::filesystem::path& directory,
+    std::shared_ptr<spdlog::logger> logger)
+{
+    const auto databaseFile = directory / "backfill.db";
+    auto database = OpenMigrated(databaseFile, logger);
+    database->Execute("INSERT INTO employers (name) VALUES ('Employer');"
+                      "INSERT INTO tasks (employer_id, name) VALUES (1, 'Task');");
+    database->Execute(fmt::format("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < {0}) "
+                                  "INSERT INTO time_entries (task_id, employer_id, start_time, duration) "
+                                  "SELECT 1, 1, {1} + i * 1800, 1500 FROM n;",
+        BackfillRowCount,
+        BaseTimestamp));
+
+    runner.Add({ "data_migration/backfill_100000_rows",
+        1,
+        [=]() {
+            database->Execute("UPDATE time_entries SET day = NULL;"
+                              "DELETE FROM migration_history WHERE progress IS NOT NULL;");
+        },
+        [=](std::size_t) {
+            // batches pause between each other to leave the write lock to the UI, that is part of the cost
+            app::Core::DataMigrationRunner migrations(databaseFile, app::Core::DatabasePragmas(), logger);
+            migrations.Start();
+            while (migrations.IsRunning()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            auto stmt = database->Prepare("SELECT count(*) FROM time_entries WHERE day IS NOT NULL;");
+            return stmt.Step() ? stmt.Column<std::size_t>(0) : 0u;
+        } });
+}
+
+void AddPersistenceBenchmarks(app::Bench::BenchmarkRunner& runner,
+    const std::filesystem::path& directory,
+    std::shared_ptr<spdlog::logger> logger)
+{
+    auto database = OpenMigrated(directory / "persistence.db", logger);
+
+    // the shape of the keys wxPersistenceManager saves: kind/name/property
+    app::Core::PersistentValues values;
+    for (int i = 0; i < PersistentKeyCount; i++) {
+        const std::string key = fmt::format("Window/frame{0}/{1}", i / 8, i % 8);
+        if (i % 4 == 0) {
+            values.emplace_back(key, fmt::format("column{0},column{1}", i, i + 1));
+        } else if (i % 4 == 1) {
+            values.emplace_back(key, i % 2 == 0);
+        } else {
+            values.emplace_back(key, static_cast<long>(i * 16));
+        }
+    }
+    app::Core::PersistentObjectRepository(database, logger).Write(values);
+
+    runner.Add({ "persistence/restore_1000_values", 100, nullptr, [=](std::size_t) {
+                    app::Core::PersistentValues restored;
+                    restored.reserve(PersistentKeyCount);
+                    app::Core::PersistentObjectRepository(database, logger).ReadAll(restored);
+                    return restored.size();
+                } });
+
+    auto flushed = std::make_shared<app::Core::PersistentValues>(values.begin(), values.begin() + FlushedKeyCount);
+    runner.Add({ "persistence/save_50_values", 100, nullptr, [=](std::size_t i) {
+                    for (auto& [key, value] : *flushed) {
+                        value = static_cast<long>(i);
+                    }
+                    return app::Core::PersistentObjectRepository(database, logger).Write(*flushed) ? 1u : 0u;
+                } });
+}
+
+void AddTranslationBenchmarks(app::Bench::BenchmarkRunner& runner, const std::filesystem::path& directory)
+{
+    const auto languagesDirectory = directory / "lang";
+    std::filesystem::create_directories(languagesDirectory);
+
+    auto keys = std::make_shared<std::vector<std::string>>();
+    {
+        std::ofstream file(languagesDirectory / "en-US.json", std::ios::out | std::ios::trunc);
+        file << "{\n";
+        for (int i = 0; i < TranslationKeyCount; i++) {
+            keys->push_back(fmt::format("MainFrame.Menu.Item{0:04d}", i));
+            file << fmt::format("  \"{0}\": \"Menu item {1}\"{2}\n",
+                keys->back(),
+                i,
+                i + 1 < TranslationKeyCount ? "," : "");
+        }
+        file << "}\n";
+    }
+
+    auto& translator = app::UI::Translator::GetInstance();
+    translator.Load("en-US", languagesDirectory);
+
+    runner.Add({ "translation/lookup", 1000000, nullptr, [=](std::size_t i) {
+                    return app::UI::Translator::GetInstance().Translate((*keys)[i % keys->size()]).size();
+                } });
+    runner.Add({ "translation/lookup_missing_key", 1000000, nullptr, [](std::size_t) {
+                    return app::UI::Translator::GetInstance().Translate("MainFrame.Menu.Missing").size();
+                } });
+}
+
+void AddConfigurationBenchmarks(app::Bench::BenchmarkRunner& runner,
+    const std::filesystem::path& directory,
+    std::shared_ptr<spdlog::logger> logger)
+{
+    const auto configFile = directory / "taskies.toml";
+    std::ofstream(configFile, std::ios::out | std::ios::trunc) << ConfigContents;
+
+    runner.Add({ "configuration/load", 1000, nullptr, [=](std::size_t) {
+                    app::Core::Configuration configuration(configFile, logger);
+                    return configuration.GetUserInterfaceLanguage().size();
+                } });
+
+    auto configuration = std::make_shared<app::Core::Configuration>(configFile, logger);
+    runner.Add({ "configuration/save", 1000, nullptr, [=](std::size_t) {
+                    configuration->Save();
+                    return 1u;
+                } });
+}
+
+void AddTimestampBenchmarks(app::Bench::BenchmarkRunner& runner)
+{
+    runner.Add({ "timestamp/iso_date_time", 200000, nullptr, [](std::size_t i) {
+                    return app::Utils::ToISODateTime(BaseTimestamp + static_cast<std::int64_t>(i) * 61).size();
+                } });
+
+    // the path exports take: a cached UTC offset and civil date arithmetic
+    auto converter = std::make_shared<app::Core::LocalTimeConverter>();
+    runner.Add({ "timestamp/local_civil_time", 1000000, nullptr, [=](std::size_t i) {
+                    const auto civil = app::Core::ToCivilTime(
+                        converter->ToLocal(BaseTimestamp + static_cast<std::int64_t>(i) * 61));
+                    char buffer[32];
+                    auto end = fmt::format_to(buffer,
+                        "{0:04d}-{1:02d}-{2:02d} {3:02d}:{4:02d}:{5:02d}",
+                        civil.year,
+                        civil.month,
+                        civil.day,
+                        civil.hour,
+                        civil.minute,
+                        civil.second);
+                    return static_cast<std::size_t>(end - buffer);
+                } });
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    app::Bench::BenchmarkOptions options;
+    if (!app::Bench::BenchmarkRunner::ParseArguments(argc, argv, options)) {
+        return 2;
+    }
+
+    auto logger = std::make_shared<spdlog::logger>("bench", std::make_shared<spdlog::sinks::null_sink_st>());
+
+    const auto directory = std::filesystem::temp_directory_path() / "taskies_bench";
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    std::filesystem::create_directories(directory);
+
+    int status = 0;
+    {
+        app::Bench::BenchmarkRunner runner(options);
+        AddMigrationBenchmarks(runner, directory, logger);
+        AddDataMigrationBenchmarks(runner, directory, logger);
+        AddPersistenceBenchmarks(runner, directory, logger);
+        AddTranslationBenchmarks(runner, directory);
+        AddConfigurationBenchmarks(runner, directory, logger);
+        AddTimestampBenchmarks(runner);
+
+        status = runner.Run() ? 0 : 1;
+    }
+
+    std::filesystem::remove_all(directory, ec);
+    return status;
+}
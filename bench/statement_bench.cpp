@@ -0,0 +1,158 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+// Compares the hand-written prepare/bind/step/finalize pattern against the cached Core::Statement wrapper
+// on the persistent_objects lookups that run during window state restore.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/null_sink.h>
+
+#include "../src/core/database.h"
+
+namespace
+{
+const std::string SelectQuery = "SELECT value FROM persistent_objects WHERE key = ?;";
+const std::string InsertQuery = "INSERT OR REPLACE INTO persistent_objects(key, value) VALUES(?, ?);";
+
+constexpr int KeyCount = 1000;
+constexpr int Iterations = 200000;
+
+template<typename Fn>
+void Run(const char* name, Fn&& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::size_t checksum = 0;
+    for (int i = 0; i < Iterations; i++) {
+        checksum += fn(i);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%-32s %10.1f ns/op (checksum %zu)\n", name, elapsed / Iterations, checksum);
+}
+
+std::size_t HandWrittenSelect(sqlite3* db, const std::string& key)
+{
+    sqlite3_stmt* stmt = nullptr;
+    int rc = sqlite3_prepare_v2(db, SelectQuery.c_str(), -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        const char* err = sqlite3_errmsg(db);
+        spdlog::error("Failed to prepare statement {0}", std::string(err));
+        sqlite3_finalize(stmt);
+        return 0;
+    }
+
+    rc = sqlite3_bind_text(stmt, 1, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+    if (rc != SQLITE_OK) {
+        const char* err = sqlite3_errmsg(db);
+        spdlog::error("Failed to bind {0}", std::string(err));
+        sqlite3_finalize(stmt);
+        return 0;
+    }
+
+    std::size_t size = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* res = sqlite3_column_text(stmt, 0);
+        std::string value(reinterpret_cast<const char*>(res), sqlite3_column_bytes(stmt, 0));
+        size = value.size();
+    }
+
+    sqlite3_finalize(stmt);
+    return size;
+}
+
+std::size_t HandWrittenInsert(sqlite3* db, const std::string& key, const std::string& value)
+{
+    sqlite3_stmt* stmt = nullptr;
+    int rc = sqlite3_prepare_v2(db, InsertQuery.c_str(), -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return 0;
+    }
+
+    sqlite3_bind_text(stmt, 1, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, value.c_str(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE ? 1 : 0;
+}
+
+std::size_t WrappedSelect(app::Core::Database& database, const std::string& key)
+{
+    auto stmt = database.Prepare(SelectQuery);
+    if (!stmt || !stmt.Bind(key) || !stmt.Step()) {
+        return 0;
+    }
+
+    return stmt.Column<std::string_view>(0).size();
+}
+
+std::size_t WrappedInsert(app::Core::Database& database, const std::string& key, const std::string& value)
+{
+    auto stmt = database.Prepare(InsertQuery);
+    if (!stmt || !stmt.Bind(key, value)) {
+        return 0;
+    }
+
+    return stmt.Execute() ? 1 : 0;
+}
+} // namespace
+
+int main()
+{
+    auto logger = std::make_shared<spdlog::logger>("bench", std::make_shared<spdlog::sinks::null_sink_st>());
+
+    app::Core::Database database(logger);
+    if (!database.Open(":memory:")) {
+        return 1;
+    }
+
+    database.Execute("CREATE TABLE persistent_objects(key TEXT PRIMARY KEY, value TEXT NOT NULL, "
+                     "UNIQUE (key) ON CONFLICT REPLACE);");
+
+    std::vector<std::string> keys;
+    keys.reserve(KeyCount);
+    for (int i = 0; i < KeyCount; i++) {
+        keys.push_back("wxTopLevelWindow/mainfrm/property" + std::to_string(i));
+    }
+    const std::string value = "1280";
+
+    database.Execute("BEGIN TRANSACTION");
+    for (const auto& key : keys) {
+        WrappedInsert(database, key, value);
+    }
+    database.Execute("COMMIT");
+
+    sqlite3* db = database.Handle();
+
+    Run("select (hand-written)", [&](int i) { return HandWrittenSelect(db, keys[i % KeyCount]); });
+    Run("select (cached Statement)", [&](int i) { return WrappedSelect(database, keys[i % KeyCount]); });
+
+    database.Execute("BEGIN TRANSACTION");
+    Run("insert (hand-written)", [&](int i) { return HandWrittenInsert(db, keys[i % KeyCount], value); });
+    Run("insert (cached Statement)", [&](int i) { return WrappedInsert(database, keys[i % KeyCount], value); });
+    database.Execute("COMMIT");
+
+    return 0;
+}
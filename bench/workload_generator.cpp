@@ -0,0 +1,430 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "workload_generator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "../src/core/database.h"
+#include "../src/core/database_migration.h"
+#include "../src/core/local_time.h"
+#include "../src/core/persistent_object_repository.h"
+#include "../src/core/time_entry_repository.h"
+
+namespace app::Bench
+{
+namespace
+{
+std::string FormatDay(std::int64_t day)
+{
+    const Core::CivilTime civil = Core::ToCivilTime(day * 86400);
+    return fmt::format("{0:04d}-{1:02d}-{2:02d}", civil.year, civil.month, civil.day);
+}
+} // namespace
+
+const std::vector<std::string> WorkloadGenerator::Vocabulary = { "meeting", "review", "fix", "bug", "call",
+    "client", "report", "update", "deploy", "release", "test", "tests", "build", "design", "planning", "sprint",
+    "standup", "email", "emails", "invoice", "support", "ticket", "database", "migration", "query", "index",
+    "performance", "refactor", "cleanup", "docs", "documentation", "onboarding", "interview", "training", "research",
+    "prototype", "feature", "api", "backend", "frontend", "ui", "layout", "dialog", "settings", "export", "import",
+    "backup", "restore", "sync", "server", "config", "logging", "crash", "investigate", "customer", "demo",
+    "presentation", "budget", "estimate", "proposal", "contract", "pairing", "handover", "retro", "roadmap",
+    "security", "audit", "upgrade", "dependency", "packaging", "installer", "windows", "linux", "translation",
+    "localization", "accessibility", "followup", "sql", "schema", "cache", "timer", "report", "weekly", "monthly",
+    "quarterly", "yearly", "notes", "draft", "final", "the", "and", "for", "with", "on", "of", "to", "a", "new",
+    "old", "team", "project", "phase", "milestone", "hotfix", "patch", "branch", "merge", "pipeline", "ci" };
+const std::string WorkloadGenerator::InsertEmployerQuery = "INSERT INTO employers (name) VALUES (?);";
+const std::string WorkloadGenerator::InsertTaskQuery =
+    "INSERT INTO tasks (employer_id, name, description, is_active) VALUES (?, ?, ?, ?);";
+
+WorkloadRandom::WorkloadRandom(std::uint64_t seed)
+    : mState(seed)
+{
+}
+
+std::uint64_t WorkloadRandom::Next()
+{
+    // splitmix64
+    std::uint64_t z = (mState += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+double WorkloadRandom::Uniform()
+{
+    return static_cast<double>(Next() >> 11) * 0x1.0p-53;
+}
+
+std::int64_t WorkloadRandom::Between(std::int64_t low, std::int64_t high)
+{
+    return low + static_cast<std::int64_t>(Next() % static_cast<std::uint64_t>(high - low + 1));
+}
+
+bool WorkloadRandom::Chance(double probability)
+{
+    return Uniform() < probability;
+}
+
+double WorkloadRandom::Normal(double mean, double deviation)
+{
+    // Box-Muller, 1 - Uniform() keeps the logarithm finite
+    const double radius = std::sqrt(-2.0 * std::log(1.0 - Uniform()));
+    return mean + deviation * radius * std::cos(2.0 * 3.14159265358979323846 * Uniform());
+}
+
+double WorkloadRandom::Exponential(double mean)
+{
+    return -mean * std::log(1.0 - Uniform());
+}
+
+std::int64_t WorkloadRandom::Poisson(double mean)
+{
+    if (mean >= 30.0) {
+        return std::max<std::int64_t>(0, std::llround(Normal(mean, std::sqrt(mean))));
+    }
+
+    const double limit = std::exp(-mean);
+    std::int64_t count = 0;
+    double product = Uniform();
+    while (product > limit) {
+        count++;
+        product *= Uniform();
+    }
+    return count;
+}
+
+ZipfTable::ZipfTable(std::size_t count, double exponent)
+    : mCumulative()
+{
+    mCumulative.reserve(count);
+    double total = 0.0;
+    for (std::size_t i = 0; i < count; i++) {
+        total += 1.0 / std::pow(static_cast<double>(i + 1), exponent);
+        mCumulative.push_back(total);
+    }
+}
+
+std::size_t ZipfTable::Pick(WorkloadRandom& random) const
+{
+    const double target = random.Uniform() * mCumulative.back();
+    const auto found = std::upper_bound(mCumulative.begin(), mCumulative.end(), target);
+    return std::min(static_cast<std::size_t>(found - mCumulative.begin()), mCumulative.size() - 1);
+}
+
+WorkloadGenerator::WorkloadGenerator(WorkloadOptions options, std::shared_ptr<spdlog::logger> logger)
+    : mOptions(std::move(options))
+    , pLogger(logger)
+    , mRandom(mOptions.seed)
+    , mWords(Vocabulary.size(), 1.0)
+{
+}
+
+bool WorkloadGenerator::Generate(const std::filesystem::path& databaseFile)
+{
+    if (mOptions.employers < 1 || mOptions.tasks < mOptions.employers || mOptions.years < 1) {
+        pLogger->error("Need at least one employer, one task per employer and one year of history");
+        return false;
+    }
+
+    std::error_code ec;
+    if (std::filesystem::exists(databaseFile, ec)) {
+        pLogger->error("{0} already exists", databaseFile.u8string());
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto database = std::make_shared<Core::Database>(pLogger);
+    if (!database->Open(databaseFile) || !Core::DatabaseMigration(database, pLogger).Migrate()) {
+        return false;
+    }
+
+    std::vector<std::int64_t> employerIds;
+    std::vector<std::vector<Task>> tasks;
+    std::int64_t entryCount = 0;
+    if (!InsertEmployers(*database, employerIds) || !InsertTasks(*database, employerIds, tasks) ||
+        !InsertTimeEntries(database, tasks, entryCount) || !InsertPersistentObjects(database)) {
+        return false;
+    }
+
+    database->Close();
+    pLogger->info("Generated {0} with {1} employers, {2} tasks, {3} time entries and {4} persistent values "
+                  "({5} MiB) in {6}s",
+        databaseFile.u8string(),
+        employerIds.size(),
+        mOptions.tasks,
+        entryCount,
+        mOptions.persistentKeys,
+        std::filesystem::file_size(databaseFile, ec) / (1024 * 1024),
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+bool WorkloadGenerator::InsertEmployers(Core::Database& database, std::vector<std::int64_t>& employerIds)
+{
+    Core::Transaction transaction(database);
+    if (!transaction.IsActive()) {
+        return false;
+    }
+
+    for (int i = 0; i < mOptions.employers; i++) {
+        auto stmt = database.Prepare(InsertEmployerQuery);
+        if (!stmt || !stmt.Bind(fmt::format("Employer {0:03d}", i + 1)) || !stmt.Execute()) {
+            pLogger->error("Failed to insert employer {0}", stmt.ErrorMessage());
+            return false;
+        }
+        employerIds.push_back(sqlite3_last_insert_rowid(database.Handle()));
+    }
+
+    return transaction.Commit();
+}
+
+bool WorkloadGenerator::InsertTasks(Core::Database& database,
+    const std::vector<std::int64_t>& employerIds,
+    std::vector<std::vector<Task>>& tasks)
+{
+    Core::Transaction transaction(database);
+    if (!transaction.IsActive()) {
+        return false;
+    }
+
+    // the first employers get most of the tasks, every employer gets at least one
+    const ZipfTable employers(employerIds.size(), 1.0);
+    tasks.assign(employerIds.size(), {});
+    for (int i = 0; i < mOptions.tasks; i++) {
+        const std::size_t employer =
+            static_cast<std::size_t>(i) < employerIds.size() ? static_cast<std::size_t>(i) : employers.Pick(mRandom);
+        const std::string name = fmt::format("TKS-{0} {1}", i + 1, MakeDescription());
+        const std::string description = mRandom.Chance(0.5) ? MakeDescription() : std::string();
+        const bool isActive = !mRandom.Chance(0.3);
+
+        auto stmt = database.Prepare(InsertTaskQuery);
+        if (!stmt || !stmt.Bind(employerIds[employer], name, description, isActive) || !stmt.Execute()) {
+            pLogger->error("Failed to insert task {0}", stmt.ErrorMessage());
+            return false;
+        }
+        tasks[employer].push_back(Task{ sqlite3_last_insert_rowid(database.Handle()), employerIds[employer] });
+    }
+
+    return transaction.Commit();
+}
+
+bool WorkloadGenerator::InsertTimeEntries(std::shared_ptr<Core::Database> database,
+    const std::vector<std::vector<Task>>& tasks,
+    std::int64_t& entryCount)
+{
+    std::int64_t endDay = 0;
+    if (!GetEndDay(endDay)) {
+        return false;
+    }
+
+    const Core::CivilTime end = Core::ToCivilTime(endDay * 86400);
+    const std::int64_t firstDay = Core::DaysFromCivil(end.year - mOptions.years, end.month, end.day) + 1;
+    const std::vector<std::int64_t> workingDays = PickWorkingDays(firstDay, endDay);
+    if (workingDays.empty()) {
+        return true;
+    }
+
+    const double entriesPerDay = mOptions.entries > 0
+                                     ? static_cast<double>(mOptions.entries) / static_cast<double>(workingDays.size())
+                                     : mOptions.entriesPerDay;
+    pLogger->info("Generating {0} working days from {1} to {2} with {3:.1f} entries per day",
+        workingDays.size(),
+        FormatDay(firstDay),
+        FormatDay(endDay),
+        entriesPerDay);
+
+    const ZipfTable employerPopularity(tasks.size(), 1.2);
+    std::vector<ZipfTable> taskPopularity;
+    for (const auto& employerTasks : tasks) {
+        taskPopularity.emplace_back(employerTasks.size(), 1.1);
+    }
+
+    Core::TimeEntryRepository repository(database, pLogger);
+    Core::LocalTimeConverter converter;
+    std::vector<Core::TimeEntry> batch;
+    batch.reserve(BatchSize);
+    std::vector<double> weights;
+
+    for (const std::int64_t day : workingDays) {
+        const std::int64_t count = mRandom.Poisson(entriesPerDay);
+        if (count == 0) {
+            continue;
+        }
+
+        // about eight hours of work split unevenly between the entries, with short breaks in between
+        const double workSeconds = std::clamp(mRandom.Normal(8.0 * 3600, 3600), 4.0 * 3600, 12.0 * 3600);
+        weights.clear();
+        double totalWeight = 0.0;
+        for (std::int64_t i = 0; i < count; i++) {
+            weights.push_back(mRandom.Exponential(1.0));
+            totalWeight += weights.back();
+        }
+
+        const std::size_t mainEmployer = employerPopularity.Pick(mRandom);
+        // popular tasks drift every quarter
+        const std::size_t drift = static_cast<std::size_t>((day - firstDay) / 91) * 7;
+        std::int64_t cursor = day * 86400 + mRandom.Between(8 * 60, 9 * 60 + 30) * 60;
+        const Task* previous = nullptr;
+
+        for (std::int64_t i = 0; i < count; i++) {
+            const std::size_t employer = mRandom.Chance(0.8) ? mainEmployer : employerPopularity.Pick(mRandom);
+            const auto& employerTasks = tasks[employer];
+            const Task* task = previous;
+            if (task == nullptr || task->employerId != employerTasks.front().employerId || !mRandom.Chance(0.3)) {
+                task = &employerTasks[(taskPopularity[employer].Pick(mRandom) + drift) % employerTasks.size()];
+            }
+            previous = task;
+
+            const std::int64_t duration = std::max<std::int64_t>(
+                1, std::llround(workSeconds * weights[static_cast<std::size_t>(i)] / totalWeight));
+            batch.push_back(Core::TimeEntry{ 0,
+                task->taskId,
+                task->employerId,
+                converter.FromLocal(cursor),
+                duration,
+                mRandom.Chance(0.1) ? std::string() : MakeDescription() });
+            cursor += duration + std::llround(mRandom.Exponential(std::min(300.0, workSeconds * 0.1 / count)));
+
+            if (batch.size() == BatchSize) {
+                if (!repository.BulkInsert(batch)) {
+                    return false;
+                }
+                entryCount += static_cast<std::int64_t>(batch.size());
+                batch.clear();
+
+                if (entryCount % 1000000 == 0) {
+                    pLogger->info("Inserted {0} time entries", entryCount);
+                }
+            }
+        }
+    }
+
+    if (!batch.empty() && !repository.BulkInsert(batch)) {
+        return false;
+    }
+    entryCount += static_cast<std::int64_t>(batch.size());
+    return true;
+}
+
+bool WorkloadGenerator::InsertPersistentObjects(std::shared_ptr<Core::Database> database)
+{
+    // the kinds and properties wxPersistenceManager saves for windows, splitters and list columns
+    static const std::vector<std::string> Kinds = { "Window", "Splitter", "ListCtrl", "Book", "Dialog" };
+    static const std::vector<std::string> Properties = { "x", "y", "w", "h", "Maximized", "Iconized", "Columns",
+        "Sash", "Selection", "SortColumn" };
+
+    Core::PersistentValues values;
+    values.reserve(static_cast<std::size_t>(mOptions.persistentKeys));
+    for (int i = 0; i < mOptions.persistentKeys; i++) {
+        const std::size_t property = static_cast<std::size_t>(i) % Properties.size();
+        std::string key = fmt::format("{0}/{1}{2}/{3}",
+            Kinds[static_cast<std::size_t>(i / 10) % Kinds.size()],
+            "frame",
+            i / 10,
+            Properties[property]);
+
+        if (Properties[property] == "Maximized" || Properties[property] == "Iconized") {
+            values.emplace_back(std::move(key), mRandom.Chance(0.2));
+        } else if (Properties[property] == "Columns") {
+            values.emplace_back(std::move(key),
+                fmt::format("{0},{1},{2},{3}",
+                    mRandom.Between(40, 400),
+                    mRandom.Between(40, 400),
+                    mRandom.Between(40, 400),
+                    mRandom.Between(40, 400)));
+        } else {
+            values.emplace_back(std::move(key), static_cast<long>(mRandom.Between(0, 1920)));
+        }
+    }
+
+    return Core::PersistentObjectRepository(database, pLogger).Write(values);
+}
+
+bool WorkloadGenerator::GetEndDay(std::int64_t& endDay) const
+{
+    if (mOptions.endDate.empty()) {
+        Core::LocalTimeConverter converter;
+        const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+        endDay = converter.ToLocal(now.count()) / 86400;
+        return true;
+    }
+
+    int year = 0;
+    unsigned month = 0;
+    unsigned day = 0;
+    if (std::sscanf(mOptions.endDate.c_str(), "%4d-%2u-%2u", &year, &month, &day) != 3 || month < 1 || month > 12 ||
+        day < 1 || day > 31) {
+        pLogger->error("End date {0} is not a YYYY-MM-DD date", mOptions.endDate);
+        return false;
+    }
+
+    endDay = Core::DaysFromCivil(year, month, day);
+    return true;
+}
+
+std::vector<std::int64_t> WorkloadGenerator::PickWorkingDays(std::int64_t firstDay, std::int64_t endDay)
+{
+    std::vector<std::int64_t> days;
+    std::int64_t week = -1;
+    bool isWeekOff = false;
+
+    for (std::int64_t day = firstDay; day <= endDay; day++) {
+        // 1970-01-01 was a Thursday, weeks run Monday to Sunday
+        const std::int64_t weekday = ((day + 3) % 7 + 7) % 7;
+        const std::int64_t currentWeek = (day + 3 - weekday) / 7;
+        if (currentWeek != week) {
+            week = currentWeek;
+            isWeekOff = mRandom.Chance(0.08);
+        }
+
+        const bool isWeekend = weekday >= 5;
+        if (isWeekOff || (isWeekend && !mRandom.Chance(0.05)) || (!isWeekend && mRandom.Chance(0.02))) {
+            continue;
+        }
+        days.push_back(day);
+    }
+
+    return days;
+}
+
+std::string WorkloadGenerator::MakeDescription()
+{
+    std::string description;
+    const std::int64_t wordCount = mRandom.Between(3, 12);
+    for (std::int64_t i = 0; i < wordCount; i++) {
+        if (!description.empty()) {
+            description += ' ';
+        }
+
+        if (mRandom.Chance(0.05)) {
+            description += fmt::format("#{0}", mRandom.Between(100, 9999));
+        } else {
+            description += Vocabulary[mWords.Pick(mRandom)];
+        }
+    }
+    return description;
+}
+} // namespace app::Bench
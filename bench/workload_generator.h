@@ -0,0 +1,133 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace app::Core
+{
+class Database;
+} // namespace app::Core
+
+namespace app::Bench
+{
+struct WorkloadOptions {
+    std::uint64_t seed = 42;
+    int employers = 5;
+    int tasks = 200;
+    int years = 3;
+    double entriesPerDay = 8.0;
+    // when set, overrides entriesPerDay so the history holds about this many entries
+    std::int64_t entries = 0;
+    int persistentKeys = 5000;
+    // last day of the history as YYYY-MM-DD, today when empty
+    std::string endDate;
+};
+
+// Deterministic source of random numbers. The standard distributions produce different sequences on different
+// standard libraries, so every distribution is derived here from the raw 64-bit generator and a seed gives the
+// same database everywhere.
+class WorkloadRandom final
+{
+public:
+    explicit WorkloadRandom(std::uint64_t seed);
+
+    std::uint64_t Next();
+    // uniform in [0, 1)
+    double Uniform();
+    std::int64_t Between(std::int64_t low, std::int64_t high);
+    bool Chance(double probability);
+    double Normal(double mean, double deviation);
+    double Exponential(double mean);
+    std::int64_t Poisson(double mean);
+
+private:
+    std::uint64_t mState;
+};
+
+// Picks index i with probability proportional to 1 / (i + 1)^exponent, so a few items take most of the draws
+class ZipfTable final
+{
+public:
+    ZipfTable(std::size_t count, double exponent);
+
+    std::size_t Pick(WorkloadRandom& random) const;
+
+private:
+    std::vector<double> mCumulative;
+};
+
+// Builds a database that looks like years of daily use, through the same migrations and repository writes as the
+// application.
+//
+// Working days start between 08:00 and 09:30 local time and hold a Poisson number of entries that share a workday
+// of about eight hours. Weekends are mostly empty and each year has a few weeks off. Employers and tasks are
+// picked with skewed popularity, consecutive entries often continue the same task, and descriptions are drawn
+// from a small vocabulary so the full-text index sees realistic token frequencies.
+class WorkloadGenerator final
+{
+public:
+    static constexpr std::size_t BatchSize = 50000;
+
+    WorkloadGenerator(WorkloadOptions options, std::shared_ptr<spdlog::logger> logger);
+    WorkloadGenerator(const WorkloadGenerator&) = delete;
+    ~WorkloadGenerator() = default;
+
+    WorkloadGenerator& operator=(const WorkloadGenerator&) = delete;
+
+    // Creates databaseFile, which must not exist yet
+    bool Generate(const std::filesystem::path& databaseFile);
+
+private:
+    struct Task {
+        std::int64_t taskId;
+        std::int64_t employerId;
+    };
+
+    bool InsertEmployers(Core::Database& database, std::vector<std::int64_t>& employerIds);
+    bool InsertTasks(Core::Database& database,
+        const std::vector<std::int64_t>& employerIds,
+        std::vector<std::vector<Task>>& tasks);
+    bool InsertTimeEntries(std::shared_ptr<Core::Database> database,
+        const std::vector<std::vector<Task>>& tasks,
+        std::int64_t& entryCount);
+    bool InsertPersistentObjects(std::shared_ptr<Core::Database> database);
+
+    bool GetEndDay(std::int64_t& endDay) const;
+    std::vector<std::int64_t> PickWorkingDays(std::int64_t firstDay, std::int64_t endDay);
+    std::string MakeDescription();
+
+    WorkloadOptions mOptions;
+    std::shared_ptr<spdlog::logger> pLogger;
+    WorkloadRandom mRandom;
+    ZipfTable mWords;
+
+    static const std::vector<std::string> Vocabulary;
+    static const std::string InsertEmployerQuery;
+    static const std::string InsertTaskQuery;
+};
+} // namespace app::Bench
@@ -0,0 +1,96 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+// Builds a synthetic taskies database for benchmarks and profiling.
+//
+// Usage: taskies_workload --output <taskies.db> [--seed <n>] [--employers <n>] [--tasks <n>] [--years <n>]
+//                         [--entries-per-day <n> | --entries <total>] [--persistent-keys <n>] [--end <YYYY-MM-DD>]
+//
+// The same seed and end date always produce the same content. Without --end the history ends today, so pass the
+// date logged by a run to reproduce it later.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include "workload_generator.h"
+
+namespace
+{
+bool ParseArguments(int argc, char** argv, app::Bench::WorkloadOptions& options, std::filesystem::path& output)
+{
+    for (int i = 1; i < argc; i++) {
+        const char* argument = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", argument);
+            return false;
+        }
+
+        const char* value = argv[++i];
+        if (std::strcmp(argument, "--output") == 0) {
+            output = std::filesystem::u8path(value);
+        } else if (std::strcmp(argument, "--seed") == 0) {
+            options.seed = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argument, "--employers") == 0) {
+            options.employers = std::atoi(value);
+        } else if (std::strcmp(argument, "--tasks") == 0) {
+            options.tasks = std::atoi(value);
+        } else if (std::strcmp(argument, "--years") == 0) {
+            options.years = std::atoi(value);
+        } else if (std::strcmp(argument, "--entries-per-day") == 0) {
+            options.entriesPerDay = std::atof(value);
+        } else if (std::strcmp(argument, "--entries") == 0) {
+            options.entries = std::atoll(value);
+        } else if (std::strcmp(argument, "--persistent-keys") == 0) {
+            options.persistentKeys = std::atoi(value);
+        } else if (std::strcmp(argument, "--end") == 0) {
+            options.endDate = value;
+        } else {
+            std::fprintf(stderr, "Unknown argument %s\n", argument);
+            return false;
+        }
+    }
+
+    if (output.empty()) {
+        std::fprintf(stderr, "--output is required\n");
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    app::Bench::WorkloadOptions options;
+    std::filesystem::path output;
+    if (!ParseArguments(argc, argv, options, output)) {
+        return 2;
+    }
+
+    auto logger = spdlog::stdout_color_mt("workload");
+    logger->info("Seed {0}", options.seed);
+
+    app::Bench::WorkloadGenerator generator(options, logger);
+    return generator.Generate(output) ? 0 : 1;
+}
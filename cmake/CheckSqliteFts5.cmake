@@ -0,0 +1,41 @@
+# Fails the configure step when the SQLite library a target links against was built without FTS5.
+#
+# The search tables migration creates FTS5 tables. Without FTS5 the whole pending migration transaction rolls back
+# and the application refuses to start, so this is checked here rather than discovered at runtime.
+# vcpkg.json asks for sqlite3[fts5].
+#
+# Usage: include(CheckSqliteFts5) then taskies_require_sqlite_fts5(unofficial::sqlite3::sqlite3)
+
+include(CheckCSourceRuns)
+
+function(taskies_require_sqlite_fts5 SQLITE_TARGET)
+    if (CMAKE_CROSSCOMPILING AND NOT CMAKE_CROSSCOMPILING_EMULATOR)
+        message(WARNING "Cross compiling, cannot check that SQLite was built with FTS5")
+        return()
+    endif()
+
+    set(CMAKE_REQUIRED_LIBRARIES ${SQLITE_TARGET})
+    set(CMAKE_REQUIRED_QUIET ON)
+    check_c_source_runs("
+        #include <sqlite3.h>
+        int main(void)
+        {
+            sqlite3* db = 0;
+            int rc = sqlite3_open(\":memory:\", &db);
+            if (rc == SQLITE_OK) {
+                rc = sqlite3_exec(db, \"CREATE VIRTUAL TABLE t USING fts5(x);\", 0, 0, 0);
+            }
+            sqlite3_close(db);
+            return rc == SQLITE_OK ? 0 : 1;
+        }"
+        TASKIES_SQLITE_HAS_FTS5)
+
+    if (NOT TASKIES_SQLITE_HAS_FTS5)
+        # only a successful check is cached, so the next configure checks again once SQLite has been rebuilt
+        unset(TASKIES_SQLITE_HAS_FTS5 CACHE)
+        message(FATAL_ERROR "SQLite was built without FTS5, which the search tables need.\n"
+            "With vcpkg install the sqlite3[fts5] feature, vcpkg.json in the repository root already asks for it.")
+    endif()
+
+    message(STATUS "SQLite FTS5: found")
+endfunction()
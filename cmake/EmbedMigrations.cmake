@@ -0,0 +1,58 @@
+# Generates a header containing every SQL migration in MIGRATIONS_DIR as a sorted constexpr table.
+#
+# Usage: cmake -DMIGRATIONS_DIR=<dir> -DOUTPUT=<header> -P EmbedMigrations.cmake
+
+if (NOT MIGRATIONS_DIR OR NOT OUTPUT)
+    message(FATAL_ERROR "MIGRATIONS_DIR and OUTPUT must be set")
+endif()
+
+file(GLOB MIGRATION_FILES "${MIGRATIONS_DIR}/*.sql")
+# migration names start with a timestamp, so name order is apply order
+list(SORT MIGRATION_FILES)
+
+list(LENGTH MIGRATION_FILES MIGRATION_COUNT)
+if (MIGRATION_COUNT EQUAL 0)
+    message(FATAL_ERROR "No migrations found in ${MIGRATIONS_DIR}")
+endif()
+
+# MSVC limits a single string literal to 16380 characters, long files are emitted as adjacent literals
+set(CHUNK_SIZE 8000)
+
+set(CONTENT "// Generated by cmake/EmbedMigrations.cmake from res/migrations, do not edit\n\n")
+string(APPEND CONTENT "#pragma once\n\n")
+string(APPEND CONTENT "namespace app::Core\n{\n")
+string(APPEND CONTENT "constexpr Migration EmbeddedMigrations[] = {\n")
+
+foreach (MIGRATION_FILE ${MIGRATION_FILES})
+    get_filename_component(MIGRATION_NAME "${MIGRATION_FILE}" NAME_WE)
+    file(READ "${MIGRATION_FILE}" MIGRATION_SQL)
+
+    string(FIND "${MIGRATION_SQL}" ")tks\"" DELIMITER_POSITION)
+    if (NOT DELIMITER_POSITION EQUAL -1)
+        message(FATAL_ERROR "${MIGRATION_FILE} contains the raw string delimiter )tks\"")
+    endif()
+
+    string(APPEND CONTENT "    { \"${MIGRATION_NAME}\",\n")
+
+    string(LENGTH "${MIGRATION_SQL}" SQL_LENGTH)
+    set(OFFSET 0)
+    while (OFFSET LESS SQL_LENGTH)
+        string(SUBSTRING "${MIGRATION_SQL}" ${OFFSET} ${CHUNK_SIZE} CHUNK)
+        string(APPEND CONTENT "        R\"tks(${CHUNK})tks\"\n")
+        math(EXPR OFFSET "${OFFSET} + ${CHUNK_SIZE}")
+    endwhile()
+
+    string(APPEND CONTENT "    },\n")
+endforeach()
+
+string(APPEND CONTENT "};\n")
+string(APPEND CONTENT "} // namespace app::Core\n")
+
+# only touch the header when something changed to avoid needless rebuilds
+if (EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" EXISTING_CONTENT)
+endif()
+
+if (NOT "${EXISTING_CONTENT}" STREQUAL "${CONTENT}")
+    file(WRITE "${OUTPUT}" "${CONTENT}")
+endif()
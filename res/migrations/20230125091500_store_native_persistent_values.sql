@@ -0,0 +1,14 @@
+CREATE TABLE persistent_objects_native
+(
+    key TEXT PRIMARY KEY,
+    value NOT NULL,
+
+    UNIQUE (key) ON CONFLICT REPLACE
+);
+
+INSERT INTO persistent_objects_native (key, value)
+SELECT key, value FROM persistent_objects;
+
+DROP TABLE persistent_objects;
+
+ALTER TABLE persistent_objects_native RENAME TO persistent_objects;
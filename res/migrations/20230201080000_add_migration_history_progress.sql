@@ -0,0 +1,3 @@
+ALTER TABLE migration_history ADD COLUMN progress INTEGER;
+
+ALTER TABLE migration_history ADD COLUMN is_complete INTEGER NOT NULL DEFAULT (1);
@@ -0,0 +1,14 @@
+CREATE TABLE tasks
+(
+    task_id INTEGER PRIMARY KEY NOT NULL,
+    employer_id INTEGER NOT NULL,
+    name TEXT NOT NULL,
+    description TEXT,
+    date_created INTEGER NOT NULL DEFAULT (strftime('%s','now', 'localtime')),
+    date_modified INTEGER NOT NULL DEFAULT (strftime('%s','now', 'localtime')),
+    is_active INTEGER NOT NULL DEFAULT (1),
+
+    FOREIGN KEY (employer_id) REFERENCES employers(employer_id)
+);
+
+CREATE INDEX idx_tasks_employer_id ON tasks(employer_id);
@@ -0,0 +1,23 @@
+CREATE TABLE time_entries
+(
+    time_entry_id INTEGER PRIMARY KEY NOT NULL,
+    task_id INTEGER NOT NULL,
+    employer_id INTEGER NOT NULL,
+    start_time INTEGER NOT NULL,
+    duration INTEGER NOT NULL,
+    description TEXT,
+    date_created INTEGER NOT NULL DEFAULT (strftime('%s','now', 'localtime')),
+    date_modified INTEGER NOT NULL DEFAULT (strftime('%s','now', 'localtime')),
+
+    FOREIGN KEY (task_id) REFERENCES tasks(task_id),
+    FOREIGN KEY (employer_id) REFERENCES employers(employer_id)
+);
+
+-- start_time and duration are unix seconds, entries for a day are a range scan on start_time
+CREATE INDEX idx_time_entries_start_time ON time_entries(start_time);
+
+-- covers per-employer totals over a date range without touching the table
+CREATE INDEX idx_time_entries_employer_id_start_time ON time_entries(employer_id, start_time, duration);
+
+-- keeps foreign key checks on task deletes from scanning the table
+CREATE INDEX idx_time_entries_task_id ON time_entries(task_id);
@@ -0,0 +1,55 @@
+-- Pre-aggregated time per employer and local day, kept in step with time_entries by the triggers below
+CREATE TABLE employer_daily_totals
+(
+    employer_id INTEGER NOT NULL,
+    day TEXT NOT NULL,
+    total_duration INTEGER NOT NULL DEFAULT (0),
+    entry_count INTEGER NOT NULL DEFAULT (0),
+
+    PRIMARY KEY (employer_id, day),
+    FOREIGN KEY (employer_id) REFERENCES employers(employer_id)
+) WITHOUT ROWID;
+
+CREATE INDEX idx_employer_daily_totals_day ON employer_daily_totals(day);
+
+CREATE TRIGGER trg_time_entries_insert_daily_totals AFTER INSERT ON time_entries
+BEGIN
+    INSERT INTO employer_daily_totals (employer_id, day, total_duration, entry_count)
+    VALUES (NEW.employer_id, date(NEW.start_time, 'unixepoch', 'localtime'), NEW.duration, 1)
+    ON CONFLICT (employer_id, day) DO UPDATE
+    SET total_duration = total_duration + excluded.total_duration,
+        entry_count = entry_count + 1;
+END;
+
+CREATE TRIGGER trg_time_entries_delete_daily_totals AFTER DELETE ON time_entries
+BEGIN
+    UPDATE employer_daily_totals
+    SET total_duration = total_duration - OLD.duration,
+        entry_count = entry_count - 1
+    WHERE employer_id = OLD.employer_id AND day = date(OLD.start_time, 'unixepoch', 'localtime');
+
+    DELETE FROM employer_daily_totals
+    WHERE employer_id = OLD.employer_id AND day = date(OLD.start_time, 'unixepoch', 'localtime') AND entry_count <= 0;
+END;
+
+CREATE TRIGGER trg_time_entries_update_daily_totals AFTER UPDATE OF employer_id, start_time, duration ON time_entries
+BEGIN
+    UPDATE employer_daily_totals
+    SET total_duration = total_duration - OLD.duration,
+        entry_count = entry_count - 1
+    WHERE employer_id = OLD.employer_id AND day = date(OLD.start_time, 'unixepoch', 'localtime');
+
+    DELETE FROM employer_daily_totals
+    WHERE employer_id = OLD.employer_id AND day = date(OLD.start_time, 'unixepoch', 'localtime') AND entry_count <= 0;
+
+    INSERT INTO employer_daily_totals (employer_id, day, total_duration, entry_count)
+    VALUES (NEW.employer_id, date(NEW.start_time, 'unixepoch', 'localtime'), NEW.duration, 1)
+    ON CONFLICT (employer_id, day) DO UPDATE
+    SET total_duration = total_duration + excluded.total_duration,
+        entry_count = entry_count + 1;
+END;
+
+INSERT INTO employer_daily_totals (employer_id, day, total_duration, entry_count)
+SELECT employer_id, date(start_time, 'unixepoch', 'localtime'), SUM(duration), COUNT(*)
+FROM time_entries
+GROUP BY employer_id, date(start_time, 'unixepoch', 'localtime');
@@ -0,0 +1,59 @@
+-- Full-text indexes over task and time entry text. Both are external content tables: the index only keeps the
+-- tokens and reads the text back from the source table, so the triggers below must mirror every change to it.
+CREATE VIRTUAL TABLE time_entries_fts USING fts5
+(
+    description,
+    content = 'time_entries',
+    content_rowid = 'time_entry_id',
+    tokenize = 'unicode61 remove_diacritics 2',
+    prefix = '2 3'
+);
+
+CREATE VIRTUAL TABLE tasks_fts USING fts5
+(
+    name,
+    description,
+    content = 'tasks',
+    content_rowid = 'task_id',
+    tokenize = 'unicode61 remove_diacritics 2',
+    prefix = '2 3'
+);
+
+CREATE TRIGGER trg_time_entries_insert_fts AFTER INSERT ON time_entries
+BEGIN
+    INSERT INTO time_entries_fts (rowid, description) VALUES (NEW.time_entry_id, NEW.description);
+END;
+
+CREATE TRIGGER trg_time_entries_delete_fts AFTER DELETE ON time_entries
+BEGIN
+    INSERT INTO time_entries_fts (time_entries_fts, rowid, description)
+    VALUES ('delete', OLD.time_entry_id, OLD.description);
+END;
+
+CREATE TRIGGER trg_time_entries_update_fts AFTER UPDATE OF description ON time_entries
+BEGIN
+    INSERT INTO time_entries_fts (time_entries_fts, rowid, description)
+    VALUES ('delete', OLD.time_entry_id, OLD.description);
+    INSERT INTO time_entries_fts (rowid, description) VALUES (NEW.time_entry_id, NEW.description);
+END;
+
+CREATE TRIGGER trg_tasks_insert_fts AFTER INSERT ON tasks
+BEGIN
+    INSERT INTO tasks_fts (rowid, name, description) VALUES (NEW.task_id, NEW.name, NEW.description);
+END;
+
+CREATE TRIGGER trg_tasks_delete_fts AFTER DELETE ON tasks
+BEGIN
+    INSERT INTO tasks_fts (tasks_fts, rowid, name, description)
+    VALUES ('delete', OLD.task_id, OLD.name, OLD.description);
+END;
+
+CREATE TRIGGER trg_tasks_update_fts AFTER UPDATE OF name, description ON tasks
+BEGIN
+    INSERT INTO tasks_fts (tasks_fts, rowid, name, description)
+    VALUES ('delete', OLD.task_id, OLD.name, OLD.description);
+    INSERT INTO tasks_fts (rowid, name, description) VALUES (NEW.task_id, NEW.name, NEW.description);
+END;
+
+INSERT INTO time_entries_fts (time_entries_fts) VALUES ('rebuild');
+INSERT INTO tasks_fts (tasks_fts) VALUES ('rebuild');
@@ -0,0 +1,12 @@
+-- Closed years whose time entries were moved into <database name>-<year>.db archive files.
+-- Their daily totals stay in employer_daily_totals, so reports over any range never need the archives.
+CREATE TABLE archived_years
+(
+    year INTEGER PRIMARY KEY NOT NULL,
+    file_name TEXT NOT NULL,
+    year_start INTEGER NOT NULL,
+    year_end INTEGER NOT NULL,
+    entry_count INTEGER NOT NULL,
+    total_duration INTEGER NOT NULL,
+    date_created INTEGER NOT NULL DEFAULT (strftime('%s','now', 'localtime'))
+);
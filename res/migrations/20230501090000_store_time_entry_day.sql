@@ -0,0 +1,50 @@
+-- The local day of an entry is worked out once, when the entry is written, and stored with it.
+-- The daily totals triggers key on the stored day, so an update or delete made under a different time zone or
+-- daylight saving offset than the insert still subtracts from the row the insert added to.
+-- Rows written before this have no day until the backfill data migration reaches them, until then the triggers
+-- fall back to working it out as before.
+ALTER TABLE time_entries ADD COLUMN day TEXT;
+
+DROP TRIGGER trg_time_entries_insert_daily_totals;
+DROP TRIGGER trg_time_entries_delete_daily_totals;
+DROP TRIGGER trg_time_entries_update_daily_totals;
+
+CREATE TRIGGER trg_time_entries_insert_daily_totals AFTER INSERT ON time_entries
+BEGIN
+    INSERT INTO employer_daily_totals (employer_id, day, total_duration, entry_count)
+    VALUES (NEW.employer_id, coalesce(NEW.day, date(NEW.start_time, 'unixepoch', 'localtime')), NEW.duration, 1)
+    ON CONFLICT (employer_id, day) DO UPDATE
+    SET total_duration = total_duration + excluded.total_duration,
+        entry_count = entry_count + 1;
+END;
+
+CREATE TRIGGER trg_time_entries_delete_daily_totals AFTER DELETE ON time_entries
+BEGIN
+    UPDATE employer_daily_totals
+    SET total_duration = total_duration - OLD.duration,
+        entry_count = entry_count - 1
+    WHERE employer_id = OLD.employer_id AND day = coalesce(OLD.day, date(OLD.start_time, 'unixepoch', 'localtime'));
+
+    DELETE FROM employer_daily_totals
+    WHERE employer_id = OLD.employer_id AND day = coalesce(OLD.day, date(OLD.start_time, 'unixepoch', 'localtime'))
+    AND entry_count <= 0;
+END;
+
+-- writers set day together with start_time, filling in the day of an older row on its own moves nothing
+CREATE TRIGGER trg_time_entries_update_daily_totals AFTER UPDATE OF employer_id, start_time, duration ON time_entries
+BEGIN
+    UPDATE employer_daily_totals
+    SET total_duration = total_duration - OLD.duration,
+        entry_count = entry_count - 1
+    WHERE employer_id = OLD.employer_id AND day = coalesce(OLD.day, date(OLD.start_time, 'unixepoch', 'localtime'));
+
+    DELETE FROM employer_daily_totals
+    WHERE employer_id = OLD.employer_id AND day = coalesce(OLD.day, date(OLD.start_time, 'unixepoch', 'localtime'))
+    AND entry_count <= 0;
+
+    INSERT INTO employer_daily_totals (employer_id, day, total_duration, entry_count)
+    VALUES (NEW.employer_id, coalesce(NEW.day, date(NEW.start_time, 'unixepoch', 'localtime')), NEW.duration, 1)
+    ON CONFLICT (employer_id, day) DO UPDATE
+    SET total_duration = total_duration + excluded.total_duration,
+        entry_count = entry_count + 1;
+END;
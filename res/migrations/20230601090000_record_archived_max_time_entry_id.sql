@@ -0,0 +1,4 @@
+-- Time entry ids are handed out one past the largest id in use. Once a year is archived its ids are no longer in
+-- time_entries, so the largest id of each archived year is kept here and new ids start past it as well.
+-- Years archived before this have no recorded id, archiving had no caller in the application until now.
+ALTER TABLE archived_years ADD COLUMN max_time_entry_id INTEGER NOT NULL DEFAULT 0;
@@ -0,0 +1,26 @@
+-- TimeEntryRepository::BulkInsert adds a row here at the start of its transaction and removes it before the commit.
+-- While the row is there the insert triggers below do nothing and BulkInsert indexes and totals all of its rows at
+-- once instead, its queries must do what these triggers do. No other connection ever sees the row.
+CREATE TABLE bulk_insert_active
+(
+    active INTEGER NOT NULL
+);
+
+DROP TRIGGER trg_time_entries_insert_fts;
+DROP TRIGGER trg_time_entries_insert_daily_totals;
+
+CREATE TRIGGER trg_time_entries_insert_fts AFTER INSERT ON time_entries
+WHEN NOT EXISTS (SELECT 1 FROM bulk_insert_active)
+BEGIN
+    INSERT INTO time_entries_fts (rowid, description) VALUES (NEW.time_entry_id, NEW.description);
+END;
+
+CREATE TRIGGER trg_time_entries_insert_daily_totals AFTER INSERT ON time_entries
+WHEN NOT EXISTS (SELECT 1 FROM bulk_insert_active)
+BEGIN
+    INSERT INTO employer_daily_totals (employer_id, day, total_duration, entry_count)
+    VALUES (NEW.employer_id, coalesce(NEW.day, date(NEW.start_time, 'unixepoch', 'localtime')), NEW.duration, 1)
+    ON CONFLICT (employer_id, day) DO UPDATE
+    SET total_duration = total_duration + excluded.total_duration,
+        entry_count = entry_count + 1;
+END;
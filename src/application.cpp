@@ -19,27 +19,89 @@
 
 #include "application.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
 #include <spdlog/spdlog.h>
-#include <spdlog/sinks/dist_sink.h>
+#include <spdlog/async.h>
 #include <spdlog/sinks/daily_file_sink.h>
+#ifdef _WIN32
 #include <spdlog/sinks/msvc_sink.h>
+#else
+#include <spdlog/sinks/stdout_color_sinks.h>
+#endif
 
 #include "common/common.h"
 
 #include "core/environment.h"
 #include "core/configuration.h"
+#include "core/database.h"
+#include "core/database_backup.h"
 #include "core/database_migration.h"
+#include "core/database_worker.h"
+#include "core/daily_totals_repository.h"
+#include "core/data_migration.h"
+#include "core/export_job.h"
+#include "core/startup_timer.h"
+#include "core/time_entry_archive.h"
+#include "core/time_entry_import.h"
+#include "core/time_entry_snapshot_store.h"
+#include "core/trace.h"
 
 #include "ui/persistencemanager.h"
 #include "ui/translator.h"
 #include "ui/mainframe.h"
 
+namespace
+{
+spdlog::level::level_enum ToLogLevel(const std::string& name, spdlog::level::level_enum fallback)
+{
+    // from_str maps unknown names to off, which would silently drop everything
+    const auto level = spdlog::level::from_str(name);
+    return level == spdlog::level::off && name != "off" ? fallback : level;
+}
+
+bool ExportFormatFromFile(const std::filesystem::path& file, app::Core::ExportFormat& format)
+{
+    const auto extension = file.extension();
+    if (extension == ".csv") {
+        format = app::Core::ExportFormat::Csv;
+    } else if (extension == ".json") {
+        format = app::Core::ExportFormat::Json;
+    } else if (extension == ".ics") {
+        format = app::Core::ExportFormat::ICalendar;
+    } else {
+        return false;
+    }
+    return true;
+}
+} // namespace
+
 namespace app
 {
 Application::Application()
     : pLogger(nullptr)
     , pEnv(nullptr)
+    , pCfg(nullptr)
+    , pDatabaseWorker(nullptr)
+    , pDataMigrationRunner(nullptr)
+    , pDatabaseBackupRunner(nullptr)
+    , pTimeEntryArchive(nullptr)
+    , pTimeEntrySnapshotStore(nullptr)
+    , pExportJob(nullptr)
     , pPersistenceManager(nullptr)
+    , pStartupTimer(std::make_shared<Core::StartupTimer>())
+    , mStartupTimingsFile()
+    , mTraceFile()
+    , mRestoreBackupFile()
+    , mArchiveKeepClosedYears()
+    , mImportFile()
+    , mExportFile()
+    , bVerifyDailyTotals(false)
+    , bRebuildDailyTotals(false)
 {
     SetProcessDPIAware();
 }
@@ -49,21 +111,39 @@ bool Application::OnInit()
     if (!wxApp::OnInit()) {
         return false;
     }
+    pStartupTimer->Mark("wx_startup");
+    TKS_TRACE_THREAD_NAME("main");
 
     pEnv = std::make_shared<Core::Environment>();
-    pCfg = std::make_shared<Core::Configuration>(pEnv);
+    pStartupTimer->Mark("environment");
 
     InitializeLogger();
+    pStartupTimer->Mark("logger");
 
-    pPersistenceManager = std::make_unique<UI::PersistenceManager>(pEnv, pLogger);
-    wxPersistenceManager::Set(*pPersistenceManager);
+    pCfg = std::make_shared<Core::Configuration>(pEnv->GetConfigurationPath(), pLogger);
+    pStartupTimer->Mark("configuration");
 
-    if (!RunMigrations()) {
-        pLogger->error("Failed to run migrations");
-        wxMessageBox("Failed to run migrations", Common::GetProgramName(), wxICON_ERROR | wxOK_DEFAULT);
+    // the restore replaces the database file, so it has to finish before anything opens a connection to it
+    if (!mRestoreBackupFile.empty() && !RestoreBackup()) {
         return false;
     }
 
+    // every database call runs on the worker, completions come back through CallAfter
+    pDatabaseWorker = std::make_shared<Core::DatabaseWorker>(pEnv->GetDatabasePath(),
+        pCfg->GetDatabasePragmas(),
+        pLogger,
+        [this](std::function<void()> completion) { CallAfter(std::move(completion)); });
+    pDatabaseWorker->Start();
+    pStartupTimer->Mark("database_worker");
+
+    pPersistenceManager = std::make_unique<UI::PersistenceManager>(pDatabaseWorker, pLogger);
+    wxPersistenceManager::Set(*pPersistenceManager);
+
+    // saved window state is buffered and written by the persistence manager's own timer, and here when the
+    // session ends
+    Bind(wxEVT_END_SESSION, &Application::OnEndSession, this);
+    pStartupTimer->Mark("persistence_manager");
+
     if (!InitializeTranslations()) {
         pLogger->error("Failed to initialize translations");
         wxMessageBox("Failed to initialize translations.\n"
@@ -72,58 +152,418 @@ bool Application::OnInit()
             wxICON_ERROR | wxOK_DEFAULT);
         return false;
     }
+    pStartupTimer->Mark("translations");
 
     if (!pEnv->IsSetup()) {
         if (!FirstStartupProcedure()) {
             return false;
         }
     }
+    pStartupTimer->Mark("setup_check");
 
-    auto frame = new UI::MainFrame(pEnv, pCfg, pLogger);
-    frame->Show(true);
-    SetTopWindow(frame);
+    // the main frame is created once the migrations have run and the persisted window state has arrived
+    RunMigrations();
 
     return true;
 }
 
 int Application::OnExit()
 {
-    // Under VisualStudio, this must be called before main finishes to workaround a known VS issue
-    spdlog::drop_all();
+    // an unfinished export is cancelled and its partial file removed
+    pExportJob.reset();
+
+    if (pDatabaseBackupRunner) {
+        pDatabaseBackupRunner->Stop();
+    }
+
+    if (pDataMigrationRunner) {
+        pDataMigrationRunner->Stop();
+    }
+
+    if (pPersistenceManager) {
+        pPersistenceManager->Flush();
+    }
+
+    // runs the writes queued above before the connection closes
+    if (pDatabaseWorker) {
+        pDatabaseWorker->Stop();
+        pTimeEntrySnapshotStore.reset();
+        pTimeEntryArchive.reset();
+
+        const auto stats = pDatabaseWorker->GetStats();
+        pLogger->info("Database worker ran {0} requests, max queue depth {1}, wait avg {2}us max {3}us, "
+                      "run avg {4}us max {5}us",
+            stats.completedRequests,
+            stats.maxQueueDepth,
+            stats.averageWait.count(),
+            stats.maxWait.count(),
+            stats.averageRun.count(),
+            stats.maxRun.count());
+    }
+
+#ifdef TKS_TRACE
+    if (!mTraceFile.empty()) {
+        Core::Tracer::GetInstance().WriteJson(mTraceFile, pLogger);
+    }
+#endif // TKS_TRACE
+
+    // Under VisualStudio, this must be called before main finishes to workaround a known VS issue.
+    // It also writes out whatever is still queued for the logging thread.
+    spdlog::shutdown();
     return wxApp::OnExit();
 }
 
-void Application::InitializeLogger()
+void Application::OnInitCmdLine(wxCmdLineParser& parser)
 {
-    pEnv = std::make_shared<Core::Environment>();
+    wxApp::OnInitCmdLine(parser);
+    parser.AddOption("", "startup-timings", "Write the duration of each startup phase to this JSON file");
+    parser.AddOption("",
+        "archive-closed-years",
+        "Move the time entries of closed years into archive files, keeping this many of the newest closed years",
+        wxCMD_LINE_VAL_NUMBER);
+    parser.AddOption("", "restore-backup", "Replace the database with this backup before it is opened");
+    parser.AddOption("", "import", "Import the time entries of this CSV file, such as one written by the CSV export");
+    parser.AddOption("", "export", "Export all time entries to this .csv, .json or .ics file");
+    parser.AddSwitch(
+        "", "verify-daily-totals", "Compare the daily totals against the time entries and log every difference");
+    parser.AddSwitch("", "rebuild-daily-totals", "Recompute the daily totals from the time entries");
+#ifdef TKS_TRACE
+    parser.AddOption("", "trace", "Write a Chrome trace of the session to this JSON file on exit");
+#endif // TKS_TRACE
+}
+
+bool Application::OnCmdLineParsed(wxCmdLineParser& parser)
+{
+    wxString file;
+    if (parser.Found("startup-timings", &file)) {
+        mStartupTimingsFile = std::filesystem::path(file.ToStdWstring());
+    }
+
+    if (parser.Found("restore-backup", &file)) {
+        mRestoreBackupFile = std::filesystem::path(file.ToStdWstring());
+    }
+
+    if (parser.Found("import", &file)) {
+        mImportFile = std::filesystem::path(file.ToStdWstring());
+    }
+
+    if (parser.Found("export", &file)) {
+        mExportFile = std::filesystem::path(file.ToStdWstring());
+
+        Core::ExportFormat format;
+        if (!ExportFormatFromFile(mExportFile, format)) {
+            wxLogError("--export needs a file ending in .csv, .json or .ics");
+            return false;
+        }
+    }
 
-    auto logDirectory = pEnv->GetLogFilePath().string();
+    bVerifyDailyTotals = parser.Found("verify-daily-totals");
+    bRebuildDailyTotals = parser.Found("rebuild-daily-totals");
 
-    auto msvcSink = std::make_shared<spdlog::sinks::msvc_sink_st>();
+    long keepClosedYears = 0;
+    if (parser.Found("archive-closed-years", &keepClosedYears)) {
+        if (keepClosedYears < 0) {
+            wxLogError("--archive-closed-years needs a number of years of 0 or more");
+            return false;
+        }
+        mArchiveKeepClosedYears = static_cast<int>(keepClosedYears);
+    }
+#ifdef TKS_TRACE
+    if (parser.Found("trace", &file)) {
+        mTraceFile = std::filesystem::path(file.ToStdWstring());
+    }
+#endif // TKS_TRACE
+
+    return wxApp::OnCmdLineParsed(parser);
+}
 
-    auto msvcLogger = std::make_shared<spdlog::logger>("msvc", msvcSink);
-    msvcLogger->set_level(spdlog::level::trace);
+void Application::InitializeLogger()
+{
+    const auto settings = Core::Configuration::ReadLoggingSettings(pEnv->GetConfigurationPath());
 
-    auto dialySink = std::make_shared<spdlog::sinks::daily_file_sink_st>(logDirectory, 23, 59);
-    dialySink->set_level(spdlog::level::err);
+    // calls only format and queue the message, a single background thread owns the sinks and does the writing,
+    // so the sinks need no locking of their own
+    spdlog::init_thread_pool(static_cast<std::size_t>(std::max(settings.QueueSize, 64)), 1);
 
-    std::shared_ptr<spdlog::sinks::dist_sink_st> combinedLoggers = std::make_shared<spdlog::sinks::dist_sink_st>();
+#ifdef _WIN32
+    auto consoleSink = std::make_shared<spdlog::sinks::msvc_sink_st>();
+#else
+    // stderr ends up in the journal when the session is run under systemd
+    auto consoleSink = std::make_shared<spdlog::sinks::stderr_color_sink_st>();
+#endif
+    consoleSink->set_level(ToLogLevel(settings.ConsoleLevel, spdlog::level::trace));
 
-    combinedLoggers->add_sink(msvcSink);
-    combinedLoggers->add_sink(dialySink);
+    auto dailySink = std::make_shared<spdlog::sinks::daily_file_sink_st>(pEnv->GetLogFilePath().string(), 23, 59);
+    dailySink->set_level(ToLogLevel(settings.FileLevel, spdlog::level::info));
 
-    auto logger = std::make_shared<spdlog::logger>("taskies-logger", combinedLoggers);
+    const auto overflowPolicy = settings.OverflowPolicy == "block" ? spdlog::async_overflow_policy::block
+                                                                    : spdlog::async_overflow_policy::overrun_oldest;
+    auto logger = std::make_shared<spdlog::async_logger>("taskies-logger",
+        spdlog::sinks_init_list{ consoleSink, dailySink },
+        spdlog::thread_pool(),
+        overflowPolicy);
+    logger->set_level(ToLogLevel(settings.Level, spdlog::level::info));
     logger->flush_on(spdlog::level::err);
     logger->enable_backtrace(32);
 
+    // flush_every only reaches registered loggers
+    spdlog::register_logger(logger);
+    spdlog::flush_every(std::chrono::seconds(std::max(settings.FlushIntervalSeconds, 1)));
+
     pLogger = logger;
 }
 
-bool Application::RunMigrations()
+bool Application::RestoreBackup()
+{
+    Core::DatabaseBackupRunner restorer(
+        pEnv->GetDatabasePath(), pCfg->GetDatabasePragmas(), pCfg->GetBackupSettings(), pLogger);
+    if (!restorer.Restore(mRestoreBackupFile)) {
+        pLogger->error("Failed to restore backup {0}", mRestoreBackupFile.u8string());
+        wxMessageBox("Failed to restore the backup, see the log for details",
+            Common::GetProgramName(),
+            wxICON_ERROR | wxOK_DEFAULT);
+        return false;
+    }
+
+    pStartupTimer->Mark("restore_backup");
+    return true;
+}
+
+void Application::RunMigrations()
+{
+    auto logger = pLogger;
+    pDatabaseWorker->Submit(
+        [logger](std::shared_ptr<Core::Database> database) {
+            if (!database->IsOpen()) {
+                return false;
+            }
+
+            Core::DatabaseMigration migrations(database, logger);
+            return migrations.Migrate();
+        },
+        [this](bool migrated) { OnMigrationsCompleted(migrated); });
+}
+
+void Application::OnMigrationsCompleted(bool migrated)
+{
+    TKS_TRACE_SCOPE("ui/migrations_completed");
+    if (!migrated) {
+        pLogger->error("Failed to open the database or run migrations");
+        wxMessageBox(
+            "Failed to open the database or run migrations", Common::GetProgramName(), wxICON_ERROR | wxOK_DEFAULT);
+        ExitMainLoop();
+        return;
+    }
+    // includes the wait for the event loop to start, the completion is delivered through it
+    pStartupTimer->Mark("migrations");
+
+    // backfills run in small batches on their own connection while the application is in use
+    pDataMigrationRunner =
+        std::make_shared<Core::DataMigrationRunner>(pEnv->GetDatabasePath(), pCfg->GetDatabasePragmas(), pLogger);
+    pDataMigrationRunner->Start();
+
+    pDatabaseBackupRunner = std::make_shared<Core::DatabaseBackupRunner>(
+        pEnv->GetDatabasePath(), pCfg->GetDatabasePragmas(), pCfg->GetBackupSettings(), pLogger);
+    pDatabaseBackupRunner->Start();
+    pStartupTimer->Mark("background_runners");
+
+    LoadArchive();
+
+    if (bVerifyDailyTotals || bRebuildDailyTotals) {
+        CheckDailyTotals();
+    }
+
+    pPersistenceManager->Load([this](bool loaded) {
+        if (!loaded) {
+            pLogger->warn("Failed to load persisted values, windows will open with their default state");
+        }
+        pStartupTimer->Mark("persistence_load");
+
+        TKS_TRACE_SCOPE("ui/create_main_frame");
+        auto frame = new UI::MainFrame(pEnv, pCfg, pLogger);
+        frame->Show(true);
+        SetTopWindow(frame);
+        pStartupTimer->Mark("main_frame");
+
+        ReportStartupTimings();
+
+        // rewriting snapshots reads whole years, so it waits until the window is up
+        RefreshSnapshots();
+    });
+}
+
+void Application::LoadArchive()
+{
+    auto logger = pLogger;
+    auto databaseFile = pEnv->GetDatabasePath();
+    auto keepClosedYears = mArchiveKeepClosedYears;
+
+    // requests run in order, so archiving finishes before the persisted window state is read
+    pDatabaseWorker->Submit(
+        [logger, databaseFile, keepClosedYears](std::shared_ptr<Core::Database> database) {
+            auto archive = std::make_shared<Core::TimeEntryArchive>(database, databaseFile, logger);
+            if (!database->IsOpen() || !archive->Load()) {
+                return std::shared_ptr<Core::TimeEntryArchive>();
+            }
+
+            if (keepClosedYears && !archive->ArchiveClosedYears(*keepClosedYears)) {
+                logger->error("Failed to archive closed years, the years archived so far stay archived");
+            }
+            return archive;
+        },
+        [this](std::shared_ptr<Core::TimeEntryArchive> archive) {
+            if (!archive) {
+                pLogger->error("Failed to load archived years, their time entries cannot be read");
+            }
+            pTimeEntryArchive = archive;
+
+            // the import needs the archive to turn away rows in archived years, the export then includes what it added
+            if (!mImportFile.empty()) {
+                ImportTimeEntries();
+            } else if (!mExportFile.empty()) {
+                ExportTimeEntries();
+            }
+        });
+}
+
+void Application::ImportTimeEntries()
+{
+    auto logger = pLogger;
+    auto file = mImportFile;
+    auto archive = pTimeEntryArchive;
+
+    pDatabaseWorker->Submit(
+        [logger, file, archive](std::shared_ptr<Core::Database> database) {
+            // without the archive rows of archived years would go into the live table
+            if (!database->IsOpen() || !archive) {
+                return false;
+            }
+
+            Core::TimeEntryImporter importer(database, logger);
+            importer.SetArchive(archive);
+
+            Core::ImportSummary summary;
+            const bool imported = importer.Import(file, summary);
+            for (const auto& error : summary.errors) {
+                logger->warn("Import {0} line {1}: {2}", file.u8string(), error.line, error.message);
+            }
+            logger->info("Import {0} added {1} time entries, {2} employers and {3} tasks, rejected {4} rows",
+                file.u8string(),
+                summary.rowsImported,
+                summary.employersCreated,
+                summary.tasksCreated,
+                summary.rowsRejected);
+            return imported;
+        },
+        [this](bool imported) {
+            if (!imported) {
+                wxMessageBox("Failed to import the time entries, see the log for details",
+                    Common::GetProgramName(),
+                    wxICON_ERROR | wxOK_DEFAULT);
+            }
+
+            if (!mExportFile.empty()) {
+                ExportTimeEntries();
+            }
+        });
+}
+
+void Application::ExportTimeEntries()
+{
+    Core::ExportOptions options;
+    ExportFormatFromFile(mExportFile, options.format);
+    options.file = mExportFile;
+    options.from = std::numeric_limits<std::int64_t>::min();
+    options.to = std::numeric_limits<std::int64_t>::max();
+
+    // the job reads on its own connection, started once archiving is done so no rows move while it reads
+    pExportJob = std::make_shared<Core::ExportJob>(pEnv->GetDatabasePath(),
+        pCfg->GetDatabasePragmas(),
+        pLogger,
+        [this](std::function<void()> completion) { CallAfter(std::move(completion)); });
+    pExportJob->Start(
+        std::move(options),
+        [](std::int64_t, std::int64_t) {},
+        [this](Core::ExportStatus status, std::int64_t rowsWritten) {
+            if (status == Core::ExportStatus::Completed) {
+                pLogger->info("Exported {0} time entries to {1}", rowsWritten, mExportFile.u8string());
+            } else if (status == Core::ExportStatus::Failed) {
+                wxMessageBox("Failed to export the time entries, see the log for details",
+                    Common::GetProgramName(),
+                    wxICON_ERROR | wxOK_DEFAULT);
+            }
+        });
+}
+
+void Application::CheckDailyTotals()
+{
+    auto logger = pLogger;
+    const bool verify = bVerifyDailyTotals;
+    const bool rebuild = bRebuildDailyTotals;
+
+    // runs after archiving, so the years it moves out are already skipped
+    pDatabaseWorker->Submit(
+        [logger, verify, rebuild](std::shared_ptr<Core::Database> database) {
+            if (!database->IsOpen()) {
+                return false;
+            }
+
+            Core::DailyTotalsRepository dailyTotals(database, logger);
+            if (rebuild) {
+                if (!dailyTotals.Rebuild()) {
+                    return false;
+                }
+                logger->info("Rebuilt the daily totals");
+            }
+
+            if (verify) {
+                std::vector<Core::DailyTotalMismatch> mismatches;
+                if (!dailyTotals.Verify(mismatches)) {
+                    return false;
+                }
+
+                for (const auto& mismatch : mismatches) {
+                    logger->warn("Daily total of employer {0} on {1} is {2} seconds in {3} entries, "
+                                 "the time entries add up to {4} seconds in {5} entries",
+                        mismatch.employerId,
+                        mismatch.day,
+                        mismatch.actualDuration,
+                        mismatch.actualCount,
+                        mismatch.expectedDuration,
+                        mismatch.expectedCount);
+                }
+                logger->info("Verified the daily totals, {0} days differ", mismatches.size());
+            }
+            return true;
+        },
+        [this](bool checked) {
+            if (!checked) {
+                pLogger->error("Failed to check the daily totals");
+            }
+        });
+}
+
+void Application::RefreshSnapshots()
 {
-    Core::DatabaseMigration migrations(pEnv, pLogger);
+    auto logger = pLogger;
+    auto databaseFile = pEnv->GetDatabasePath();
+    auto archive = pTimeEntryArchive;
+
+    pDatabaseWorker->Submit(
+        [logger, databaseFile, archive](std::shared_ptr<Core::Database> database) {
+            auto store = std::make_shared<Core::TimeEntrySnapshotStore>(database, databaseFile, logger);
+            if (!database->IsOpen()) {
+                return std::shared_ptr<Core::TimeEntrySnapshotStore>();
+            }
 
-    return migrations.Migrate();
+            store->SetArchive(archive);
+            if (!store->Open() || !store->Refresh()) {
+                logger->warn("Failed to bring the time entry snapshots up to date, reports read those years from "
+                             "the database");
+            }
+            return store;
+        },
+        [this](std::shared_ptr<Core::TimeEntrySnapshotStore> store) { pTimeEntrySnapshotStore = store; });
 }
 
 bool Application::InitializeTranslations()
@@ -145,4 +585,21 @@ bool Application::FirstStartupProcedure()
 
     return true;
 }
+
+void Application::ReportStartupTimings()
+{
+    pLogger->info("{0}", pStartupTimer->Format());
+
+    if (!mStartupTimingsFile.empty() && pStartupTimer->WriteJson(mStartupTimingsFile, pLogger)) {
+        pLogger->info("Wrote startup timings to {0}", mStartupTimingsFile.u8string());
+    }
+}
+
+void Application::OnEndSession(wxCloseEvent& event)
+{
+    TKS_TRACE_SCOPE("ui/end_session");
+    // the session may end without OnExit being called, so make sure nothing saved is lost
+    pPersistenceManager->Flush();
+    event.Skip();
+}
 } // namespace app
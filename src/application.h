@@ -19,13 +19,17 @@
 
 #pragma once
 
+#include <filesystem>
 #include <memory>
+#include <optional>
 
 #include <wx/wxprec.h>
 #ifndef WX_PRECOMP
 #include <wx/wx.h>
 #endif
 
+#include <wx/cmdline.h>
+
 #include <spdlog/spdlog.h>
 
 namespace app
@@ -34,6 +38,13 @@ namespace Core
 {
 class Environment;
 class Configuration;
+class DatabaseWorker;
+class DataMigrationRunner;
+class DatabaseBackupRunner;
+class TimeEntryArchive;
+class TimeEntrySnapshotStore;
+class ExportJob;
+class StartupTimer;
 }
 
 namespace UI
@@ -50,16 +61,46 @@ class Application : public wxApp
     bool OnInit() override;
     int OnExit() override;
 
+    void OnInitCmdLine(wxCmdLineParser& parser) override;
+    bool OnCmdLineParsed(wxCmdLineParser& parser) override;
+
 private:
     void InitializeLogger();
-    bool RunMigrations();
+    bool RestoreBackup();
+    void RunMigrations();
+    void OnMigrationsCompleted(bool migrated);
+    void LoadArchive();
+    void ImportTimeEntries();
+    void ExportTimeEntries();
+    void CheckDailyTotals();
+    void RefreshSnapshots();
     bool InitializeTranslations();
 
     bool FirstStartupProcedure();
+    void ReportStartupTimings();
+
+    void OnEndSession(wxCloseEvent& event);
 
     std::shared_ptr<spdlog::logger> pLogger;
     std::shared_ptr<Core::Environment> pEnv;
     std::shared_ptr<Core::Configuration> pCfg;
+    std::shared_ptr<Core::DatabaseWorker> pDatabaseWorker;
+    std::shared_ptr<Core::DataMigrationRunner> pDataMigrationRunner;
+    std::shared_ptr<Core::DatabaseBackupRunner> pDatabaseBackupRunner;
+    // only used from requests on the database worker, archives are attached to its connection
+    std::shared_ptr<Core::TimeEntryArchive> pTimeEntryArchive;
+    // closed years for reports, also only used from requests on the database worker
+    std::shared_ptr<Core::TimeEntrySnapshotStore> pTimeEntrySnapshotStore;
+    std::shared_ptr<Core::ExportJob> pExportJob;
     std::shared_ptr<UI::PersistenceManager> pPersistenceManager;
+    std::shared_ptr<Core::StartupTimer> pStartupTimer;
+    std::filesystem::path mStartupTimingsFile;
+    std::filesystem::path mTraceFile;
+    std::filesystem::path mRestoreBackupFile;
+    std::optional<int> mArchiveKeepClosedYears;
+    std::filesystem::path mImportFile;
+    std::filesystem::path mExportFile;
+    bool bVerifyDailyTotals;
+    bool bRebuildDailyTotals;
 };
 } // namespace app
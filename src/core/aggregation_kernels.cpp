@@ -0,0 +1,123 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "aggregation_kernels.h"
+
+#ifdef TKS_HAS_X86_KERNELS
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+#endif // TKS_HAS_X86_KERNELS
+
+namespace
+{
+enum class KernelLevel { Scalar, Sse42, Avx2 };
+
+KernelLevel DetectKernelLevel()
+{
+#ifdef TKS_HAS_X86_KERNELS
+#ifdef _MSC_VER
+    int info[4] = { 0 };
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse42 = (info[2] & (1 << 20)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx) {
+        // the OS has to save the upper halves of the ymm registers as well
+        const unsigned long long xcr0 = _xgetbv(0);
+        if ((xcr0 & 0x6) == 0x6) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse42 = __builtin_cpu_supports("sse4.2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif // _MSC_VER
+
+    if (avx2) {
+        return KernelLevel::Avx2;
+    }
+    if (sse42) {
+        return KernelLevel::Sse42;
+    }
+#endif // TKS_HAS_X86_KERNELS
+    return KernelLevel::Scalar;
+}
+
+KernelLevel GetKernelLevel()
+{
+    static const KernelLevel level = DetectKernelLevel();
+    return level;
+}
+} // namespace
+
+namespace app::Core
+{
+std::int64_t SumDurationsScalar(const std::int64_t* startTimes,
+    const std::int32_t* durations,
+    const std::int32_t* employerSlots,
+    std::size_t count,
+    std::int64_t from,
+    std::int64_t to,
+    std::int32_t employerSlot)
+{
+    std::int64_t total = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        const bool inRange = startTimes[i] >= from && startTimes[i] < to;
+        const bool isEmployer = employerSlot == AnyEmployerSlot || employerSlots[i] == employerSlot;
+        if (inRange && isEmployer) {
+            total += durations[i];
+        }
+    }
+    return total;
+}
+
+SumDurationsKernel GetSumDurationsKernel()
+{
+    switch (GetKernelLevel()) {
+#ifdef TKS_HAS_X86_KERNELS
+    case KernelLevel::Avx2:
+        return &SumDurationsAvx2;
+    case KernelLevel::Sse42:
+        return &SumDurationsSse42;
+#endif // TKS_HAS_X86_KERNELS
+    default:
+        return &SumDurationsScalar;
+    }
+}
+
+const char* GetSumDurationsKernelName()
+{
+    switch (GetKernelLevel()) {
+    case KernelLevel::Avx2:
+        return "avx2";
+    case KernelLevel::Sse42:
+        return "sse4.2";
+    default:
+        return "scalar";
+    }
+}
+} // namespace app::Core
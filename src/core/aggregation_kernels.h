@@ -0,0 +1,71 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace app::Core
+{
+// Matches every employer slot in the filter kernels
+constexpr std::int32_t AnyEmployerSlot = -1;
+
+// Sums the durations of the rows that start in [from, to) and belong to the employer slot.
+// Every variant returns the same result, they only differ in the instruction set they use.
+using SumDurationsKernel = std::int64_t (*)(const std::int64_t* startTimes,
+    const std::int32_t* durations,
+    const std::int32_t* employerSlots,
+    std::size_t count,
+    std::int64_t from,
+    std::int64_t to,
+    std::int32_t employerSlot);
+
+std::int64_t SumDurationsScalar(const std::int64_t* startTimes,
+    const std::int32_t* durations,
+    const std::int32_t* employerSlots,
+    std::size_t count,
+    std::int64_t from,
+    std::int64_t to,
+    std::int32_t employerSlot);
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TKS_HAS_X86_KERNELS
+
+std::int64_t SumDurationsSse42(const std::int64_t* startTimes,
+    const std::int32_t* durations,
+    const std::int32_t* employerSlots,
+    std::size_t count,
+    std::int64_t from,
+    std::int64_t to,
+    std::int32_t employerSlot);
+
+std::int64_t SumDurationsAvx2(const std::int64_t* startTimes,
+    const std::int32_t* durations,
+    const std::int32_t* employerSlots,
+    std::size_t count,
+    std::int64_t from,
+    std::int64_t to,
+    std::int32_t employerSlot);
+#endif // x86-64
+
+// Picks the widest kernel the running CPU supports, the choice is made once
+SumDurationsKernel GetSumDurationsKernel();
+const char* GetSumDurationsKernelName();
+} // namespace app::Core
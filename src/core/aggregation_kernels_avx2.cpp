@@ -0,0 +1,81 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+// Built with AVX2 enabled, only called after GetSumDurationsKernel has checked the CPU supports it
+
+#include "aggregation_kernels.h"
+
+#ifdef TKS_HAS_X86_KERNELS
+
+#include <immintrin.h>
+
+namespace app::Core
+{
+std::int64_t SumDurationsAvx2(const std::int64_t* startTimes,
+    const std::int32_t* durations,
+    const std::int32_t* employerSlots,
+    std::size_t count,
+    std::int64_t from,
+    std::int64_t to,
+    std::int32_t employerSlot)
+{
+    // start >= from is computed as !(from > start), start < to as (to > start)
+    const __m256i fromVector = _mm256_set1_epi64x(from);
+    const __m256i toVector = _mm256_set1_epi64x(to);
+    const __m256i slotVector = _mm256_set1_epi64x(employerSlot);
+    const __m256i anyEmployer = employerSlot == AnyEmployerSlot ? _mm256_set1_epi64x(-1) : _mm256_setzero_si256();
+
+    // two accumulators hide the latency of the dependent adds
+    __m256i sum0 = _mm256_setzero_si256();
+    __m256i sum1 = _mm256_setzero_si256();
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i start0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(startTimes + i));
+        const __m256i start1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(startTimes + i + 4));
+
+        const __m256i durations32 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(durations + i));
+        const __m256i duration0 = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(durations32));
+        const __m256i duration1 = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(durations32, 1));
+
+        const __m256i slots32 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(employerSlots + i));
+        const __m256i slot0 = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(slots32));
+        const __m256i slot1 = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(slots32, 1));
+
+        const __m256i inRange0 =
+            _mm256_andnot_si256(_mm256_cmpgt_epi64(fromVector, start0), _mm256_cmpgt_epi64(toVector, start0));
+        const __m256i inRange1 =
+            _mm256_andnot_si256(_mm256_cmpgt_epi64(fromVector, start1), _mm256_cmpgt_epi64(toVector, start1));
+
+        const __m256i isEmployer0 = _mm256_or_si256(anyEmployer, _mm256_cmpeq_epi64(slot0, slotVector));
+        const __m256i isEmployer1 = _mm256_or_si256(anyEmployer, _mm256_cmpeq_epi64(slot1, slotVector));
+
+        sum0 = _mm256_add_epi64(sum0, _mm256_and_si256(_mm256_and_si256(inRange0, isEmployer0), duration0));
+        sum1 = _mm256_add_epi64(sum1, _mm256_and_si256(_mm256_and_si256(inRange1, isEmployer1), duration1));
+    }
+
+    alignas(32) std::int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(sum0, sum1));
+
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+           SumDurationsScalar(startTimes + i, durations + i, employerSlots + i, count - i, from, to, employerSlot);
+}
+} // namespace app::Core
+
+#endif // TKS_HAS_X86_KERNELS
@@ -0,0 +1,66 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+// Built with SSE4.2 enabled, only called after GetSumDurationsKernel has checked the CPU supports it
+
+#include "aggregation_kernels.h"
+
+#ifdef TKS_HAS_X86_KERNELS
+
+#include <nmmintrin.h>
+
+namespace app::Core
+{
+std::int64_t SumDurationsSse42(const std::int64_t* startTimes,
+    const std::int32_t* durations,
+    const std::int32_t* employerSlots,
+    std::size_t count,
+    std::int64_t from,
+    std::int64_t to,
+    std::int32_t employerSlot)
+{
+    // start >= from is computed as !(from > start), start < to as (to > start)
+    const __m128i fromVector = _mm_set1_epi64x(from);
+    const __m128i toVector = _mm_set1_epi64x(to);
+    const __m128i slotVector = _mm_set1_epi64x(employerSlot);
+    const __m128i anyEmployer = employerSlot == AnyEmployerSlot ? _mm_set1_epi64x(-1) : _mm_setzero_si128();
+
+    __m128i sum = _mm_setzero_si128();
+
+    std::size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128i start = _mm_loadu_si128(reinterpret_cast<const __m128i*>(startTimes + i));
+        const __m128i duration = _mm_cvtepi32_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(durations + i)));
+        const __m128i slot = _mm_cvtepi32_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(employerSlots + i)));
+
+        const __m128i inRange = _mm_andnot_si128(_mm_cmpgt_epi64(fromVector, start), _mm_cmpgt_epi64(toVector, start));
+        const __m128i isEmployer = _mm_or_si128(anyEmployer, _mm_cmpeq_epi64(slot, slotVector));
+
+        sum = _mm_add_epi64(sum, _mm_and_si128(_mm_and_si128(inRange, isEmployer), duration));
+    }
+
+    alignas(16) std::int64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), sum);
+
+    return lanes[0] + lanes[1] +
+           SumDurationsScalar(startTimes + i, durations + i, employerSlots + i, count - i, from, to, employerSlot);
+}
+} // namespace app::Core
+
+#endif // TKS_HAS_X86_KERNELS
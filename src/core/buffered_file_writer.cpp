@@ -0,0 +1,155 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "buffered_file_writer.h"
+
+#include <cstring>
+#include <system_error>
+
+namespace app::Core
+{
+BufferedFileWriter::BufferedFileWriter(std::size_t bufferSize)
+    : mFile()
+    , mPartialFile()
+    , mStream()
+    , mBuffer(bufferSize)
+    , mUsed(0)
+    , mBytesWritten(0)
+    , bGood(false)
+{
+}
+
+BufferedFileWriter::~BufferedFileWriter()
+{
+    Discard();
+}
+
+bool BufferedFileWriter::Open(const std::filesystem::path& file)
+{
+    Discard();
+
+    mFile = file;
+    mPartialFile = file;
+    mPartialFile += ".part";
+
+    mStream.open(mPartialFile, std::ios::binary | std::ios::trunc);
+    mUsed = 0;
+    mBytesWritten = 0;
+    bGood = mStream.is_open();
+    return bGood;
+}
+
+void BufferedFileWriter::Write(std::string_view text)
+{
+    if (!bGood) {
+        return;
+    }
+
+    mBytesWritten += text.size();
+
+    if (text.size() > mBuffer.size() - mUsed) {
+        FlushBuffer();
+
+        // anything that does not fit an empty buffer goes straight to the file
+        if (text.size() >= mBuffer.size()) {
+            bGood = static_cast<bool>(mStream.write(text.data(), static_cast<std::streamsize>(text.size())));
+            return;
+        }
+    }
+
+    std::memcpy(mBuffer.data() + mUsed, text.data(), text.size());
+    mUsed += text.size();
+}
+
+void BufferedFileWriter::Write(char character)
+{
+    if (!bGood) {
+        return;
+    }
+
+    if (mUsed == mBuffer.size()) {
+        FlushBuffer();
+    }
+
+    mBuffer[mUsed++] = character;
+    mBytesWritten++;
+}
+
+bool BufferedFileWriter::Commit()
+{
+    if (!bGood) {
+        Discard();
+        return false;
+    }
+
+    FlushBuffer();
+    mStream.close();
+    if (!bGood || mStream.fail()) {
+        Discard();
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(mPartialFile, mFile, ec);
+    if (ec) {
+        Discard();
+        return false;
+    }
+
+    mPartialFile.clear();
+    bGood = false;
+    return true;
+}
+
+void BufferedFileWriter::Discard()
+{
+    if (mStream.is_open()) {
+        mStream.close();
+    }
+
+    if (!mPartialFile.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(mPartialFile, ec);
+        mPartialFile.clear();
+    }
+
+    mUsed = 0;
+    bGood = false;
+}
+
+bool BufferedFileWriter::Good() const
+{
+    return bGood;
+}
+
+std::uint64_t BufferedFileWriter::BytesWritten() const
+{
+    return mBytesWritten;
+}
+
+void BufferedFileWriter::FlushBuffer()
+{
+    if (mUsed == 0 || !bGood) {
+        return;
+    }
+
+    bGood = static_cast<bool>(mStream.write(mBuffer.data(), static_cast<std::streamsize>(mUsed)));
+    mUsed = 0;
+}
+} // namespace app::Core
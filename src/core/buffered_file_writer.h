@@ -0,0 +1,71 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+namespace app::Core
+{
+// Collects small writes in a fixed buffer and hands them to the file in large chunks.
+// Output goes to <file>.part and only replaces the target on Commit, so a failed or cancelled
+// write never leaves a half-written file behind under the real name.
+class BufferedFileWriter final
+{
+public:
+    static constexpr std::size_t DefaultBufferSize = 64 * 1024;
+
+    explicit BufferedFileWriter(std::size_t bufferSize = DefaultBufferSize);
+    BufferedFileWriter(const BufferedFileWriter&) = delete;
+    ~BufferedFileWriter();
+
+    BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+
+    bool Open(const std::filesystem::path& file);
+
+    void Write(std::string_view text);
+    void Write(char character);
+
+    // Flushes, closes and moves the file into place
+    bool Commit();
+
+    // Closes and deletes the partial file
+    void Discard();
+
+    // False once any write failed, later writes are ignored
+    bool Good() const;
+    std::uint64_t BytesWritten() const;
+
+private:
+    void FlushBuffer();
+
+    std::filesystem::path mFile;
+    std::filesystem::path mPartialFile;
+    std::ofstream mStream;
+    std::vector<char> mBuffer;
+    std::size_t mUsed;
+    std::uint64_t mBytesWritten;
+    bool bGood;
+};
+} // namespace app::Core
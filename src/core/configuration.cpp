@@ -19,15 +19,19 @@
 
 #include "configuration.h"
 
-#include "environment.h"
+#include <fstream>
+
+#include "trace.h"
 
 namespace app::Core
 {
 const std::string Configuration::Sections::GeneralSection = "general";
 const std::string Configuration::Sections::DatabaseSection = "database";
+const std::string Configuration::Sections::LoggingSection = "logging";
 
-Configuration::Configuration(std::shared_ptr<Environment> env, std::shared_ptr<spdlog::logger> logger)
-    : pEnv(env)
+Configuration::Configuration(const std::filesystem::path& configFile, std::shared_ptr<spdlog::logger> logger)
+    : mSettings()
+    , mConfigFile(configFile)
     , pLogger(logger)
 {
     LoadConfigFile();
@@ -35,14 +39,42 @@ Configuration::Configuration(std::shared_ptr<Environment> env, std::shared_ptr<s
 
 void Configuration::Save()
 {
+    TKS_TRACE_SCOPE("configuration/save");
     const toml::value data{
         { Sections::GeneralSection, { { "lang", mSettings.UserInterfaceLanguage } } },
-        { Sections::DatabaseSection, { { "backupPath", mSettings.DatabasePath } } },
+        { Sections::DatabaseSection,
+            {
+                { "databasePath", mSettings.DatabasePath },
+                { "backupPath", mSettings.Backup.Path },
+                { "backupIntervalHours", mSettings.Backup.IntervalHours },
+                { "backupKeepDaily", mSettings.Backup.KeepDaily },
+                { "backupKeepWeekly", mSettings.Backup.KeepWeekly },
+                { "backupPagesPerStep", mSettings.Backup.PagesPerStep },
+                { "backupStepPause", mSettings.Backup.StepPauseMilliseconds },
+                { "backupCompressionLevel", mSettings.Backup.CompressionLevel },
+                { "journalMode", mSettings.Pragmas.JournalMode },
+                { "synchronous", mSettings.Pragmas.Synchronous },
+                { "cacheSize", mSettings.Pragmas.CacheSize },
+                { "mmapSize", mSettings.Pragmas.MmapSize },
+                { "tempStore", mSettings.Pragmas.TempStore },
+                { "busyTimeout", mSettings.Pragmas.BusyTimeout },
+                { "slowQueryThreshold", mSettings.Pragmas.SlowQueryMilliseconds },
+                { "slowQueryReportsPerMinute", mSettings.Pragmas.SlowQueryReportsPerMinute },
+            } },
+        { Sections::LoggingSection,
+            {
+                { "level", mSettings.Logging.Level },
+                { "fileLevel", mSettings.Logging.FileLevel },
+                { "consoleLevel", mSettings.Logging.ConsoleLevel },
+                { "queueSize", mSettings.Logging.QueueSize },
+                { "overflowPolicy", mSettings.Logging.OverflowPolicy },
+                { "flushInterval", mSettings.Logging.FlushIntervalSeconds },
+            } },
     };
 
     const std::string configString = toml::format(data);
 
-    const std::string configFilePath = pEnv->GetConfigurationPath().u8string();
+    const std::string configFilePath = mConfigFile.u8string();
     std::ofstream configFile;
     configFile.open(configFilePath, std::ios_base::out);
     if (!configFile) {
@@ -75,11 +107,48 @@ void Configuration::SetDatabasePath(const std::string& value)
     mSettings.DatabasePath = value;
 }
 
+DatabasePragmas Configuration::GetDatabasePragmas() const
+{
+    return mSettings.Pragmas;
+}
+
+void Configuration::SetDatabasePragmas(const DatabasePragmas& value)
+{
+    mSettings.Pragmas = value;
+}
+
+BackupSettings Configuration::GetBackupSettings() const
+{
+    return mSettings.Backup;
+}
+
+void Configuration::SetBackupSettings(const BackupSettings& value)
+{
+    mSettings.Backup = value;
+}
+
+LoggingSettings Configuration::GetLoggingSettings() const
+{
+    return mSettings.Logging;
+}
+
+void Configuration::SetLoggingSettings(const LoggingSettings& value)
+{
+    mSettings.Logging = value;
+}
+
+LoggingSettings Configuration::ReadLoggingSettings(const std::filesystem::path& configFile)
+{
+    return GetLoggingConfig(toml::parse(configFile.string()));
+}
+
 void Configuration::LoadConfigFile()
 {
-    auto data = toml::parse(pEnv->GetConfigurationPath().string());
+    TKS_TRACE_SCOPE("configuration/load");
+    auto data = toml::parse(mConfigFile.string());
     GetGeneralConfig(data);
     GetDatabaseConfig(data);
+    mSettings.Logging = GetLoggingConfig(data);
 }
 
 void Configuration::GetGeneralConfig(const toml::value& config)
@@ -94,6 +163,62 @@ void Configuration::GetDatabaseConfig(const toml::value& config)
     const auto& databaseSection = toml::find(config, Sections::DatabaseSection);
 
     mSettings.DatabasePath = toml::find<std::string>(databaseSection, "databasePath");
+
+    // tuning keys are optional, anything missing keeps the built-in default
+    const DatabasePragmas defaults;
+    auto& pragmas = mSettings.Pragmas;
+    pragmas.JournalMode =
+        toml::find_or<std::string>(databaseSection, "journalMode", std::string{ defaults.JournalMode });
+    pragmas.Synchronous =
+        toml::find_or<std::string>(databaseSection, "synchronous", std::string{ defaults.Synchronous });
+    pragmas.CacheSize = toml::find_or<std::int64_t>(databaseSection, "cacheSize", std::int64_t{ defaults.CacheSize });
+    pragmas.MmapSize = toml::find_or<std::int64_t>(databaseSection, "mmapSize", std::int64_t{ defaults.MmapSize });
+    pragmas.TempStore = toml::find_or<std::string>(databaseSection, "tempStore", std::string{ defaults.TempStore });
+    pragmas.BusyTimeout = toml::find_or<int>(databaseSection, "busyTimeout", int{ defaults.BusyTimeout });
+    pragmas.SlowQueryMilliseconds =
+        toml::find_or<int>(databaseSection, "slowQueryThreshold", int{ defaults.SlowQueryMilliseconds });
+    pragmas.SlowQueryReportsPerMinute =
+        toml::find_or<int>(databaseSection, "slowQueryReportsPerMinute", int{ defaults.SlowQueryReportsPerMinute });
+
+    const BackupSettings backupDefaults;
+    auto& backup = mSettings.Backup;
+    backup.Path = toml::find_or<std::string>(databaseSection, "backupPath", std::string{});
+    // earlier versions saved the database path under this key, that never meant a backup location
+    if (backup.Path == mSettings.DatabasePath) {
+        backup.Path.clear();
+    }
+    backup.IntervalHours =
+        toml::find_or<int>(databaseSection, "backupIntervalHours", int{ backupDefaults.IntervalHours });
+    backup.KeepDaily = toml::find_or<int>(databaseSection, "backupKeepDaily", int{ backupDefaults.KeepDaily });
+    backup.KeepWeekly = toml::find_or<int>(databaseSection, "backupKeepWeekly", int{ backupDefaults.KeepWeekly });
+    backup.PagesPerStep =
+        toml::find_or<int>(databaseSection, "backupPagesPerStep", int{ backupDefaults.PagesPerStep });
+    backup.StepPauseMilliseconds =
+        toml::find_or<int>(databaseSection, "backupStepPause", int{ backupDefaults.StepPauseMilliseconds });
+    backup.CompressionLevel =
+        toml::find_or<int>(databaseSection, "backupCompressionLevel", int{ backupDefaults.CompressionLevel });
+}
+
+LoggingSettings Configuration::GetLoggingConfig(const toml::value& config)
+{
+    // the whole section is optional, older configuration files do not have it
+    const LoggingSettings defaults;
+    if (!config.contains(Sections::LoggingSection)) {
+        return defaults;
+    }
+
+    const auto& loggingSection = toml::find(config, Sections::LoggingSection);
+    LoggingSettings logging;
+    logging.Level = toml::find_or<std::string>(loggingSection, "level", std::string{ defaults.Level });
+    logging.FileLevel = toml::find_or<std::string>(loggingSection, "fileLevel", std::string{ defaults.FileLevel });
+    logging.ConsoleLevel =
+        toml::find_or<std::string>(loggingSection, "consoleLevel", std::string{ defaults.ConsoleLevel });
+    logging.QueueSize = toml::find_or<int>(loggingSection, "queueSize", int{ defaults.QueueSize });
+    logging.OverflowPolicy =
+        toml::find_or<std::string>(loggingSection, "overflowPolicy", std::string{ defaults.OverflowPolicy });
+    logging.FlushIntervalSeconds =
+        toml::find_or<int>(loggingSection, "flushInterval", int{ defaults.FlushIntervalSeconds });
+    return logging;
 }
 
 } // namespace app::Core
@@ -19,20 +19,34 @@
 
 #pragma once
 
+#include <filesystem>
 #include <string>
 #include <memory>
 
 #include <toml.hpp>
 #include <spdlog/spdlog.h>
 
+#include "database.h"
+#include "database_backup.h"
+
 namespace app::Core
 {
-class Environment;
+struct LoggingSettings {
+    // trace, debug, info, warn, err, critical or off. Level filters every message, the sink levels filter further
+    std::string Level = "info";
+    std::string FileLevel = "info";
+    std::string ConsoleLevel = "trace";
+    // Messages wait in a bounded queue for the background logging thread
+    int QueueSize = 8192;
+    // "overrun" drops the oldest queued message when the queue is full, "block" waits for room
+    std::string OverflowPolicy = "overrun";
+    int FlushIntervalSeconds = 2;
+};
 
 class Configuration
 {
 public:
-    Configuration(std::shared_ptr<Environment> env, std::shared_ptr<spdlog::logger> logger);
+    Configuration(const std::filesystem::path& configFile, std::shared_ptr<spdlog::logger> logger);
     Configuration(const Configuration&) = delete;
     ~Configuration() = default;
 
@@ -46,24 +60,41 @@ class Configuration
     std::string GetDatabasePath() const;
     void SetDatabasePath(const std::string& value);
 
+    DatabasePragmas GetDatabasePragmas() const;
+    void SetDatabasePragmas(const DatabasePragmas& value);
+
+    BackupSettings GetBackupSettings() const;
+    void SetBackupSettings(const BackupSettings& value);
+
+    LoggingSettings GetLoggingSettings() const;
+    void SetLoggingSettings(const LoggingSettings& value);
+
+    // The logger is built from these before a Configuration, which logs through it, can be created
+    static LoggingSettings ReadLoggingSettings(const std::filesystem::path& configFile);
+
 private:
     void LoadConfigFile();
 
     void GetGeneralConfig(const toml::value& config);
     void GetDatabaseConfig(const toml::value& config);
+    static LoggingSettings GetLoggingConfig(const toml::value& config);
 
     struct Sections {
         static const std::string GeneralSection;
         static const std::string DatabaseSection;
+        static const std::string LoggingSection;
     };
 
     struct Settings {
         std::string UserInterfaceLanguage;
         std::string DatabasePath;
+        DatabasePragmas Pragmas;
+        BackupSettings Backup;
+        LoggingSettings Logging;
     };
 
     Settings mSettings;
-    std::shared_ptr<Environment> pEnv;
+    std::filesystem::path mConfigFile;
     std::shared_ptr<spdlog::logger> pLogger;
 };
 } // namespace app::Core
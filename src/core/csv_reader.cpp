@@ -0,0 +1,229 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "csv_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TKS_HAS_SSE2_SCAN
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+#endif // SSE2
+
+namespace app::Core
+{
+namespace
+{
+#ifdef TKS_HAS_SSE2_SCAN
+unsigned CountTrailingZeros(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif // _MSC_VER
+}
+#endif // TKS_HAS_SSE2_SCAN
+
+// First comma, carriage return or line feed in [position, end), or end
+const char* FindFieldEnd(const char* position, const char* end)
+{
+#ifdef TKS_HAS_SSE2_SCAN
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    const __m128i lineFeed = _mm_set1_epi8('\n');
+
+    while (end - position >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+        const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, lineFeed)),
+            _mm_cmpeq_epi8(chunk, carriageReturn));
+
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask != 0) {
+            return position + CountTrailingZeros(mask);
+        }
+        position += 16;
+    }
+#endif // TKS_HAS_SSE2_SCAN
+
+    while (position != end && *position != ',' && *position != '\r' && *position != '\n') {
+        position++;
+    }
+    return position;
+}
+
+const char* Find(const char* position, const char* end, char character)
+{
+    auto found = static_cast<const char*>(std::memchr(position, character, static_cast<std::size_t>(end - position)));
+    return found != nullptr ? found : end;
+}
+} // namespace
+
+CsvReader::CsvReader(std::string_view data)
+    : pBegin(data.data())
+    , pPosition(data.data())
+    , pEnd(data.data() + data.size())
+    , mLine(0)
+    , mNextLine(1)
+    , pError(nullptr)
+    , mQuoted()
+    , mUnescaped()
+    , mUnescapedUsed(0)
+{
+    // a UTF-8 byte order mark is not part of the first field
+    if (data.size() >= 3 && std::memcmp(pPosition, "\xEF\xBB\xBF", 3) == 0) {
+        pPosition += 3;
+    }
+}
+
+CsvReader::Status CsvReader::Next(std::vector<std::string_view>& fields)
+{
+    fields.clear();
+    mQuoted.clear();
+    mUnescapedUsed = 0;
+    pError = nullptr;
+
+    if (pPosition == pEnd) {
+        return Status::End;
+    }
+
+    mLine = mNextLine;
+    while (true) {
+        if (pPosition != pEnd && *pPosition == '"') {
+            const char* begin = ++pPosition;
+            bool hasEscapes = false;
+
+            const char* quote = Find(pPosition, pEnd, '"');
+            while (quote != pEnd && quote + 1 != pEnd && quote[1] == '"') {
+                hasEscapes = true;
+                quote = Find(quote + 2, pEnd, '"');
+            }
+
+            mNextLine += std::count(begin, quote, '\n');
+            if (quote == pEnd) {
+                pPosition = pEnd;
+                pError = "unterminated quoted field";
+                return Status::Malformed;
+            }
+
+            fields.push_back(hasEscapes ? Unescape(begin, quote) : std::string_view(begin, quote - begin));
+            mQuoted.push_back(true);
+            pPosition = quote + 1;
+
+            if (pPosition == pEnd) {
+                return Status::Record;
+            }
+            if (*pPosition == ',') {
+                pPosition++;
+                continue;
+            }
+            if (*pPosition == '\r' || *pPosition == '\n') {
+                ConsumeLineEnd();
+                return Status::Record;
+            }
+
+            SkipLine();
+            pError = "unexpected character after a closing quote";
+            return Status::Malformed;
+        }
+
+        const char* fieldEnd = FindFieldEnd(pPosition, pEnd);
+        fields.emplace_back(pPosition, static_cast<std::size_t>(fieldEnd - pPosition));
+        mQuoted.push_back(false);
+        pPosition = fieldEnd;
+
+        if (pPosition == pEnd) {
+            return Status::Record;
+        }
+        if (*pPosition == ',') {
+            pPosition++;
+            continue;
+        }
+
+        ConsumeLineEnd();
+        return Status::Record;
+    }
+}
+
+bool CsvReader::IsQuoted(std::size_t index) const
+{
+    return index < mQuoted.size() && mQuoted[index];
+}
+
+std::int64_t CsvReader::Line() const
+{
+    return mLine;
+}
+
+const char* CsvReader::Error() const
+{
+    return pError;
+}
+
+std::size_t CsvReader::BytesRead() const
+{
+    return static_cast<std::size_t>(pPosition - pBegin);
+}
+
+std::size_t CsvReader::Size() const
+{
+    return static_cast<std::size_t>(pEnd - pBegin);
+}
+
+std::string_view CsvReader::Unescape(const char* begin, const char* end)
+{
+    if (mUnescapedUsed == mUnescaped.size()) {
+        mUnescaped.emplace_back();
+    }
+
+    std::string& text = mUnescaped[mUnescapedUsed++];
+    text.clear();
+    for (const char* position = begin; position != end; position++) {
+        text += *position;
+        if (*position == '"') {
+            position++;
+        }
+    }
+    return text;
+}
+
+void CsvReader::ConsumeLineEnd()
+{
+    if (pPosition != pEnd && *pPosition == '\r') {
+        pPosition++;
+    }
+    if (pPosition != pEnd && *pPosition == '\n') {
+        pPosition++;
+    }
+    mNextLine++;
+}
+
+void CsvReader::SkipLine()
+{
+    const char* lineFeed = Find(pPosition, pEnd, '\n');
+    pPosition = lineFeed == pEnd ? pEnd : lineFeed + 1;
+    mNextLine++;
+}
+} // namespace app::Core
@@ -0,0 +1,76 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace app::Core
+{
+// Splits RFC 4180 CSV text into records without copying it. Fields are views into the input, except quoted
+// fields with doubled quotes, which are unescaped into storage that lives until the next record is read.
+//
+// Delimiters and line ends are found 16 bytes at a time with SSE2, which every x86-64 CPU has, and quotes with
+// memchr, which the C libraries already vectorize. Other targets fall back to a scalar scan.
+class CsvReader final
+{
+public:
+    enum class Status { Record, Malformed, End };
+
+    explicit CsvReader(std::string_view data);
+    CsvReader(const CsvReader&) = delete;
+    ~CsvReader() = default;
+
+    CsvReader& operator=(const CsvReader&) = delete;
+
+    // Reads the next record into fields. A malformed record is skipped up to the end of its line and
+    // Error() says why, reading can carry on with the next record.
+    Status Next(std::vector<std::string_view>& fields);
+
+    // Whether the field at index of the last record was enclosed in quotes
+    bool IsQuoted(std::size_t index) const;
+
+    // Line the last record started on, counting from 1
+    std::int64_t Line() const;
+    const char* Error() const;
+
+    std::size_t BytesRead() const;
+    std::size_t Size() const;
+
+private:
+    std::string_view Unescape(const char* begin, const char* end);
+    void ConsumeLineEnd();
+    void SkipLine();
+
+    const char* pBegin;
+    const char* pPosition;
+    const char* pEnd;
+    std::int64_t mLine;
+    std::int64_t mNextLine;
+    const char* pError;
+    std::vector<bool> mQuoted;
+    std::deque<std::string> mUnescaped;
+    std::size_t mUnescapedUsed;
+};
+} // namespace app::Core
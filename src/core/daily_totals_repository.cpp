@@ -0,0 +1,159 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "daily_totals_repository.h"
+
+#include "database.h"
+
+namespace app::Core
+{
+const std::string DailyTotalsRepository::SelectDailyTotalsQuery =
+    "SELECT employer_id, day, total_duration, entry_count "
+    "FROM employer_daily_totals "
+    "WHERE day BETWEEN ? AND ? "
+    "ORDER BY day, employer_id;";
+const std::string DailyTotalsRepository::SelectEmployerTotalsQuery =
+    "SELECT employer_id, SUM(total_duration), SUM(entry_count) "
+    "FROM employer_daily_totals "
+    "WHERE day BETWEEN ? AND ? "
+    "GROUP BY employer_id "
+    "ORDER BY employer_id;";
+// the totals of archived years stay as they were archived, their rows are no longer in time_entries
+const std::string DailyTotalsRepository::DeleteUnarchivedQuery =
+    "DELETE FROM employer_daily_totals "
+    "WHERE CAST(substr(day, 1, 4) AS INTEGER) NOT IN (SELECT year FROM archived_years);";
+const std::string DailyTotalsRepository::RebuildQuery =
+    "INSERT INTO employer_daily_totals (employer_id, day, total_duration, entry_count) "
+    "SELECT employer_id, coalesce(day, date(start_time, 'unixepoch', 'localtime')), SUM(duration), COUNT(*) "
+    "FROM time_entries "
+    "GROUP BY 1, 2;";
+const std::string DailyTotalsRepository::VerifyQuery =
+    "WITH expected AS ("
+    "    SELECT employer_id, coalesce(day, date(start_time, 'unixepoch', 'localtime')) AS day, "
+    "    SUM(duration) AS total_duration, COUNT(*) AS entry_count "
+    "    FROM time_entries "
+    "    GROUP BY 1, 2"
+    ") "
+    "SELECT e.employer_id, e.day, e.total_duration, e.entry_count, "
+    "coalesce(a.total_duration, 0), coalesce(a.entry_count, 0) "
+    "FROM expected e "
+    "LEFT JOIN employer_daily_totals a ON a.employer_id = e.employer_id AND a.day = e.day "
+    "WHERE a.total_duration IS NOT e.total_duration OR a.entry_count IS NOT e.entry_count "
+    "UNION ALL "
+    "SELECT a.employer_id, a.day, 0, 0, a.total_duration, a.entry_count "
+    "FROM employer_daily_totals a "
+    "WHERE NOT EXISTS (SELECT 1 FROM expected e WHERE e.employer_id = a.employer_id AND e.day = a.day) "
+    "AND CAST(substr(a.day, 1, 4) AS INTEGER) NOT IN (SELECT year FROM archived_years);";
+
+DailyTotalsRepository::DailyTotalsRepository(std::shared_ptr<Database> database,
+    std::shared_ptr<spdlog::logger> logger)
+    : pDatabase(database)
+    , pLogger(logger)
+{
+}
+
+bool DailyTotalsRepository::GetDailyTotals(const std::string& fromDay,
+    const std::string& toDay,
+    std::vector<DailyTotal>& totals)
+{
+    auto stmt = pDatabase->Prepare(SelectDailyTotalsQuery);
+    if (!stmt || !stmt.Bind(fromDay, toDay)) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    while (stmt.Step()) {
+        totals.push_back(stmt.RowAs<DailyTotal, std::int64_t, std::string, std::int64_t, std::int64_t>());
+    }
+
+    if (stmt.HasError()) {
+        pLogger->error("Failed to read daily totals {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    return true;
+}
+
+bool DailyTotalsRepository::GetEmployerTotals(const std::string& fromDay,
+    const std::string& toDay,
+    std::vector<EmployerTotal>& totals)
+{
+    auto stmt = pDatabase->Prepare(SelectEmployerTotalsQuery);
+    if (!stmt || !stmt.Bind(fromDay, toDay)) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    while (stmt.Step()) {
+        totals.push_back(stmt.RowAs<EmployerTotal, std::int64_t, std::int64_t, std::int64_t>());
+    }
+
+    if (stmt.HasError()) {
+        pLogger->error("Failed to read employer totals {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    return true;
+}
+
+bool DailyTotalsRepository::Rebuild()
+{
+    Transaction transaction(*pDatabase);
+    if (!transaction.IsActive()) {
+        return false;
+    }
+
+    if (!pDatabase->Execute(DeleteUnarchivedQuery) || !pDatabase->Execute(RebuildQuery)) {
+        pLogger->error("Failed to rebuild daily totals");
+        return false;
+    }
+
+    return transaction.Commit();
+}
+
+bool DailyTotalsRepository::Verify(std::vector<DailyTotalMismatch>& mismatches)
+{
+    auto stmt = pDatabase->PrepareUncached(VerifyQuery);
+    if (!stmt) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    while (stmt.Step()) {
+        mismatches.push_back(stmt.RowAs<DailyTotalMismatch,
+            std::int64_t,
+            std::string,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t>());
+    }
+
+    if (stmt.HasError()) {
+        pLogger->error("Failed to verify daily totals {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    if (!mismatches.empty()) {
+        pLogger->warn("Daily totals differ from time entries on {0} rows", mismatches.size());
+    }
+
+    return true;
+}
+} // namespace app::Core
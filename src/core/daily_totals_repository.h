@@ -0,0 +1,88 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace app::Core
+{
+class Database;
+
+// Days are local dates formatted as YYYY-MM-DD
+struct DailyTotal {
+    std::int64_t employerId;
+    std::string day;
+    std::int64_t totalDuration;
+    std::int64_t entryCount;
+};
+
+struct EmployerTotal {
+    std::int64_t employerId;
+    std::int64_t totalDuration;
+    std::int64_t entryCount;
+};
+
+struct DailyTotalMismatch {
+    std::int64_t employerId;
+    std::string day;
+    std::int64_t expectedDuration;
+    std::int64_t expectedCount;
+    std::int64_t actualDuration;
+    std::int64_t actualCount;
+};
+
+// Reads the employer_daily_totals summary that the time_entries triggers maintain
+class DailyTotalsRepository final
+{
+public:
+    DailyTotalsRepository(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger);
+    DailyTotalsRepository(const DailyTotalsRepository&) = delete;
+    ~DailyTotalsRepository() = default;
+
+    DailyTotalsRepository& operator=(const DailyTotalsRepository&) = delete;
+
+    // Reads the per-day totals for the inclusive day range
+    bool GetDailyTotals(const std::string& fromDay, const std::string& toDay, std::vector<DailyTotal>& totals);
+
+    // Reads the totals per employer for the inclusive day range, e.g. this week, month or year
+    bool GetEmployerTotals(const std::string& fromDay, const std::string& toDay, std::vector<EmployerTotal>& totals);
+
+    // Recomputes the summary from time_entries, except for archived years
+    bool Rebuild();
+
+    // Compares the summary against a full recompute and reports every row that differs, archived years are skipped
+    bool Verify(std::vector<DailyTotalMismatch>& mismatches);
+
+private:
+    std::shared_ptr<Database> pDatabase;
+    std::shared_ptr<spdlog::logger> pLogger;
+
+    static const std::string SelectDailyTotalsQuery;
+    static const std::string SelectEmployerTotalsQuery;
+    static const std::string DeleteUnarchivedQuery;
+    static const std::string RebuildQuery;
+    static const std::string VerifyQuery;
+};
+} // namespace app::Core
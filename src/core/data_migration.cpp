@@ -0,0 +1,227 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "data_migration.h"
+
+#include <unordered_map>
+
+namespace app::Core
+{
+const std::string DataMigrationRunner::SelectProgressQuery =
+    "SELECT name, progress, is_complete FROM migration_history WHERE progress IS NOT NULL;";
+const std::string DataMigrationRunner::InsertProgressQuery =
+    "INSERT INTO migration_history (name, progress, is_complete) VALUES (?, 0, 0);";
+const std::string DataMigrationRunner::UpdateProgressQuery =
+    "UPDATE migration_history SET progress = ? WHERE name = ?;";
+const std::string DataMigrationRunner::CompleteMigrationQuery =
+    "UPDATE migration_history SET is_complete = 1 WHERE name = ?;";
+const int DataMigrationRunner::BatchSize = 2000;
+const std::chrono::milliseconds DataMigrationRunner::BatchPause = std::chrono::milliseconds(20);
+
+const std::vector<DataMigration>& DataMigrationRunner::GetDataMigrations()
+{
+    // applied in order, after all schema migrations
+    static const std::vector<DataMigration> migrations = {
+        // entries written before 20230501090000_store_time_entry_day have no stored day. Filling it in on its own
+        // does not fire the daily totals triggers, the totals of these rows were keyed on the same expression.
+        { "20230501090001_backfill_time_entry_day",
+            "time_entries",
+            "UPDATE time_entries SET day = date(start_time, 'unixepoch', 'localtime') "
+            "WHERE rowid > ?1 AND rowid <= ?2 AND day IS NULL;" },
+    };
+    return migrations;
+}
+
+DataMigrationRunner::DataMigrationRunner(std::filesystem::path databaseFile,
+    DatabasePragmas pragmas,
+    std::shared_ptr<spdlog::logger> logger)
+    : mDatabaseFile(std::move(databaseFile))
+    , mPragmas(std::move(pragmas))
+    , pLogger(logger)
+    , mThread()
+    , bRunning(false)
+    , bStopRequested(false)
+{
+}
+
+DataMigrationRunner::~DataMigrationRunner()
+{
+    Stop();
+}
+
+void DataMigrationRunner::Start()
+{
+    if (GetDataMigrations().empty() || mThread.joinable()) {
+        return;
+    }
+
+    bStopRequested = false;
+    bRunning = true;
+    mThread = std::thread(&DataMigrationRunner::Run, this);
+}
+
+void DataMigrationRunner::Stop()
+{
+    bStopRequested = true;
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+bool DataMigrationRunner::IsRunning() const
+{
+    return bRunning;
+}
+
+void DataMigrationRunner::Run()
+{
+    Database database(pLogger, mPragmas);
+    if (!database.Open(mDatabaseFile)) {
+        bRunning = false;
+        return;
+    }
+
+    std::unordered_map<std::string, Progress> progress;
+    {
+        auto stmt = database.Prepare(SelectProgressQuery);
+        while (stmt.Step()) {
+            progress.emplace(
+                stmt.Column<std::string>(0), Progress{ stmt.Column<std::int64_t>(1), stmt.Column<bool>(2) });
+        }
+
+        if (stmt.HasError()) {
+            pLogger->error("Failed to read data migration progress {0}", stmt.ErrorMessage());
+            bRunning = false;
+            return;
+        }
+    }
+
+    for (const auto& migration : GetDataMigrations()) {
+        if (bStopRequested) {
+            break;
+        }
+
+        const std::string name(migration.name);
+        auto current = progress.find(name);
+        if (current != progress.end() && current->second.isComplete) {
+            continue;
+        }
+
+        std::int64_t lastRowId = 0;
+        if (current != progress.end()) {
+            lastRowId = current->second.lastRowId;
+            pLogger->info("Resuming data migration {0} after row {1}", name, lastRowId);
+        } else {
+            auto stmt = database.Prepare(InsertProgressQuery);
+            if (!stmt || !stmt.Bind(name) || !stmt.Execute()) {
+                pLogger->error("Failed to record data migration {0} - ({1})", name, stmt.ErrorMessage());
+                break;
+            }
+            pLogger->info("Starting data migration {0}", name);
+        }
+
+        if (!RunMigration(database, migration, lastRowId)) {
+            break;
+        }
+    }
+
+    bRunning = false;
+}
+
+bool DataMigrationRunner::RunMigration(Database& database, const DataMigration& migration, std::int64_t lastRowId)
+{
+    const std::string name(migration.name);
+    const std::string batchQuery(migration.batchSql);
+    const std::string nextBatchQuery = "SELECT max(rowid) FROM (SELECT rowid FROM " + std::string(migration.table) +
+                                       " WHERE rowid > ? ORDER BY rowid LIMIT ?);";
+
+    while (!bStopRequested) {
+        std::int64_t upperRowId = 0;
+        if (!SelectNextBatch(database, nextBatchQuery, lastRowId, upperRowId)) {
+            return false;
+        }
+
+        // short transactions keep the write lock free for the UI between batches
+        Transaction transaction(database);
+        if (!transaction.IsActive()) {
+            return false;
+        }
+
+        if (upperRowId == 0) {
+            auto stmt = database.Prepare(CompleteMigrationQuery);
+            if (!stmt || !stmt.Bind(name) || !stmt.Execute()) {
+                pLogger->error("Failed to complete data migration {0} - ({1})", name, stmt.ErrorMessage());
+                return false;
+            }
+
+            if (!transaction.Commit()) {
+                return false;
+            }
+
+            pLogger->info("Completed data migration {0}", name);
+            return true;
+        }
+
+        {
+            auto stmt = database.Prepare(batchQuery);
+            if (!stmt || !stmt.Bind(lastRowId, upperRowId) || !stmt.Execute()) {
+                pLogger->error("Data migration {0} failed on rows {1}-{2} - ({3})",
+                    name,
+                    lastRowId,
+                    upperRowId,
+                    stmt.ErrorMessage());
+                return false;
+            }
+        }
+
+        {
+            auto stmt = database.Prepare(UpdateProgressQuery);
+            if (!stmt || !stmt.Bind(upperRowId, name) || !stmt.Execute()) {
+                pLogger->error("Failed to record data migration progress {0} - ({1})", name, stmt.ErrorMessage());
+                return false;
+            }
+        }
+
+        if (!transaction.Commit()) {
+            return false;
+        }
+
+        lastRowId = upperRowId;
+        std::this_thread::sleep_for(BatchPause);
+    }
+
+    return false;
+}
+
+bool DataMigrationRunner::SelectNextBatch(Database& database,
+    const std::string& nextBatchQuery,
+    std::int64_t lastRowId,
+    std::int64_t& upperRowId)
+{
+    auto stmt = database.Prepare(nextBatchQuery);
+    if (!stmt || !stmt.Bind(lastRowId, BatchSize) || !stmt.Step()) {
+        pLogger->error("Failed to select next data migration batch {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    // max() over no rows is NULL, which reads as 0 and means there is nothing left
+    upperRowId = stmt.Column<std::int64_t>(0);
+    return true;
+}
+} // namespace app::Core
@@ -0,0 +1,94 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "database.h"
+
+namespace app::Core
+{
+// A backfill that walks a table in rowid order, one bounded batch per transaction.
+// The batch query is bound with the exclusive lower rowid as ?1 and the inclusive upper rowid as ?2.
+struct DataMigration {
+    std::string_view name;
+    std::string_view table;
+    std::string_view batchSql;
+};
+
+// Runs pending data migrations on a background thread with its own connection.
+// Progress is committed with every batch, so an interrupted migration resumes where it stopped.
+class DataMigrationRunner final
+{
+public:
+    DataMigrationRunner(std::filesystem::path databaseFile,
+        DatabasePragmas pragmas,
+        std::shared_ptr<spdlog::logger> logger);
+    DataMigrationRunner(const DataMigrationRunner&) = delete;
+    ~DataMigrationRunner();
+
+    DataMigrationRunner& operator=(const DataMigrationRunner&) = delete;
+
+    void Start();
+    void Stop();
+
+    bool IsRunning() const;
+
+    static const std::vector<DataMigration>& GetDataMigrations();
+
+private:
+    struct Progress {
+        std::int64_t lastRowId;
+        bool isComplete;
+    };
+
+    void Run();
+    bool RunMigration(Database& database, const DataMigration& migration, std::int64_t lastRowId);
+    bool SelectNextBatch(Database& database,
+        const std::string& nextBatchQuery,
+        std::int64_t lastRowId,
+        std::int64_t& upperRowId);
+
+    std::filesystem::path mDatabaseFile;
+    DatabasePragmas mPragmas;
+    std::shared_ptr<spdlog::logger> pLogger;
+
+    std::thread mThread;
+    std::atomic<bool> bRunning;
+    std::atomic<bool> bStopRequested;
+
+    static const std::string SelectProgressQuery;
+    static const std::string InsertProgressQuery;
+    static const std::string UpdateProgressQuery;
+    static const std::string CompleteMigrationQuery;
+    static const int BatchSize;
+    static const std::chrono::milliseconds BatchPause;
+};
+} // namespace app::Core
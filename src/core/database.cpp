@@ -0,0 +1,424 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "database.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iterator>
+#include <vector>
+
+#include "metrics.h"
+
+namespace
+{
+bool IsOneOf(std::string value, const std::vector<std::string>& allowed)
+{
+    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return std::toupper(c); });
+    return std::find(allowed.begin(), allowed.end(), value) != allowed.end();
+}
+} // namespace
+
+namespace app::Core
+{
+const std::string Database::ForeignKeysPragma = "PRAGMA foreign_keys = ON;";
+const std::string Database::ExplainQueryPlanQuery = "EXPLAIN QUERY PLAN ";
+const std::size_t Database::MaxLoggedSqlLength = 2000;
+
+const std::string Transaction::BeginQuery = "BEGIN IMMEDIATE TRANSACTION";
+const std::string Transaction::CommitQuery = "COMMIT";
+const std::string Transaction::RollbackQuery = "ROLLBACK";
+
+Database::Database(std::shared_ptr<spdlog::logger> logger, DatabasePragmas pragmas)
+    : pDb(nullptr)
+    , pLogger(logger)
+    , mPragmas(std::move(pragmas))
+    , mStatementCache()
+    , mDetachedStatements()
+    , mSlowQueries()
+{
+}
+
+Database::~Database()
+{
+    Close();
+
+    if (!mDetachedStatements.empty()) {
+        pLogger->critical("Database destroyed while {0} statements are still held", mDetachedStatements.size());
+    }
+}
+
+bool Database::Open(const std::filesystem::path& databaseFile)
+{
+    if (IsOpen()) {
+        return true;
+    }
+
+    const std::string databaseFilePath = databaseFile.u8string();
+    // URI filenames let archives be attached read-only
+    int rc = sqlite3_open_v2(databaseFilePath.c_str(),
+        &pDb,
+        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI,
+        nullptr);
+    if (rc != SQLITE_OK) {
+        pLogger->error("Failed to open database {0} - ({1})", databaseFilePath, sqlite3_errmsg(pDb));
+        sqlite3_close(pDb);
+        pDb = nullptr;
+        return false;
+    }
+
+    if (!Execute(ForeignKeysPragma)) {
+        return false;
+    }
+
+    if (mPragmas.SlowQueryMilliseconds > 0) {
+        sqlite3_trace_v2(pDb, SQLITE_TRACE_PROFILE, &Database::OnTrace, this);
+    }
+
+    return ApplyPragmas();
+}
+
+void Database::Close()
+{
+    if (pDb != nullptr) {
+        ReportSlowQueries();
+    }
+
+    ClearStatementCache();
+
+    if (pDb != nullptr) {
+        if (!mDetachedStatements.empty()) {
+            pLogger->warn("Closing database while {0} statements are still held, the connection is closed once they "
+                          "are released",
+                mDetachedStatements.size());
+        }
+
+        // unlike sqlite3_close, this does not fail while statements are outstanding, the connection stays open
+        // until the last one is finalized
+        sqlite3_close_v2(pDb);
+        pDb = nullptr;
+    }
+}
+
+bool Database::IsOpen() const
+{
+    return pDb != nullptr;
+}
+
+sqlite3* Database::Handle() const
+{
+    return pDb;
+}
+
+Statement Database::Prepare(const std::string& query)
+{
+    static auto& hits = MetricsRegistry::GetInstance().GetCounter("sqlite.statement_cache.hits");
+    static auto& misses = MetricsRegistry::GetInstance().GetCounter("sqlite.statement_cache.misses");
+    ReportSlowQueries();
+    FinalizeReleasedStatements();
+
+    auto cached = mStatementCache.find(query);
+    if (cached != mStatementCache.end()) {
+        if (cached->second.inUse) {
+            misses.Add();
+            return PrepareUncached(query);
+        }
+        hits.Add();
+        return Statement(pDb, cached->second.stmt, &cached->second.inUse);
+    }
+    misses.Add();
+
+    sqlite3_stmt* stmt = PrepareStatement(query, SQLITE_PREPARE_PERSISTENT);
+    if (stmt == nullptr) {
+        return Statement(pDb, nullptr);
+    }
+
+    auto inserted = mStatementCache.emplace(query, CachedStatement{ stmt, false });
+    return Statement(pDb, stmt, &inserted.first->second.inUse);
+}
+
+Statement Database::PrepareUncached(const std::string& query)
+{
+    ReportSlowQueries();
+
+    sqlite3_stmt* stmt = PrepareStatement(query, 0);
+    if (stmt == nullptr) {
+        return Statement(pDb, nullptr);
+    }
+
+    return Statement(pDb, stmt);
+}
+
+bool Database::Execute(const std::string& query)
+{
+    static auto& latency = MetricsRegistry::GetInstance().GetHistogram("sqlite.exec");
+    static auto& errors = MetricsRegistry::GetInstance().GetCounter("sqlite.errors");
+    ReportSlowQueries();
+
+    char* err = nullptr;
+    int rc = SQLITE_OK;
+    {
+        const ScopedLatency timer(latency);
+        rc = sqlite3_exec(pDb, query.c_str(), nullptr, nullptr, &err);
+    }
+    if (rc != SQLITE_OK) {
+        errors.Add();
+        pLogger->error("Error when executing statement {0} - ({1})", query, err != nullptr ? err : "");
+        sqlite3_free(err);
+        return false;
+    }
+
+    return true;
+}
+
+void Database::ClearStatementCache()
+{
+    for (auto it = mStatementCache.begin(); it != mStatementCache.end();) {
+        if (it->second.inUse) {
+            // finalizing it now would leave its handle resetting a freed statement
+            auto next = std::next(it);
+            mDetachedStatements.push_back(mStatementCache.extract(it));
+            it = next;
+        } else {
+            sqlite3_finalize(it->second.stmt);
+            it = mStatementCache.erase(it);
+        }
+    }
+
+    FinalizeReleasedStatements();
+}
+
+void Database::FinalizeReleasedStatements()
+{
+    auto released = std::partition(mDetachedStatements.begin(),
+        mDetachedStatements.end(),
+        [](const StatementCache::node_type& node) { return node.mapped().inUse; });
+    for (auto it = released; it != mDetachedStatements.end(); ++it) {
+        sqlite3_finalize(it->mapped().stmt);
+    }
+    mDetachedStatements.erase(released, mDetachedStatements.end());
+}
+
+sqlite3_stmt* Database::PrepareStatement(const std::string& query, unsigned int flags)
+{
+    static auto& latency = MetricsRegistry::GetInstance().GetHistogram("sqlite.prepare");
+    static auto& errors = MetricsRegistry::GetInstance().GetCounter("sqlite.errors");
+
+    sqlite3_stmt* stmt = nullptr;
+    int rc = SQLITE_OK;
+    {
+        const ScopedLatency timer(latency);
+        rc = sqlite3_prepare_v3(pDb, query.c_str(), static_cast<int>(query.size()), flags, &stmt, nullptr);
+    }
+    if (rc != SQLITE_OK) {
+        errors.Add();
+        pLogger->error("Failed to prepare statement {0} - ({1})", query, sqlite3_errmsg(pDb));
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+
+    return stmt;
+}
+
+bool Database::ApplyPragmas()
+{
+    // string values end up in the query text, so only accept the keywords SQLite knows about
+    if (IsOneOf(mPragmas.JournalMode, { "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF" })) {
+        ApplyPragma("journal_mode", mPragmas.JournalMode);
+    } else {
+        pLogger->warn("Ignoring invalid journal mode {0}", mPragmas.JournalMode);
+    }
+
+    if (IsOneOf(mPragmas.Synchronous, { "OFF", "NORMAL", "FULL", "EXTRA", "0", "1", "2", "3" })) {
+        ApplyPragma("synchronous", mPragmas.Synchronous);
+    } else {
+        pLogger->warn("Ignoring invalid synchronous setting {0}", mPragmas.Synchronous);
+    }
+
+    if (IsOneOf(mPragmas.TempStore, { "DEFAULT", "FILE", "MEMORY", "0", "1", "2" })) {
+        ApplyPragma("temp_store", mPragmas.TempStore);
+    } else {
+        pLogger->warn("Ignoring invalid temp store setting {0}", mPragmas.TempStore);
+    }
+
+    ApplyPragma("cache_size", std::to_string(mPragmas.CacheSize));
+    ApplyPragma("mmap_size", std::to_string(mPragmas.MmapSize));
+
+    if (sqlite3_busy_timeout(pDb, mPragmas.BusyTimeout) != SQLITE_OK) {
+        pLogger->warn("Failed to set busy timeout {0} - ({1})", mPragmas.BusyTimeout, sqlite3_errmsg(pDb));
+    }
+
+    pLogger->info("Database pragmas: journal_mode={0} synchronous={1} cache_size={2} mmap_size={3} temp_store={4} "
+                  "busy_timeout={5}",
+        QueryPragma("journal_mode"),
+        QueryPragma("synchronous"),
+        QueryPragma("cache_size"),
+        QueryPragma("mmap_size"),
+        QueryPragma("temp_store"),
+        QueryPragma("busy_timeout"));
+
+    return true;
+}
+
+bool Database::ApplyPragma(const std::string& name, const std::string& value)
+{
+    // some pragmas report their new value as a row, so step through rather than using Execute
+    auto stmt = PrepareUncached("PRAGMA " + name + " = " + value + ";");
+    if (!stmt || !stmt.Execute()) {
+        pLogger->warn("Failed to set pragma {0} to {1} - ({2})", name, value, stmt.ErrorMessage());
+        return false;
+    }
+
+    return true;
+}
+
+std::string Database::QueryPragma(const std::string& name)
+{
+    auto stmt = PrepareUncached("PRAGMA " + name + ";");
+    if (!stmt || !stmt.Step()) {
+        return "n/a";
+    }
+
+    return stmt.Column<std::string>(0);
+}
+
+int Database::OnTrace(unsigned int type, void* context, void* statement, void* elapsed)
+{
+    static auto& slowStatements = MetricsRegistry::GetInstance().GetCounter("sqlite.slow_statements");
+
+    if (type != SQLITE_TRACE_PROFILE) {
+        return 0;
+    }
+
+    auto database = static_cast<Database*>(context);
+    const std::chrono::nanoseconds duration(*static_cast<sqlite3_int64*>(elapsed));
+    if (duration < std::chrono::milliseconds(database->mPragmas.SlowQueryMilliseconds)) {
+        return 0;
+    }
+    slowStatements.Add();
+
+    auto stmt = static_cast<sqlite3_stmt*>(statement);
+    const char* sql = sqlite3_sql(stmt);
+    SlowQueryReport report{ sql != nullptr ? sql : "", {}, duration, 0, std::chrono::nanoseconds(0) };
+    if (!SlowQueryLog::GetInstance().Admit(
+            report.sql, duration, database->mPragmas.SlowQueryReportsPerMinute, report)) {
+        return 0;
+    }
+
+    char* expanded = sqlite3_expanded_sql(stmt);
+    report.expandedSql = expanded != nullptr ? expanded : report.sql;
+    sqlite3_free(expanded);
+
+    // the connection must not run statements from inside its own trace callback, so the query plan is looked up
+    // by ReportSlowQueries before the next statement is prepared or executed
+    database->mSlowQueries.push_back(std::move(report));
+    return 0;
+}
+
+void Database::ReportSlowQueries()
+{
+    if (mSlowQueries.empty()) {
+        return;
+    }
+
+    // explaining prepares statements of its own, which report again, so take the pending reports first
+    std::vector<SlowQueryReport> reports;
+    reports.swap(mSlowQueries);
+
+    for (const auto& report : reports) {
+        const std::string sql = report.expandedSql.size() > MaxLoggedSqlLength
+                                    ? report.expandedSql.substr(0, MaxLoggedSqlLength) + "..."
+                                    : report.expandedSql;
+        pLogger->warn("Slow statement took {0}ms ({1} slow runs since the last report, slowest {2}ms): {3}\n{4}",
+            std::chrono::duration_cast<std::chrono::milliseconds>(report.duration).count(),
+            report.occurrences,
+            std::chrono::duration_cast<std::chrono::milliseconds>(report.maxDuration).count(),
+            sql,
+            ExplainQueryPlan(report.sql));
+    }
+}
+
+std::string Database::ExplainQueryPlan(const std::string& query)
+{
+    auto stmt = PrepareUncached(ExplainQueryPlanQuery + query);
+    if (!stmt) {
+        return "Query plan not available";
+    }
+
+    // rows come depth first as (id, parent, notused, detail), indent each one below its parent
+    std::unordered_map<int, int> depths;
+    std::string plan = "Query plan:";
+    while (stmt.Step()) {
+        const int id = stmt.Column<int>(0);
+        const auto parent = depths.find(stmt.Column<int>(1));
+        const int depth = parent != depths.end() ? parent->second + 1 : 0;
+        depths[id] = depth;
+
+        plan += "\n" + std::string(static_cast<std::size_t>(2 * (depth + 1)), ' ') + stmt.Column<std::string>(3);
+    }
+
+    if (depths.empty()) {
+        plan += " none";
+    }
+    return plan;
+}
+
+Transaction::Transaction(Database& database)
+    : mDatabase(database)
+    , bActive(false)
+{
+    bActive = mDatabase.Execute(BeginQuery);
+}
+
+Transaction::~Transaction()
+{
+    Rollback();
+}
+
+bool Transaction::IsActive() const
+{
+    return bActive;
+}
+
+bool Transaction::Commit()
+{
+    if (!bActive) {
+        return false;
+    }
+
+    bActive = false;
+    if (!mDatabase.Execute(CommitQuery)) {
+        mDatabase.Execute(RollbackQuery);
+        return false;
+    }
+
+    return true;
+}
+
+void Transaction::Rollback()
+{
+    if (!bActive) {
+        return;
+    }
+
+    bActive = false;
+    mDatabase.Execute(RollbackQuery);
+}
+} // namespace app::Core
@@ -0,0 +1,136 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sqlite3.h>
+#include <spdlog/spdlog.h>
+
+#include "slow_query_log.h"
+#include "statement.h"
+
+namespace app::Core
+{
+// Connection settings applied to every connection the application opens, read from the [database] section
+struct DatabasePragmas {
+    std::string JournalMode = "WAL";
+    std::string Synchronous = "NORMAL";
+    std::int64_t CacheSize = -16000;
+    std::int64_t MmapSize = 268435456;
+    std::string TempStore = "MEMORY";
+    int BusyTimeout = 5000;
+    // Statements slower than this many milliseconds are logged with their query plan, 0 turns the log off
+    int SlowQueryMilliseconds = 200;
+    int SlowQueryReportsPerMinute = 10;
+};
+
+// Owns a single SQLite connection and a cache of prepared statements keyed by their SQL text.
+// A connection must only be used from one thread at a time.
+class Database final
+{
+public:
+    Database(std::shared_ptr<spdlog::logger> logger, DatabasePragmas pragmas = DatabasePragmas());
+    Database(const Database&) = delete;
+    ~Database();
+
+    Database& operator=(const Database&) = delete;
+
+    bool Open(const std::filesystem::path& databaseFile);
+    void Close();
+
+    bool IsOpen() const;
+    sqlite3* Handle() const;
+
+    // Returns a cached statement for the query, preparing it on first use.
+    // The statement goes back into the cache when the handle is destroyed. If the cached statement
+    // is still held by another handle, a one-off statement is prepared instead.
+    Statement Prepare(const std::string& query);
+
+    // Prepares a statement that is finalized when the handle is destroyed
+    Statement PrepareUncached(const std::string& query);
+
+    // Runs one or more statements that take no parameters and return no rows
+    bool Execute(const std::string& query);
+
+    // Finalizes the cached statements. Statements still held by a handle are taken out of the cache and finalized
+    // once they have been released
+    void ClearStatementCache();
+
+private:
+    struct CachedStatement {
+        sqlite3_stmt* stmt;
+        bool inUse;
+    };
+
+    using StatementCache = std::unordered_map<std::string, CachedStatement>;
+
+    sqlite3_stmt* PrepareStatement(const std::string& query, unsigned int flags);
+    void FinalizeReleasedStatements();
+    bool ApplyPragmas();
+    bool ApplyPragma(const std::string& name, const std::string& value);
+    std::string QueryPragma(const std::string& name);
+
+    static int OnTrace(unsigned int type, void* context, void* statement, void* elapsed);
+    void ReportSlowQueries();
+    std::string ExplainQueryPlan(const std::string& query);
+
+    sqlite3* pDb;
+    std::shared_ptr<spdlog::logger> pLogger;
+    DatabasePragmas mPragmas;
+    StatementCache mStatementCache;
+    // extracted nodes keep their address, so the handles holding these can still mark them released
+    std::vector<StatementCache::node_type> mDetachedStatements;
+    // slow statements seen by OnTrace, waiting for their query plan
+    std::vector<SlowQueryReport> mSlowQueries;
+
+    static const std::string ForeignKeysPragma;
+    static const std::string ExplainQueryPlanQuery;
+    static const std::size_t MaxLoggedSqlLength;
+};
+
+// Begins a write transaction on construction and rolls it back on destruction unless it was committed
+class Transaction final
+{
+public:
+    Transaction(Database& database);
+    Transaction(const Transaction&) = delete;
+    ~Transaction();
+
+    Transaction& operator=(const Transaction&) = delete;
+
+    bool IsActive() const;
+    bool Commit();
+    void Rollback();
+
+private:
+    Database& mDatabase;
+    bool bActive;
+
+    static const std::string BeginQuery;
+    static const std::string CommitQuery;
+    static const std::string RollbackQuery;
+};
+} // namespace app::Core
@@ -0,0 +1,746 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "database_backup.h"
+
+#include <algorithm>
+#include <set>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "gzip_stream.h"
+#include "local_time.h"
+
+#include "../utils/utils.h"
+
+namespace app::Core
+{
+namespace
+{
+const std::string PartialExtension = ".part";
+const std::string BackupExtension = ".db";
+const std::string CompressedExtension = ".gz";
+} // namespace
+
+const std::chrono::seconds DatabaseBackupRunner::StartupDelay = std::chrono::seconds(60);
+const std::chrono::minutes DatabaseBackupRunner::RetryDelay = std::chrono::minutes(15);
+const int DatabaseBackupRunner::MaxRestarts = 3;
+const int DatabaseBackupRunner::ProgressHandlerSteps = 100000;
+const std::string DatabaseBackupRunner::IntegrityCheckQuery = "PRAGMA integrity_check;";
+const std::string DatabaseBackupRunner::CopyPragmasQuery = "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF;";
+const std::string DatabaseBackupRunner::JournalModeQuery = "PRAGMA journal_mode = DELETE;";
+const std::string DatabaseBackupRunner::SelectArchivesQuery = "SELECT year, file_name FROM archived_years;";
+const std::string DatabaseBackupRunner::CheckpointQuery = "PRAGMA wal_checkpoint(TRUNCATE);";
+
+DatabaseBackupRunner::DatabaseBackupRunner(std::filesystem::path databaseFile,
+    DatabasePragmas pragmas,
+    BackupSettings settings,
+    std::shared_ptr<spdlog::logger> logger)
+    : mDatabaseFile(std::move(databaseFile))
+    , mPragmas(std::move(pragmas))
+    , mSettings(std::move(settings))
+    , pLogger(logger)
+    , mBackupDirectory()
+    , mDatabaseName(mDatabaseFile.stem().u8string())
+    , mThread()
+    , mMutex()
+    , mStopCondition()
+    , bRunning(false)
+    , bStopRequested(false)
+{
+    mBackupDirectory = mSettings.Path.empty() ? mDatabaseFile.parent_path() / "backups"
+                                              : std::filesystem::u8path(mSettings.Path);
+}
+
+DatabaseBackupRunner::~DatabaseBackupRunner()
+{
+    Stop();
+}
+
+void DatabaseBackupRunner::Start()
+{
+    if (mSettings.IntervalHours <= 0) {
+        pLogger->info("Scheduled backups are turned off");
+        return;
+    }
+
+    if (mThread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        bStopRequested = false;
+    }
+    bRunning = true;
+    mThread = std::thread(&DatabaseBackupRunner::Run, this);
+}
+
+void DatabaseBackupRunner::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        bStopRequested = true;
+    }
+    mStopCondition.notify_all();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+bool DatabaseBackupRunner::IsRunning() const
+{
+    return bRunning;
+}
+
+std::filesystem::path DatabaseBackupRunner::GetBackupDirectory() const
+{
+    return mBackupDirectory;
+}
+
+void DatabaseBackupRunner::Run()
+{
+    // startup is busy enough without a full copy of the database competing for the disk
+    if (!WaitFor(StartupDelay)) {
+        bRunning = false;
+        return;
+    }
+
+    Database source(pLogger, mPragmas);
+    if (!source.Open(mDatabaseFile)) {
+        bRunning = false;
+        return;
+    }
+
+    const std::int64_t interval = static_cast<std::int64_t>(mSettings.IntervalHours) * 3600;
+    while (true) {
+        std::int64_t wait = 0;
+
+        const auto backups = ListBackups();
+        if (!backups.empty()) {
+            LocalTimeConverter converter;
+            const std::int64_t now = converter.ToLocal(Utils::UnixTimestamp());
+            wait = std::max<std::int64_t>(0, backups.front().localTime + interval - now);
+        }
+
+        if (!WaitFor(std::chrono::seconds(wait))) {
+            break;
+        }
+
+        if (!RunBackup(source) && !WaitFor(RetryDelay)) {
+            break;
+        }
+    }
+
+    source.Close();
+    bRunning = false;
+}
+
+bool DatabaseBackupRunner::RunBackup(Database& source)
+{
+    const auto startedAt = std::chrono::steady_clock::now();
+
+    std::error_code ec;
+    std::filesystem::create_directories(mBackupDirectory, ec);
+    if (ec) {
+        pLogger->error("Failed to create backup directory {0} - ({1})", mBackupDirectory.u8string(), ec.message());
+        return false;
+    }
+
+    LocalTimeConverter converter;
+    const std::filesystem::path file = GetBackupPath(converter.ToLocal(Utils::UnixTimestamp()));
+    std::filesystem::path partialFile = file;
+    partialFile += PartialExtension;
+
+    std::vector<PendingFile> pending{ { partialFile, file } };
+    auto removePending = [&pending]() {
+        std::error_code removeError;
+        for (const auto& pendingFile : pending) {
+            std::filesystem::remove(pendingFile.partialFile, removeError);
+        }
+    };
+
+    if (!CopyDatabase(source, partialFile) || !VerifyBackup(partialFile) ||
+        !CopyArchives(partialFile, file, pending)) {
+        removePending();
+        return false;
+    }
+
+    // the copy is verified before it is compressed, the gzip CRC covers it from there on
+    for (auto& pendingFile : pending) {
+        if (!CompressBackupFile(pendingFile)) {
+            removePending();
+            return false;
+        }
+    }
+
+    // the database copy is the first pending file and goes into place last, archives moved before a failure
+    // would not belong to any listed backup
+    for (auto next = pending.rbegin(); next != pending.rend(); ++next) {
+        std::filesystem::rename(next->partialFile, next->file, ec);
+        if (ec) {
+            pLogger->error("Failed to move backup into place at {0} - ({1})", next->file.u8string(), ec.message());
+            removePending();
+            for (auto moved = pending.rbegin(); moved != next; ++moved) {
+                std::filesystem::remove(moved->file, ec);
+            }
+            return false;
+        }
+    }
+
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startedAt);
+    pLogger->info("Backed up database to {0} ({1} bytes, {2} archives) in {3}ms",
+        pending.front().file.u8string(),
+        std::filesystem::file_size(pending.front().file, ec),
+        pending.size() - 1,
+        elapsed.count());
+
+    PruneBackups();
+    return true;
+}
+
+bool DatabaseBackupRunner::Restore(const std::filesystem::path& backupFile)
+{
+    if (mThread.joinable()) {
+        pLogger->error("Cannot restore {0} while scheduled backups are running", backupFile.u8string());
+        return false;
+    }
+
+    {
+        // a stop left over from shutting down the schedule would interrupt the integrity check
+        std::lock_guard<std::mutex> lock(mMutex);
+        bStopRequested = false;
+    }
+
+    std::filesystem::path restoredFile = mDatabaseFile;
+    restoredFile += ".restore";
+    restoredFile += PartialExtension;
+
+    std::vector<PendingFile> pending{ { restoredFile, mDatabaseFile } };
+    auto removePending = [&pending]() {
+        std::error_code removeError;
+        for (const auto& pendingFile : pending) {
+            std::filesystem::remove(pendingFile.partialFile, removeError);
+        }
+    };
+
+    std::vector<std::pair<int, std::string>> archives;
+    if (!RestoreFile(backupFile, restoredFile) || !VerifyBackup(restoredFile) ||
+        !ReadArchivedYears(restoredFile, archives)) {
+        removePending();
+        return false;
+    }
+
+    // the archives the backup was taken with are stored next to it
+    for (const auto& [year, fileName] : archives) {
+        auto archiveBackup = GetArchiveBackupPath(backupFile, year);
+        if (backupFile.extension() == CompressedExtension) {
+            archiveBackup += CompressedExtension;
+        }
+
+        PendingFile archive;
+        archive.file = mDatabaseFile.parent_path() / std::filesystem::u8path(fileName);
+        archive.partialFile = archive.file;
+        archive.partialFile += ".restore";
+        archive.partialFile += PartialExtension;
+        pending.push_back(archive);
+
+        if (!RestoreFile(archiveBackup, archive.partialFile) || !VerifyBackup(archive.partialFile)) {
+            removePending();
+            return false;
+        }
+    }
+
+    // an emptied WAL cannot be replayed into the restored database should the restore stop before it is removed.
+    // The restore goes ahead when this fails, a database that needs restoring may not open at all.
+    std::error_code ec;
+    if (std::filesystem::exists(mDatabaseFile, ec) && !CheckpointDatabase()) {
+        pLogger->warn("Restoring over {0} without emptying its WAL first", mDatabaseFile.u8string());
+    }
+
+    // archives go into place first, the restored database never names an archive that is missing. Renaming the
+    // database is the step that commits the restore, until then the current database is left as it was.
+    for (auto next = pending.rbegin(); next != pending.rend(); ++next) {
+        std::filesystem::rename(next->partialFile, next->file, ec);
+        if (ec) {
+            pLogger->error(
+                "Failed to replace {0} with the restored backup - ({1})", next->file.u8string(), ec.message());
+            removePending();
+            return false;
+        }
+    }
+
+    // the WAL and shared memory files belong to the database that was replaced
+    for (const char* suffix : { "-wal", "-shm" }) {
+        std::filesystem::path sidecar = mDatabaseFile;
+        sidecar += suffix;
+        if (!std::filesystem::remove(sidecar, ec) && ec) {
+            pLogger->error("Failed to remove {0} of the replaced database - ({1})", sidecar.u8string(), ec.message());
+            return false;
+        }
+    }
+
+    pLogger->info("Restored {0} and {1} archives from backup {2}",
+        mDatabaseFile.u8string(),
+        archives.size(),
+        backupFile.u8string());
+    return true;
+}
+
+bool DatabaseBackupRunner::CopyDatabase(Database& source, const std::filesystem::path& file)
+{
+    const std::string path = file.u8string();
+
+    sqlite3* destination = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &destination, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) !=
+        SQLITE_OK) {
+        pLogger->error("Failed to open backup {0} - ({1})", path, sqlite3_errmsg(destination));
+        sqlite3_close(destination);
+        return false;
+    }
+
+    // the file is only trusted after the integrity check, journaling and syncing every step would only slow it down
+    if (sqlite3_exec(destination, CopyPragmasQuery.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+        pLogger->error("Failed to prepare backup {0} - ({1})", path, sqlite3_errmsg(destination));
+        sqlite3_close(destination);
+        return false;
+    }
+
+    sqlite3_backup* backup = sqlite3_backup_init(destination, "main", source.Handle(), "main");
+    if (backup == nullptr) {
+        pLogger->error("Failed to start backup to {0} - ({1})", path, sqlite3_errmsg(destination));
+        sqlite3_close(destination);
+        return false;
+    }
+
+    int rc = SQLITE_OK;
+    int restarts = 0;
+    int previousRemaining = -1;
+    bool copyRemaining = false;
+    bool interrupted = false;
+    while (true) {
+        rc = sqlite3_backup_step(backup, copyRemaining ? -1 : mSettings.PagesPerStep);
+        if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+            break;
+        }
+
+        // A write through another connection starts the copy over. Under a steady stream of writes, take the
+        // rest in one step, which in WAL mode only holds a read transaction and does not block writers.
+        const int remaining = sqlite3_backup_remaining(backup);
+        if (previousRemaining >= 0 && remaining >= previousRemaining && ++restarts >= MaxRestarts) {
+            copyRemaining = true;
+        }
+        previousRemaining = remaining;
+
+        if (!WaitFor(std::chrono::milliseconds(mSettings.StepPauseMilliseconds))) {
+            interrupted = true;
+            break;
+        }
+    }
+    sqlite3_backup_finish(backup);
+
+    if (interrupted) {
+        pLogger->info("Backup to {0} interrupted", path);
+        sqlite3_close(destination);
+        return false;
+    }
+
+    if (rc != SQLITE_DONE) {
+        pLogger->error("Failed to back up database to {0} - ({1})", path, sqlite3_errstr(rc));
+        sqlite3_close(destination);
+        return false;
+    }
+
+    // the copy carries the WAL flag of the live database, a backup should be a single self-contained file
+    if (sqlite3_exec(destination, JournalModeQuery.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+        pLogger->error("Failed to set the journal mode of backup {0} - ({1})", path, sqlite3_errmsg(destination));
+        sqlite3_close(destination);
+        return false;
+    }
+
+    if (restarts > 0) {
+        pLogger->info("Backup to {0} restarted {1} times by concurrent writes", path, restarts);
+    }
+
+    sqlite3_close(destination);
+    return true;
+}
+
+bool DatabaseBackupRunner::VerifyBackup(const std::filesystem::path& file)
+{
+    const std::string path = file.u8string();
+
+    sqlite3* backup = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &backup, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        pLogger->error("Failed to open backup {0} for verification - ({1})", path, sqlite3_errmsg(backup));
+        sqlite3_close(backup);
+        return false;
+    }
+
+    // the check reads the whole file, let Stop interrupt it
+    sqlite3_progress_handler(
+        backup,
+        ProgressHandlerSteps,
+        [](void* runner) -> int {
+            auto self = static_cast<DatabaseBackupRunner*>(runner);
+            std::lock_guard<std::mutex> lock(self->mMutex);
+            return self->bStopRequested ? 1 : 0;
+        },
+        this);
+
+    bool isValid = true;
+    {
+        sqlite3_stmt* handle = nullptr;
+        sqlite3_prepare_v2(backup, IntegrityCheckQuery.c_str(), -1, &handle, nullptr);
+
+        Statement stmt(backup, handle);
+        if (!stmt) {
+            pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+            isValid = false;
+        }
+
+        // a healthy database reports a single "ok" row, anything else lists the problems found
+        while (isValid && stmt.Step()) {
+            const auto result = stmt.Column<std::string>(0);
+            if (result != "ok") {
+                pLogger->error("Backup {0} failed integrity check - ({1})", path, result);
+                isValid = false;
+            }
+        }
+
+        if (stmt.HasError()) {
+            pLogger->error("Failed to verify backup {0} - ({1})", path, stmt.ErrorMessage());
+            isValid = false;
+        }
+    }
+
+    sqlite3_close(backup);
+    return isValid;
+}
+
+bool DatabaseBackupRunner::ReadArchivedYears(const std::filesystem::path& file,
+    std::vector<std::pair<int, std::string>>& archives)
+{
+    const std::string path = file.u8string();
+
+    sqlite3* backup = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &backup, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        pLogger->error("Failed to open backup {0} - ({1})", path, sqlite3_errmsg(backup));
+        sqlite3_close(backup);
+        return false;
+    }
+
+    bool isRead = true;
+    {
+        sqlite3_stmt* handle = nullptr;
+        sqlite3_prepare_v2(backup, SelectArchivesQuery.c_str(), -1, &handle, nullptr);
+
+        Statement stmt(backup, handle);
+        if (!stmt) {
+            pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+            isRead = false;
+        }
+
+        while (isRead && stmt.Step()) {
+            archives.emplace_back(stmt.Column<int>(0), stmt.Column<std::string>(1));
+        }
+
+        if (stmt.HasError()) {
+            pLogger->error("Failed to read archived years of backup {0} - ({1})", path, stmt.ErrorMessage());
+            isRead = false;
+        }
+    }
+
+    sqlite3_close(backup);
+    return isRead;
+}
+
+bool DatabaseBackupRunner::CheckpointDatabase()
+{
+    const std::string path = mDatabaseFile.u8string();
+
+    sqlite3* database = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &database, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        pLogger->error("Failed to open database {0} - ({1})", path, sqlite3_errmsg(database));
+        sqlite3_close(database);
+        return false;
+    }
+
+    bool isCheckpointed = true;
+    {
+        sqlite3_stmt* handle = nullptr;
+        sqlite3_prepare_v2(database, CheckpointQuery.c_str(), -1, &handle, nullptr);
+
+        Statement stmt(database, handle);
+        if (!stmt) {
+            pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+            isCheckpointed = false;
+        }
+
+        // the first column is 1 when the checkpoint could not finish
+        if (isCheckpointed && (!stmt.Step() || stmt.Column<int>(0) != 0)) {
+            pLogger->error("Failed to checkpoint database {0} - ({1})", path, stmt.ErrorMessage());
+            isCheckpointed = false;
+        }
+    }
+
+    sqlite3_close(database);
+    return isCheckpointed;
+}
+
+bool DatabaseBackupRunner::CopyArchives(const std::filesystem::path& backupFile,
+    const std::filesystem::path& file,
+    std::vector<PendingFile>& pending)
+{
+    // the copy names the archives it was taken with, the live database may have archived more since
+    std::vector<std::pair<int, std::string>> archives;
+    if (!ReadArchivedYears(backupFile, archives)) {
+        return false;
+    }
+
+    // archives never change once written, a plain copy of the file is consistent
+    for (const auto& [year, fileName] : archives) {
+        const auto archiveFile = mDatabaseFile.parent_path() / std::filesystem::u8path(fileName);
+        PendingFile archiveBackup;
+        archiveBackup.file = GetArchiveBackupPath(file, year);
+        archiveBackup.partialFile = archiveBackup.file;
+        archiveBackup.partialFile += PartialExtension;
+        pending.push_back(archiveBackup);
+
+        std::error_code ec;
+        if (!std::filesystem::copy_file(
+                archiveFile, archiveBackup.partialFile, std::filesystem::copy_options::overwrite_existing, ec)) {
+            pLogger->error("Failed to back up archive {0} - ({1})", archiveFile.u8string(), ec.message());
+            return false;
+        }
+
+        if (!WaitFor(std::chrono::milliseconds(0))) {
+            pLogger->info("Backup to {0} interrupted", backupFile.u8string());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DatabaseBackupRunner::CompressBackupFile(PendingFile& pending)
+{
+    if (mSettings.CompressionLevel <= 0) {
+        return true;
+    }
+
+    pending.file += CompressedExtension;
+    std::filesystem::path compressedFile = pending.file;
+    compressedFile += PartialExtension;
+
+    FileCompressor compressor(pLogger);
+    CompressionStats stats;
+    const bool compressed = compressor.Compress(
+        pending.partialFile, compressedFile, mSettings.CompressionLevel, bStopRequested, stats);
+
+    std::error_code ec;
+    std::filesystem::remove(pending.partialFile, ec);
+    pending.partialFile = compressedFile;
+    return compressed;
+}
+
+bool DatabaseBackupRunner::RestoreFile(const std::filesystem::path& source, const std::filesystem::path& target)
+{
+    if (source.extension() == CompressedExtension) {
+        FileCompressor compressor(pLogger);
+        CompressionStats stats;
+        return compressor.Decompress(source, target, bStopRequested, stats);
+    }
+
+    std::error_code ec;
+    if (!std::filesystem::copy_file(source, target, std::filesystem::copy_options::overwrite_existing, ec)) {
+        pLogger->error("Failed to copy backup {0} - ({1})", source.u8string(), ec.message());
+        return false;
+    }
+    return true;
+}
+
+void DatabaseBackupRunner::PruneBackups()
+{
+    std::set<std::int64_t> keptDays;
+    std::set<std::int64_t> keptWeeks;
+
+    const auto backups = ListBackups();
+    for (std::size_t i = 0; i < backups.size(); i++) {
+        // Backups are newest first, so the first one seen on a day or in a week is the one to keep.
+        // 1970-01-01 was a Thursday, the offset makes weeks start on Monday.
+        const std::int64_t day = backups[i].localTime / 86400;
+        const std::int64_t week = (day + 3) / 7;
+
+        bool keep = i == 0;
+        if (keptDays.size() < static_cast<std::size_t>(std::max(mSettings.KeepDaily, 0)) &&
+            keptDays.insert(day).second) {
+            keep = true;
+        }
+        if (keptWeeks.size() < static_cast<std::size_t>(std::max(mSettings.KeepWeekly, 0)) &&
+            keptWeeks.insert(week).second) {
+            keep = true;
+        }
+
+        if (!keep) {
+            RemoveBackup(backups[i]);
+        }
+    }
+}
+
+void DatabaseBackupRunner::RemoveBackup(const BackupFile& backup)
+{
+    // the database copy goes last, so a backup whose archives could not all be removed is still listed
+    auto files = ListArchiveBackups(backup.file);
+    files.push_back(backup.file);
+
+    for (const auto& file : files) {
+        std::error_code ec;
+        if (!std::filesystem::remove(file, ec) && ec) {
+            pLogger->warn("Failed to remove old backup {0} - ({1})", file.u8string(), ec.message());
+            return;
+        }
+    }
+
+    pLogger->info("Removed old backup {0}", backup.file.u8string());
+}
+
+std::vector<DatabaseBackupRunner::BackupFile> DatabaseBackupRunner::ListBackups() const
+{
+    std::vector<BackupFile> backups;
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(mBackupDirectory, ec)) {
+        if (!entry.is_regular_file(ec)) {
+            continue;
+        }
+
+        auto localTime = ParseBackupTime(entry.path().filename().u8string());
+        if (localTime) {
+            backups.push_back(BackupFile{ entry.path(), *localTime });
+        }
+    }
+
+    std::sort(backups.begin(), backups.end(), [](const BackupFile& lhs, const BackupFile& rhs) {
+        return lhs.localTime > rhs.localTime;
+    });
+    return backups;
+}
+
+std::vector<std::filesystem::path> DatabaseBackupRunner::ListArchiveBackups(
+    const std::filesystem::path& backupFile) const
+{
+    std::vector<std::filesystem::path> archives;
+
+    // <backup name>-YYYY.db, with .gz appended when compressed
+    const std::string fileName = backupFile.filename().u8string();
+    const std::string prefix = fileName.substr(0, mDatabaseName.size() + 16) + "-";
+    const std::size_t plainSize = prefix.size() + 4 + BackupExtension.size();
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(backupFile.parent_path(), ec)) {
+        const std::string name = entry.path().filename().u8string();
+        const bool compressed = name.size() == plainSize + CompressedExtension.size() &&
+                                name.compare(plainSize, CompressedExtension.size(), CompressedExtension) == 0;
+        if ((name.size() != plainSize && !compressed) || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(prefix.size() + 4, BackupExtension.size(), BackupExtension) != 0 ||
+            !std::all_of(name.begin() + prefix.size(), name.begin() + prefix.size() + 4, [](char c) {
+                return c >= '0' && c <= '9';
+            })) {
+            continue;
+        }
+        archives.push_back(entry.path());
+    }
+
+    return archives;
+}
+
+std::optional<std::int64_t> DatabaseBackupRunner::ParseBackupTime(const std::string& fileName) const
+{
+    // <database name>-YYYYMMDD-HHMMSS.db, with .gz appended when compressed
+    const std::size_t prefixSize = mDatabaseName.size() + 1;
+    const std::size_t plainSize = prefixSize + 15 + BackupExtension.size();
+    if (fileName.size() == plainSize + CompressedExtension.size() &&
+        fileName.compare(plainSize, CompressedExtension.size(), CompressedExtension) == 0) {
+        return ParseBackupTime(fileName.substr(0, plainSize));
+    }
+
+    if (fileName.size() != plainSize ||
+        fileName.compare(0, mDatabaseName.size(), mDatabaseName) != 0 || fileName[mDatabaseName.size()] != '-' ||
+        fileName.compare(prefixSize + 15, BackupExtension.size(), BackupExtension) != 0 ||
+        fileName[prefixSize + 8] != '-') {
+        return std::nullopt;
+    }
+
+    auto number = [&](std::size_t offset, std::size_t count, unsigned& value) {
+        value = 0;
+        for (std::size_t i = prefixSize + offset; i < prefixSize + offset + count; i++) {
+            if (fileName[i] < '0' || fileName[i] > '9') {
+                return false;
+            }
+            value = value * 10 + static_cast<unsigned>(fileName[i] - '0');
+        }
+        return true;
+    };
+
+    unsigned year = 0;
+    CivilTime civil{};
+    if (!number(0, 4, year) || !number(4, 2, civil.month) || !number(6, 2, civil.day) || !number(9, 2, civil.hour) ||
+        !number(11, 2, civil.minute) || !number(13, 2, civil.second)) {
+        return std::nullopt;
+    }
+
+    civil.year = year;
+    return FromCivilTime(civil);
+}
+
+std::filesystem::path DatabaseBackupRunner::GetBackupPath(std::int64_t localTime) const
+{
+    const CivilTime civil = ToCivilTime(localTime);
+    const std::string fileName = fmt::format("{0}-{1:04}{2:02}{3:02}-{4:02}{5:02}{6:02}{7}",
+        mDatabaseName,
+        civil.year,
+        civil.month,
+        civil.day,
+        civil.hour,
+        civil.minute,
+        civil.second,
+        BackupExtension);
+    return mBackupDirectory / std::filesystem::u8path(fileName);
+}
+
+std::filesystem::path DatabaseBackupRunner::GetArchiveBackupPath(const std::filesystem::path& backupFile, int year)
+{
+    std::filesystem::path plainFile = backupFile;
+    if (plainFile.extension() == CompressedExtension) {
+        plainFile.replace_extension();
+    }
+
+    return plainFile.parent_path() /
+           std::filesystem::u8path(plainFile.stem().u8string() + "-" + std::to_string(year) + BackupExtension);
+}
+
+bool DatabaseBackupRunner::WaitFor(std::chrono::milliseconds duration)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    return !mStopCondition.wait_for(lock, duration, [this]() { return bStopRequested.load(); });
+}
+} // namespace app::Core
@@ -0,0 +1,154 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "database.h"
+
+namespace app::Core
+{
+// Backup schedule and retention, read from the [database] section
+struct BackupSettings {
+    // An empty path puts the backups in a backups directory next to the database
+    std::string Path;
+    // 0 turns scheduled backups off
+    int IntervalHours = 24;
+    // The newest backup of each of the last KeepDaily days and KeepWeekly weeks is kept
+    int KeepDaily = 7;
+    int KeepWeekly = 4;
+    // Pages copied per backup step and the pause between steps, so the copy never holds the disk for long
+    int PagesPerStep = 256;
+    int StepPauseMilliseconds = 20;
+    // gzip level from 1 (fastest) to 9 (smallest), 0 keeps backups uncompressed
+    int CompressionLevel = 6;
+};
+
+// Takes online backups of the database on a background thread with its own connection, using the SQLite
+// backup API in small steps. Each backup is written to a .part file, checked with PRAGMA integrity_check and
+// only then given its final <database name>-YYYYMMDD-HHMMSS.db name, so a listed backup is always complete.
+// With compression on, the verified copy is streamed through gzip into a .db.gz file.
+//
+// The archive files of closed years listed in the copy (see TimeEntryArchive) are copied next to it as
+// <backup name>-<year>.db, compressed the same way, and pruned together with it. The database copy is moved into
+// place last, so its archives are always there once it is listed.
+class DatabaseBackupRunner final
+{
+public:
+    DatabaseBackupRunner(std::filesystem::path databaseFile,
+        DatabasePragmas pragmas,
+        BackupSettings settings,
+        std::shared_ptr<spdlog::logger> logger);
+    DatabaseBackupRunner(const DatabaseBackupRunner&) = delete;
+    ~DatabaseBackupRunner();
+
+    DatabaseBackupRunner& operator=(const DatabaseBackupRunner&) = delete;
+
+    void Start();
+
+    // Interrupts a backup in progress, its partial file is removed
+    void Stop();
+
+    bool IsRunning() const;
+
+    // Offline step: replaces the database file, and the archive files the backup names, with a .db or .db.gz
+    // backup once every restored copy passes the integrity check. Nothing may have the database open, so the
+    // application only runs it for --restore-backup, before its database worker starts, and never on a runner
+    // that was started. The database is renamed into place last, the WAL of the one it replaces is checkpointed
+    // before and removed after.
+    bool Restore(const std::filesystem::path& backupFile);
+
+    std::filesystem::path GetBackupDirectory() const;
+
+private:
+    struct BackupFile {
+        std::filesystem::path file;
+        // local wall-clock seconds taken from the file name
+        std::int64_t localTime;
+    };
+
+    struct PendingFile {
+        std::filesystem::path partialFile;
+        std::filesystem::path file;
+    };
+
+    void Run();
+    bool RunBackup(Database& source);
+    bool CopyDatabase(Database& source, const std::filesystem::path& file);
+    bool VerifyBackup(const std::filesystem::path& file);
+    bool ReadArchivedYears(const std::filesystem::path& file, std::vector<std::pair<int, std::string>>& archives);
+    // Moves the WAL of the database being restored over into it and truncates it
+    bool CheckpointDatabase();
+    bool CopyArchives(const std::filesystem::path& backupFile,
+        const std::filesystem::path& file,
+        std::vector<PendingFile>& pending);
+    bool RestoreFile(const std::filesystem::path& source, const std::filesystem::path& target);
+    bool CompressBackupFile(PendingFile& pending);
+    void PruneBackups();
+    void RemoveBackup(const BackupFile& backup);
+
+    std::vector<BackupFile> ListBackups() const;
+    std::vector<std::filesystem::path> ListArchiveBackups(const std::filesystem::path& backupFile) const;
+    std::optional<std::int64_t> ParseBackupTime(const std::string& fileName) const;
+    std::filesystem::path GetBackupPath(std::int64_t localTime) const;
+    // <backup name>-<year>.db next to the backup, without the compressed extension
+    static std::filesystem::path GetArchiveBackupPath(const std::filesystem::path& backupFile, int year);
+
+    // Sleeps for the duration and returns false if a stop was requested in the meantime
+    bool WaitFor(std::chrono::milliseconds duration);
+
+    std::filesystem::path mDatabaseFile;
+    DatabasePragmas mPragmas;
+    BackupSettings mSettings;
+    std::shared_ptr<spdlog::logger> pLogger;
+    std::filesystem::path mBackupDirectory;
+    std::string mDatabaseName;
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mStopCondition;
+    std::atomic<bool> bRunning;
+    // set under mMutex for the stop condition, read without it by compression between chunks
+    std::atomic<bool> bStopRequested;
+
+    static const std::chrono::seconds StartupDelay;
+    static const std::chrono::minutes RetryDelay;
+    static const int MaxRestarts;
+    static const int ProgressHandlerSteps;
+    static const std::string IntegrityCheckQuery;
+    static const std::string CopyPragmasQuery;
+    static const std::string JournalModeQuery;
+    static const std::string SelectArchivesQuery;
+    static const std::string CheckpointQuery;
+};
+} // namespace app::Core
@@ -19,267 +19,144 @@
 
 #include "database_migration.h"
 
-#include <sqlite3.h>
+#include <iterator>
 
-#include "environment.h"
-#include "../utils/utils.h"
+#include "database.h"
+#include "trace.h"
+
+#include "migrations.generated.h"
 
 namespace
 {
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-static BOOL CALLBACK EnumMigrations(HMODULE hModule, LPCTSTR lpszType, LPTSTR lpszName, LONG_PTR lParam)
+constexpr bool IsSortedByName(const app::Core::Migration* migrations, std::size_t count)
 {
-    std::vector<app::Core::Migration>* migrations = reinterpret_cast<std::vector<app::Core::Migration>*>(lParam);
-
-    HRSRC rc = FindResource(hModule, lpszName, lpszType);
-    DWORD size = SizeofResource(hModule, rc);
-    HGLOBAL data = LoadResource(hModule, rc);
-    const char* buffer = reinterpret_cast<const char*>(LockResource(data));
-
-    app::Core::Migration m;
-    m.name = app::Utils::ToStdString(lpszName);
-    m.sql = std::string(buffer, size);
-
-    migrations->push_back(m);
-
-    return TRUE;
+    for (std::size_t i = 1; i < count; i++) {
+        if (!(migrations[i - 1].name < migrations[i].name)) {
+            return false;
+        }
+    }
+    return true;
 }
+
+static_assert(IsSortedByName(app::Core::EmbeddedMigrations, std::size(app::Core::EmbeddedMigrations)),
+    "Embedded migrations must be unique and sorted by name");
 } // namespace
 
 namespace app::Core
 {
 const std::string DatabaseMigration::BeginTransactionQuery = "BEGIN TRANSACTION";
 const std::string DatabaseMigration::CommitTransactionQuery = "COMMIT";
+const std::string DatabaseMigration::RollbackTransactionQuery = "ROLLBACK";
 const std::string DatabaseMigration::CreateMigrationHistoryQuery =
     "CREATE TABLE IF NOT EXISTS migration_history("
     "id INTEGER PRIMARY KEY NOT NULL,"
     "name TEXT NOT NULL"
     ");";
-const std::string DatabaseMigration::SelectMigrationExistsQuery = "SELECT COUNT(*) FROM migration_history WHERE name = ?";
+const std::string DatabaseMigration::SelectAppliedMigrationsQuery = "SELECT name FROM migration_history;";
 const std::string DatabaseMigration::InsertMigrationHistoryQuery = "INSERT INTO migration_history (name) VALUES (?);";
 
-DatabaseMigration::DatabaseMigration(std::shared_ptr<Environment> env, std::shared_ptr<spdlog::logger> logger)
-    : pEnv(env)
+DatabaseMigration::DatabaseMigration(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger)
+    : pDatabase(database)
     , pLogger(logger)
-    , pDb(nullptr)
-{
-    auto databaseFile = pEnv->GetDatabasePath().string();
-    int rc = sqlite3_open(databaseFile.c_str(), &pDb);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to open database {0}", std::string(err));
-    }
-
-    sqlite3_stmt* stmt = nullptr;
-    rc = sqlite3_prepare_v2(pDb, "PRAGMA foreign_keys = ON;", -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return;
-    }
-
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Error when executing statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return;
-    }
-
-    if (rc != SQLITE_DONE) {
-        pLogger->error("Error when running statement");
-        sqlite3_finalize(stmt);
-        return;
-    }
-
-    sqlite3_finalize(stmt);
-}
-
-DatabaseMigration::~DatabaseMigration()
 {
-    sqlite3_close(pDb);
 }
 
 bool DatabaseMigration::Migrate()
 {
-    CreateMigrationHistoryTable();
+    TKS_TRACE_SCOPE("migration/migrate");
 
-    std::vector<Migration> migrations;
-
-    // clang-format off
-    EnumResourceNames(
-        nullptr,
-        TEXT("MIGRATION"),
-        &EnumMigrations,
-        reinterpret_cast<LONG_PTR>(&migrations)
-    );
-    // clang-format on
-
-    sqlite3_stmt* stmt = nullptr;
-    int rc = sqlite3_prepare_v2(pDb, BeginTransactionQuery.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
+    if (!CreateMigrationHistoryTable()) {
         return false;
     }
 
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to step statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
+    std::unordered_set<std::string> applied;
+    if (!SelectAppliedMigrations(applied)) {
         return false;
     }
 
-    sqlite3_finalize(stmt);
-
-    for (const auto& migration : migrations) {
-        if (MigrationExists(migration.name)) {
-            continue;
+    bool hasPending = false;
+    for (const auto& migration : EmbeddedMigrations) {
+        if (applied.find(std::string(migration.name)) == applied.end()) {
+            hasPending = true;
+            break;
         }
+    }
 
-        sqlite3_stmt* migrationStmt = nullptr;
-        const char* sql = migration.sql.c_str();
-
-        do {
-            int mrc = sqlite3_prepare_v2(pDb, sql, -1, &migrationStmt, nullptr);
-            if (mrc != SQLITE_OK) {
-                const char* err = sqlite3_errmsg(pDb);
-                pLogger->error("Error when executing statement {0}", std::string(err));
-                sqlite3_finalize(migrationStmt);
-                return false;
-            }
-
-            if (migrationStmt == nullptr) {
-                break;
-            }
-
-            mrc = sqlite3_step(migrationStmt);
-            if (mrc != SQLITE_OK && mrc != SQLITE_DONE) {
-                const char* err = sqlite3_errmsg(pDb);
-                pLogger->error("Failed to step/execute migration {0} - ({1})", migration.name, std::string(err));
-                sqlite3_finalize(migrationStmt);
-                return false;
-            }
-
-            sqlite3_finalize(migrationStmt);
-        } while (sql && sql[0] != '\0');
+    // an up to date database needs nothing beyond the single history read
+    if (!hasPending) {
+        return true;
+    }
 
-        sqlite3_stmt* migrationHistoryStmt = nullptr;
+    if (!pDatabase->Execute(BeginTransactionQuery)) {
+        return false;
+    }
 
-        int mhrc = sqlite3_prepare_v2(pDb, InsertMigrationHistoryQuery.c_str(), -1, &migrationHistoryStmt, nullptr);
-        if (mhrc != SQLITE_OK) {
-            const char* err = sqlite3_errmsg(pDb);
-            pLogger->error("Failed to prepare statement {0}", std::string(err));
-            sqlite3_finalize(migrationHistoryStmt);
-            return false;
+    for (const auto& migration : EmbeddedMigrations) {
+        if (applied.find(std::string(migration.name)) != applied.end()) {
+            continue;
         }
 
-        mhrc = sqlite3_bind_text(
-            migrationHistoryStmt, 1, migration.name.c_str(), static_cast<int>(migration.name.size()), SQLITE_TRANSIENT);
-        if (mhrc != SQLITE_OK) {
-            const char* err = sqlite3_errmsg(pDb);
-            pLogger->error("Failed to bind {0}", std::string(err));
-            sqlite3_finalize(migrationHistoryStmt);
+        TKS_TRACE_SCOPE("migration/apply");
+        pLogger->info("Applying migration {0}", migration.name);
+
+        // migrations may contain several statements, so they are not worth caching
+        if (!pDatabase->Execute(std::string(migration.sql))) {
+            pLogger->error("Failed to execute migration {0}", migration.name);
+            pDatabase->Execute(RollbackTransactionQuery);
             return false;
         }
 
-        mhrc = sqlite3_step(migrationHistoryStmt);
-        if (mhrc != SQLITE_OK) {
-            const char* err = sqlite3_errmsg(pDb);
-            pLogger->error("Failed to step through statement {0}", std::string(err));
-            sqlite3_finalize(migrationHistoryStmt);
+        if (!InsertMigrationHistory(migration.name)) {
+            pDatabase->Execute(RollbackTransactionQuery);
             return false;
         }
     }
 
-    rc = sqlite3_prepare_v2(pDb, CommitTransactionQuery.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return false;
-    }
-
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to step statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return false;
-    }
-
-    sqlite3_finalize(stmt);
+    TKS_TRACE_SCOPE("migration/commit");
+    return pDatabase->Execute(CommitTransactionQuery);
+}
 
-    return true;
+bool DatabaseMigration::CreateMigrationHistoryTable()
+{
+    TKS_TRACE_SCOPE("migration/create_history_table");
+    return pDatabase->Execute(CreateMigrationHistoryQuery);
 }
 
-void DatabaseMigration::CreateMigrationHistoryTable()
+bool DatabaseMigration::SelectAppliedMigrations(std::unordered_set<std::string>& applied)
 {
-    sqlite3_stmt* stmt = nullptr;
-    int rc = sqlite3_prepare_v2(pDb, CreateMigrationHistoryQuery.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return;
+    TKS_TRACE_SCOPE("migration/select_applied");
+    auto stmt = pDatabase->Prepare(SelectAppliedMigrationsQuery);
+    if (!stmt) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
     }
 
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Error when executing statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return;
+    while (stmt.Step()) {
+        applied.insert(stmt.Column<std::string>(0));
     }
 
-    if (rc != SQLITE_DONE) {
-        pLogger->error("Error when running statement");
-        sqlite3_finalize(stmt);
-        return;
+    if (stmt.HasError()) {
+        pLogger->error("Error when stepping into result {0}", stmt.ErrorMessage());
+        return false;
     }
 
-    sqlite3_finalize(stmt);
+    return true;
 }
 
-bool DatabaseMigration::MigrationExists(const std::string& name)
+bool DatabaseMigration::InsertMigrationHistory(std::string_view name)
 {
-    sqlite3_stmt* stmt = nullptr;
-
-    int rc = sqlite3_prepare_v2(pDb, SelectMigrationExistsQuery.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
+    TKS_TRACE_SCOPE("migration/insert_history");
+    auto stmt = pDatabase->Prepare(InsertMigrationHistoryQuery);
+    if (!stmt || !stmt.Bind(name)) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
         return false;
     }
 
-    rc = sqlite3_bind_text(stmt, 1, name.c_str(), static_cast<int>(name.size()), SQLITE_TRANSIENT);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
+    if (!stmt.Execute()) {
+        pLogger->error("Failed to step through statement {0}", stmt.ErrorMessage());
         return false;
     }
 
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_OK) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Error when stepping into result {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return false;
-    }
-
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        pLogger->warn("Count statement returned more than 1 row");
-    }
-
-    int count = sqlite3_column_int(stmt, 0);
-
-    return count > 0;
+    return true;
 }
 } // namespace app::Core
@@ -19,39 +19,43 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 
 #include <spdlog/spdlog.h>
 
 namespace app::Core
 {
-class Environment;
+class Database;
 
 struct Migration {
-    std::string name;
-    std::string sql;
+    std::string_view name;
+    std::string_view sql;
 };
 
 class DatabaseMigration
 {
 public:
-    DatabaseMigration(std::shared_ptr<Environment> env, std::shared_ptr<spdlog::logger> logger);
-    ~DatabaseMigration();
+    DatabaseMigration(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger);
+    ~DatabaseMigration() = default;
 
     bool Migrate();
 
 private:
-    void CreateMigrationHistoryTable();
-    bool MigrationExists(const std::string& name);
+    bool CreateMigrationHistoryTable();
+    bool SelectAppliedMigrations(std::unordered_set<std::string>& applied);
+    bool InsertMigrationHistory(std::string_view name);
 
-    sqlite3* pDb;
-    std::shared_ptr<Environment> pEnv;
+    std::shared_ptr<Database> pDatabase;
     std::shared_ptr<spdlog::logger> pLogger;
 
     static const std::string BeginTransactionQuery;
     static const std::string CommitTransactionQuery;
+    static const std::string RollbackTransactionQuery;
     static const std::string CreateMigrationHistoryQuery;
-    static const std::string SelectMigrationExistsQuery;
+    static const std::string SelectAppliedMigrationsQuery;
     static const std::string InsertMigrationHistoryQuery;
 };
 } // namespace app::Core
@@ -0,0 +1,184 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "database_worker.h"
+
+#include <algorithm>
+
+#include "metrics.h"
+#include "trace.h"
+
+namespace app::Core
+{
+DatabaseWorker::DatabaseWorker(std::filesystem::path databaseFile,
+    DatabasePragmas pragmas,
+    std::shared_ptr<spdlog::logger> logger,
+    Dispatcher dispatcher)
+    : mDatabaseFile(std::move(databaseFile))
+    , pLogger(logger)
+    , pDatabase(std::make_shared<Database>(logger, std::move(pragmas)))
+    , mDispatcher(std::move(dispatcher))
+    , mThread()
+    , bRunning(false)
+    , mMutex()
+    , mCondition()
+    , mQueue()
+    , bStopRequested(false)
+    , bStopped(false)
+    , mMaxQueueDepth(0)
+    , mCompletedRequests(0)
+    , mTotalWait(Clock::duration::zero())
+    , mMaxWait(Clock::duration::zero())
+    , mTotalRun(Clock::duration::zero())
+    , mMaxRun(Clock::duration::zero())
+{
+}
+
+DatabaseWorker::~DatabaseWorker()
+{
+    Stop();
+}
+
+void DatabaseWorker::Start()
+{
+    if (mThread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        bStopRequested = false;
+        bStopped = false;
+    }
+
+    bRunning = true;
+    mThread = std::thread(&DatabaseWorker::Run, this);
+}
+
+void DatabaseWorker::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        bStopRequested = true;
+    }
+    mCondition.notify_one();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    // whatever arrived after the final drain is dropped, which breaks its promise
+    std::lock_guard<std::mutex> lock(mMutex);
+    bStopped = true;
+    if (!mQueue.empty()) {
+        pLogger->warn("Database worker dropped {0} requests submitted after it stopped", mQueue.size());
+        mQueue.clear();
+    }
+}
+
+bool DatabaseWorker::IsRunning() const
+{
+    return bRunning;
+}
+
+DatabaseWorkerStats DatabaseWorker::GetStats() const
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const auto completed = std::max<std::uint64_t>(mCompletedRequests, 1);
+    return { mQueue.size(),
+        mMaxQueueDepth,
+        mCompletedRequests,
+        duration_cast<microseconds>(mTotalWait / completed),
+        duration_cast<microseconds>(mMaxWait),
+        duration_cast<microseconds>(mTotalRun / completed),
+        duration_cast<microseconds>(mMaxRun) };
+}
+
+void DatabaseWorker::Enqueue(std::function<void(std::shared_ptr<Database>)> run)
+{
+    static auto& queueDepth = MetricsRegistry::GetInstance().GetGauge("database_worker.queue_depth");
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (bStopped) {
+            pLogger->warn("Database request submitted after the worker stopped");
+            return;
+        }
+
+        mQueue.push_back({ std::move(run), Clock::now() });
+        mMaxQueueDepth = std::max(mMaxQueueDepth, mQueue.size());
+        queueDepth.Set(static_cast<std::int64_t>(mQueue.size()));
+    }
+    mCondition.notify_one();
+}
+
+void DatabaseWorker::Run()
+{
+    TKS_TRACE_THREAD_NAME("database worker");
+    auto& queueDepth = MetricsRegistry::GetInstance().GetGauge("database_worker.queue_depth");
+    auto& waitLatency = MetricsRegistry::GetInstance().GetHistogram("database_worker.wait");
+    auto& runLatency = MetricsRegistry::GetInstance().GetHistogram("database_worker.run");
+
+    if (!pDatabase->Open(mDatabaseFile)) {
+        // requests still run so their futures resolve, they see a closed connection and fail
+        pLogger->error("Database worker failed to open {0}", mDatabaseFile.u8string());
+    }
+
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return bStopRequested || !mQueue.empty(); });
+
+            if (mQueue.empty()) {
+                break;
+            }
+
+            request = std::move(mQueue.front());
+            mQueue.pop_front();
+            queueDepth.Set(static_cast<std::int64_t>(mQueue.size()));
+        }
+
+        const auto startedAt = Clock::now();
+        {
+            TKS_TRACE_SCOPE("database_worker/request");
+            request.run(pDatabase);
+        }
+        const auto finishedAt = Clock::now();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        const auto wait = startedAt - request.queuedAt;
+        const auto run = finishedAt - startedAt;
+        waitLatency.Record(wait);
+        runLatency.Record(run);
+        mCompletedRequests++;
+        mTotalWait += wait;
+        mMaxWait = std::max(mMaxWait, wait);
+        mTotalRun += run;
+        mMaxRun = std::max(mMaxRun, run);
+    }
+
+    pDatabase->Close();
+    bRunning = false;
+}
+} // namespace app::Core
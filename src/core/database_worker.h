@@ -0,0 +1,150 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "database.h"
+
+namespace app::Core
+{
+struct DatabaseWorkerStats {
+    std::size_t queueDepth;
+    std::size_t maxQueueDepth;
+    std::uint64_t completedRequests;
+    std::chrono::microseconds averageWait;
+    std::chrono::microseconds maxWait;
+    std::chrono::microseconds averageRun;
+    std::chrono::microseconds maxRun;
+};
+
+// Owns the application's write connection on a thread of its own and runs database requests from a queue in the
+// order they were submitted, so the UI thread never waits on the disk or on locks held by other processes.
+//
+// A request is any callable taking std::shared_ptr<Database>; it must not keep the connection beyond its own run.
+// Completions are handed to the dispatcher, which moves them onto the UI thread (CallAfter in the application).
+class DatabaseWorker final
+{
+public:
+    using Dispatcher = std::function<void(std::function<void()>)>;
+
+    template<typename Request>
+    using RequestResult = std::invoke_result_t<std::decay_t<Request>&, std::shared_ptr<Database>>;
+
+    DatabaseWorker(std::filesystem::path databaseFile,
+        DatabasePragmas pragmas,
+        std::shared_ptr<spdlog::logger> logger,
+        Dispatcher dispatcher);
+    DatabaseWorker(const DatabaseWorker&) = delete;
+    ~DatabaseWorker();
+
+    DatabaseWorker& operator=(const DatabaseWorker&) = delete;
+
+    // Starts the thread, which opens the connection before running any request.
+    // Requests can be submitted before the connection is open.
+    void Start();
+
+    // Runs the requests that are already queued, then closes the connection and joins the thread.
+    // Requests submitted after this are dropped and their futures report a broken promise.
+    void Stop();
+
+    bool IsRunning() const;
+
+    // Queues the request, the future holds its result
+    template<typename Request>
+    std::future<RequestResult<Request>> Submit(Request&& request)
+    {
+        using Result = RequestResult<Request>;
+
+        auto task = std::make_shared<std::packaged_task<Result(std::shared_ptr<Database>)>>(
+            std::forward<Request>(request));
+        auto future = task->get_future();
+        Enqueue([task](std::shared_ptr<Database> database) { (*task)(std::move(database)); });
+        return future;
+    }
+
+    // Queues the request and passes its result to the completion on the dispatcher's thread
+    template<typename Request, typename Completion>
+    void Submit(Request&& request, Completion&& completion)
+    {
+        using Result = RequestResult<Request>;
+
+        Enqueue([this, request = std::forward<Request>(request), completion = std::forward<Completion>(completion)](
+                    std::shared_ptr<Database> database) mutable {
+            if constexpr (std::is_void_v<Result>) {
+                request(std::move(database));
+                mDispatcher(completion);
+            } else {
+                mDispatcher([completion, result = request(std::move(database))]() mutable {
+                    completion(std::move(result));
+                });
+            }
+        });
+    }
+
+    DatabaseWorkerStats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        std::function<void(std::shared_ptr<Database>)> run;
+        Clock::time_point queuedAt;
+    };
+
+    void Enqueue(std::function<void(std::shared_ptr<Database>)> run);
+    void Run();
+
+    std::filesystem::path mDatabaseFile;
+    std::shared_ptr<spdlog::logger> pLogger;
+    std::shared_ptr<Database> pDatabase;
+    Dispatcher mDispatcher;
+
+    std::thread mThread;
+    std::atomic<bool> bRunning;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Request> mQueue;
+    bool bStopRequested;
+    bool bStopped;
+
+    std::size_t mMaxQueueDepth;
+    std::uint64_t mCompletedRequests;
+    Clock::duration mTotalWait;
+    Clock::duration mMaxWait;
+    Clock::duration mTotalRun;
+    Clock::duration mMaxRun;
+};
+} // namespace app::Core
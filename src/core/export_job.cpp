@@ -0,0 +1,105 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "export_job.h"
+
+#include "time_entry_archive.h"
+
+namespace app::Core
+{
+ExportJob::ExportJob(std::filesystem::path databaseFile,
+    DatabasePragmas pragmas,
+    std::shared_ptr<spdlog::logger> logger,
+    Dispatcher dispatcher)
+    : mDatabaseFile(std::move(databaseFile))
+    , mPragmas(std::move(pragmas))
+    , pLogger(logger)
+    , mDispatcher(std::move(dispatcher))
+    , mThread()
+    , bRunning(false)
+    , bCancelRequested(false)
+{
+}
+
+ExportJob::~ExportJob()
+{
+    Cancel();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+bool ExportJob::Start(ExportOptions options,
+    TimeEntryExporter::ProgressCallback onProgress,
+    FinishedCallback onFinished)
+{
+    if (bRunning) {
+        pLogger->warn("Export to {0} requested while another export is running", options.file.u8string());
+        return false;
+    }
+
+    // the previous export has already finished, only its thread is left to join
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    bCancelRequested = false;
+    bRunning = true;
+    mThread = std::thread(&ExportJob::Run, this, std::move(options), std::move(onProgress), std::move(onFinished));
+    return true;
+}
+
+void ExportJob::Cancel()
+{
+    bCancelRequested = true;
+}
+
+bool ExportJob::IsRunning() const
+{
+    return bRunning;
+}
+
+void ExportJob::Run(ExportOptions options,
+    TimeEntryExporter::ProgressCallback onProgress,
+    FinishedCallback onFinished)
+{
+    ExportStatus status = ExportStatus::Failed;
+    std::int64_t rowsWritten = 0;
+
+    auto database = std::make_shared<Database>(pLogger, mPragmas);
+    // archives are attached to the connection that reads them, so this one needs its own view of them
+    auto archive = std::make_shared<TimeEntryArchive>(database, mDatabaseFile, pLogger);
+    if (database->Open(mDatabaseFile) && archive->Load()) {
+        TimeEntryExporter exporter(database, pLogger);
+        exporter.SetArchive(archive);
+        status = exporter.Export(
+            options,
+            [this, &onProgress](std::int64_t written, std::int64_t total) {
+                mDispatcher([onProgress, written, total]() { onProgress(written, total); });
+            },
+            bCancelRequested,
+            rowsWritten);
+    }
+    archive.reset();
+    database.reset();
+
+    bRunning = false;
+    mDispatcher([onFinished, status, rowsWritten]() { onFinished(status, rowsWritten); });
+}
+} // namespace app::Core
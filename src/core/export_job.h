@@ -0,0 +1,73 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+#include "database.h"
+#include "time_entry_export.h"
+
+namespace app::Core
+{
+// Runs one export at a time on a background thread with its own connection. Progress and the result are
+// handed to the dispatcher, which runs them on the UI thread.
+class ExportJob final
+{
+public:
+    using Dispatcher = std::function<void(std::function<void()>)>;
+    using FinishedCallback = std::function<void(ExportStatus status, std::int64_t rowsWritten)>;
+
+    ExportJob(std::filesystem::path databaseFile,
+        DatabasePragmas pragmas,
+        std::shared_ptr<spdlog::logger> logger,
+        Dispatcher dispatcher);
+    ExportJob(const ExportJob&) = delete;
+    ~ExportJob();
+
+    ExportJob& operator=(const ExportJob&) = delete;
+
+    // Returns false when an export is already running
+    bool Start(ExportOptions options, TimeEntryExporter::ProgressCallback onProgress, FinishedCallback onFinished);
+
+    // The partial file is removed and onFinished receives ExportStatus::Cancelled
+    void Cancel();
+
+    bool IsRunning() const;
+
+private:
+    void Run(ExportOptions options, TimeEntryExporter::ProgressCallback onProgress, FinishedCallback onFinished);
+
+    std::filesystem::path mDatabaseFile;
+    DatabasePragmas mPragmas;
+    std::shared_ptr<spdlog::logger> pLogger;
+    Dispatcher mDispatcher;
+
+    std::thread mThread;
+    std::atomic<bool> bRunning;
+    std::atomic<bool> bCancelRequested;
+};
+} // namespace app::Core
@@ -0,0 +1,391 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "gzip_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace app::Core
+{
+namespace
+{
+// 15 window bits plus 16 selects the gzip wrapper, plus 32 lets inflate detect gzip or zlib headers
+constexpr int GzipWindowBits = 15 + 16;
+constexpr int DetectWindowBits = 15 + 32;
+constexpr int MemoryLevel = 8;
+} // namespace
+
+GzipWriter::GzipWriter()
+    : mStream()
+    , mOutput()
+    , mBuffer(ChunkSize)
+    , mBytesIn(0)
+    , mBytesOut(0)
+    , bOpen(false)
+{
+}
+
+GzipWriter::~GzipWriter()
+{
+    Close();
+}
+
+bool GzipWriter::Open(const std::filesystem::path& file, int level)
+{
+    Close();
+
+    std::memset(&mStream, 0, sizeof(mStream));
+    if (deflateInit2(&mStream, level, Z_DEFLATED, GzipWindowBits, MemoryLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    mOutput.open(file, std::ios::binary | std::ios::trunc);
+    if (!mOutput.is_open()) {
+        deflateEnd(&mStream);
+        return false;
+    }
+
+    mBytesIn = 0;
+    mBytesOut = 0;
+    bOpen = true;
+    return true;
+}
+
+bool GzipWriter::Write(const char* data, std::size_t size)
+{
+    if (!bOpen) {
+        return false;
+    }
+
+    // avail_in is 32 bits wide, feed larger writes in pieces
+    while (size > 0) {
+        const std::size_t piece = std::min<std::size_t>(size, ChunkSize);
+        mStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        mStream.avail_in = static_cast<uInt>(piece);
+        if (!Deflate(Z_NO_FLUSH)) {
+            return false;
+        }
+
+        mBytesIn += piece;
+        data += piece;
+        size -= piece;
+    }
+
+    return true;
+}
+
+bool GzipWriter::Finish()
+{
+    if (!bOpen) {
+        return false;
+    }
+
+    mStream.next_in = nullptr;
+    mStream.avail_in = 0;
+    const bool finished = Deflate(Z_FINISH);
+
+    deflateEnd(&mStream);
+    mOutput.close();
+    bOpen = false;
+    return finished && !mOutput.fail();
+}
+
+std::uint64_t GzipWriter::BytesIn() const
+{
+    return mBytesIn;
+}
+
+std::uint64_t GzipWriter::BytesOut() const
+{
+    return mBytesOut;
+}
+
+bool GzipWriter::Deflate(int flush)
+{
+    int rc = Z_OK;
+    do {
+        mStream.next_out = reinterpret_cast<Bytef*>(mBuffer.data());
+        mStream.avail_out = static_cast<uInt>(mBuffer.size());
+
+        rc = deflate(&mStream, flush);
+        if (rc == Z_STREAM_ERROR) {
+            return false;
+        }
+
+        const std::size_t produced = mBuffer.size() - mStream.avail_out;
+        if (produced > 0 && !mOutput.write(mBuffer.data(), static_cast<std::streamsize>(produced))) {
+            return false;
+        }
+        mBytesOut += produced;
+    } while (mStream.avail_out == 0 || (flush == Z_FINISH && rc != Z_STREAM_END));
+
+    return true;
+}
+
+void GzipWriter::Close()
+{
+    if (bOpen) {
+        deflateEnd(&mStream);
+        mOutput.close();
+        bOpen = false;
+    }
+}
+
+GzipReader::GzipReader()
+    : mStream()
+    , mInput()
+    , mBuffer(ChunkSize)
+    , mBytesIn(0)
+    , bOpen(false)
+    , bGood(false)
+    , bEnd(false)
+{
+}
+
+GzipReader::~GzipReader()
+{
+    Close();
+}
+
+bool GzipReader::Open(const std::filesystem::path& file)
+{
+    Close();
+
+    std::memset(&mStream, 0, sizeof(mStream));
+    if (inflateInit2(&mStream, DetectWindowBits) != Z_OK) {
+        return false;
+    }
+
+    mInput.open(file, std::ios::binary);
+    if (!mInput.is_open()) {
+        inflateEnd(&mStream);
+        return false;
+    }
+
+    mBytesIn = 0;
+    bOpen = true;
+    bGood = true;
+    bEnd = false;
+    return true;
+}
+
+std::size_t GzipReader::Read(char* data, std::size_t size)
+{
+    if (!bOpen || !bGood || bEnd) {
+        return 0;
+    }
+
+    mStream.next_out = reinterpret_cast<Bytef*>(data);
+    mStream.avail_out = static_cast<uInt>(std::min<std::size_t>(size, ChunkSize));
+    const uInt requested = mStream.avail_out;
+
+    while (mStream.avail_out > 0) {
+        if (mStream.avail_in == 0) {
+            mInput.read(mBuffer.data(), static_cast<std::streamsize>(mBuffer.size()));
+            const std::streamsize read = mInput.gcount();
+            if (read == 0) {
+                // the input ended before the gzip trailer
+                bGood = false;
+                break;
+            }
+
+            mBytesIn += static_cast<std::uint64_t>(read);
+            mStream.next_in = reinterpret_cast<Bytef*>(mBuffer.data());
+            mStream.avail_in = static_cast<uInt>(read);
+        }
+
+        const int rc = inflate(&mStream, Z_NO_FLUSH);
+        if (rc == Z_STREAM_END) {
+            // another member may follow the one that just ended
+            if (mStream.avail_in == 0 && mInput.peek() == std::char_traits<char>::eof()) {
+                bEnd = true;
+                break;
+            }
+            inflateReset(&mStream);
+        } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            bGood = false;
+            break;
+        }
+    }
+
+    return requested - mStream.avail_out;
+}
+
+bool GzipReader::Good() const
+{
+    return bGood;
+}
+
+std::uint64_t GzipReader::BytesIn() const
+{
+    return mBytesIn;
+}
+
+void GzipReader::Close()
+{
+    if (bOpen) {
+        inflateEnd(&mStream);
+        mInput.close();
+        bOpen = false;
+    }
+}
+
+FileCompressor::FileCompressor(std::shared_ptr<spdlog::logger> logger)
+    : pLogger(logger)
+{
+}
+
+bool FileCompressor::Compress(const std::filesystem::path& source,
+    const std::filesystem::path& target,
+    int level,
+    const std::atomic<bool>& cancelled,
+    CompressionStats& stats)
+{
+    const auto startedAt = std::chrono::steady_clock::now();
+
+    std::ifstream input(source, std::ios::binary);
+    if (!input.is_open()) {
+        pLogger->error("Failed to open {0} for compression", source.u8string());
+        return false;
+    }
+
+    GzipWriter writer;
+    if (!writer.Open(target, level)) {
+        pLogger->error("Failed to open {0} for compressed output", target.u8string());
+        return false;
+    }
+
+    std::vector<char> chunk(GzipWriter::ChunkSize);
+    bool written = true;
+    while (written && input) {
+        if (cancelled.load(std::memory_order_relaxed)) {
+            pLogger->info("Compression of {0} cancelled after {1} bytes", source.u8string(), writer.BytesIn());
+            writer.Finish();
+            std::error_code ec;
+            std::filesystem::remove(target, ec);
+            return false;
+        }
+
+        input.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        const std::streamsize read = input.gcount();
+        written = read == 0 || writer.Write(chunk.data(), static_cast<std::size_t>(read));
+    }
+
+    const bool finished = writer.Finish();
+    if (!written || !finished || input.bad()) {
+        pLogger->error("Failed to compress {0} to {1}", source.u8string(), target.u8string());
+        std::error_code ec;
+        std::filesystem::remove(target, ec);
+        return false;
+    }
+
+    stats.uncompressedBytes = writer.BytesIn();
+    stats.compressedBytes = writer.BytesOut();
+    stats.elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startedAt);
+    LogStats("Compressed", source, stats, level);
+    return true;
+}
+
+bool FileCompressor::Decompress(const std::filesystem::path& source,
+    const std::filesystem::path& target,
+    const std::atomic<bool>& cancelled,
+    CompressionStats& stats)
+{
+    const auto startedAt = std::chrono::steady_clock::now();
+
+    GzipReader reader;
+    if (!reader.Open(source)) {
+        pLogger->error("Failed to open {0} for decompression", source.u8string());
+        return false;
+    }
+
+    std::ofstream output(target, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        pLogger->error("Failed to open {0} for decompressed output", target.u8string());
+        return false;
+    }
+
+    std::vector<char> chunk(GzipReader::ChunkSize);
+    std::uint64_t uncompressedBytes = 0;
+    for (std::size_t read = reader.Read(chunk.data(), chunk.size()); read > 0;
+         read = reader.Read(chunk.data(), chunk.size())) {
+        if (cancelled.load(std::memory_order_relaxed)) {
+            pLogger->info("Decompression of {0} cancelled after {1} bytes", source.u8string(), uncompressedBytes);
+            output.close();
+            std::error_code ec;
+            std::filesystem::remove(target, ec);
+            return false;
+        }
+
+        if (!output.write(chunk.data(), static_cast<std::streamsize>(read))) {
+            break;
+        }
+        uncompressedBytes += read;
+    }
+    output.close();
+
+    if (!reader.Good() || output.fail()) {
+        pLogger->error("Failed to decompress {0} to {1}", source.u8string(), target.u8string());
+        std::error_code ec;
+        std::filesystem::remove(target, ec);
+        return false;
+    }
+
+    stats.uncompressedBytes = uncompressedBytes;
+    stats.compressedBytes = reader.BytesIn();
+    stats.elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startedAt);
+    LogStats("Decompressed", source, stats, -1);
+    return true;
+}
+
+void FileCompressor::LogStats(const char* action,
+    const std::filesystem::path& file,
+    const CompressionStats& stats,
+    int level)
+{
+    const double seconds = std::max(stats.elapsed.count(), std::chrono::milliseconds::rep{ 1 }) / 1000.0;
+    const double ratio =
+        stats.compressedBytes > 0 ? static_cast<double>(stats.uncompressedBytes) / stats.compressedBytes : 0.0;
+    const double megabytesPerSecond = stats.uncompressedBytes / seconds / (1024.0 * 1024.0);
+
+    if (level >= 0) {
+        pLogger->info("{0} {1}: {2} to {3} bytes (ratio {4:.2f}) at level {5} in {6}ms, {7:.1f} MiB/s",
+            action,
+            file.u8string(),
+            stats.uncompressedBytes,
+            stats.compressedBytes,
+            ratio,
+            level,
+            stats.elapsed.count(),
+            megabytesPerSecond);
+    } else {
+        pLogger->info("{0} {1}: {2} to {3} bytes (ratio {4:.2f}) in {5}ms, {6:.1f} MiB/s",
+            action,
+            file.u8string(),
+            stats.compressedBytes,
+            stats.uncompressedBytes,
+            ratio,
+            stats.elapsed.count(),
+            megabytesPerSecond);
+    }
+}
+} // namespace app::Core
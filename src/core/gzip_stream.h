@@ -0,0 +1,134 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <zlib.h>
+
+namespace app::Core
+{
+// Deflates into a gzip file in fixed-size chunks, so memory use does not depend on how much is written
+class GzipWriter final
+{
+public:
+    static constexpr std::size_t ChunkSize = 256 * 1024;
+
+    GzipWriter();
+    GzipWriter(const GzipWriter&) = delete;
+    ~GzipWriter();
+
+    GzipWriter& operator=(const GzipWriter&) = delete;
+
+    // level is a zlib level from 1 (fastest) to 9 (smallest)
+    bool Open(const std::filesystem::path& file, int level);
+    bool Write(const char* data, std::size_t size);
+
+    // Writes out what deflate still holds and closes the file
+    bool Finish();
+
+    std::uint64_t BytesIn() const;
+    std::uint64_t BytesOut() const;
+
+private:
+    bool Deflate(int flush);
+    void Close();
+
+    z_stream mStream;
+    std::ofstream mOutput;
+    std::vector<char> mBuffer;
+    std::uint64_t mBytesIn;
+    std::uint64_t mBytesOut;
+    bool bOpen;
+};
+
+// Inflates a gzip file in fixed-size chunks. Files made of several gzip members are read as one stream.
+class GzipReader final
+{
+public:
+    static constexpr std::size_t ChunkSize = 256 * 1024;
+
+    GzipReader();
+    GzipReader(const GzipReader&) = delete;
+    ~GzipReader();
+
+    GzipReader& operator=(const GzipReader&) = delete;
+
+    bool Open(const std::filesystem::path& file);
+
+    // Returns the number of bytes read, 0 at the end of the data or on an error (see Good)
+    std::size_t Read(char* data, std::size_t size);
+
+    bool Good() const;
+    std::uint64_t BytesIn() const;
+
+private:
+    void Close();
+
+    z_stream mStream;
+    std::ifstream mInput;
+    std::vector<char> mBuffer;
+    std::uint64_t mBytesIn;
+    bool bOpen;
+    bool bGood;
+    bool bEnd;
+};
+
+struct CompressionStats {
+    std::uint64_t uncompressedBytes = 0;
+    std::uint64_t compressedBytes = 0;
+    std::chrono::milliseconds elapsed = std::chrono::milliseconds(0);
+};
+
+// Streams whole files through gzip and logs the throughput and ratio of each run, so the level can be tuned
+class FileCompressor final
+{
+public:
+    explicit FileCompressor(std::shared_ptr<spdlog::logger> logger);
+    FileCompressor(const FileCompressor&) = delete;
+    ~FileCompressor() = default;
+
+    FileCompressor& operator=(const FileCompressor&) = delete;
+
+    // cancelled is checked once per chunk. The target is removed again if anything fails or the run is cancelled.
+    bool Compress(const std::filesystem::path& source,
+        const std::filesystem::path& target,
+        int level,
+        const std::atomic<bool>& cancelled,
+        CompressionStats& stats);
+    bool Decompress(const std::filesystem::path& source,
+        const std::filesystem::path& target,
+        const std::atomic<bool>& cancelled,
+        CompressionStats& stats);
+
+private:
+    void LogStats(const char* action, const std::filesystem::path& file, const CompressionStats& stats, int level);
+
+    std::shared_ptr<spdlog::logger> pLogger;
+};
+} // namespace app::Core
@@ -0,0 +1,114 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "local_time.h"
+
+#include <ctime>
+
+namespace app::Core
+{
+namespace
+{
+std::int64_t FloorDivide(std::int64_t value, std::int64_t divisor)
+{
+    return value / divisor - (value % divisor < 0 ? 1 : 0);
+}
+} // namespace
+
+std::int64_t DaysFromCivil(std::int64_t year, unsigned month, unsigned day)
+{
+    year -= month <= 2 ? 1 : 0;
+    const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const std::int64_t yearOfEra = year - era * 400;
+    const std::int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const std::int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+CivilTime ToCivilTime(std::int64_t seconds)
+{
+    const std::int64_t days = FloorDivide(seconds, 86400);
+    const std::int64_t secondOfDay = seconds - days * 86400;
+
+    const std::int64_t shifted = days + 719468;
+    const std::int64_t era = (shifted >= 0 ? shifted : shifted - 146096) / 146097;
+    const std::int64_t dayOfEra = shifted - era * 146097;
+    const std::int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const std::int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const std::int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    const unsigned month = static_cast<unsigned>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+
+    return CivilTime{ yearOfEra + era * 400 + (month <= 2 ? 1 : 0),
+        month,
+        static_cast<unsigned>(dayOfYear - (153 * monthIndex + 2) / 5 + 1),
+        static_cast<unsigned>(secondOfDay / 3600),
+        static_cast<unsigned>(secondOfDay / 60 % 60),
+        static_cast<unsigned>(secondOfDay % 60) };
+}
+
+std::int64_t FromCivilTime(const CivilTime& civil)
+{
+    return DaysFromCivil(civil.year, civil.month, civil.day) * 86400 + civil.hour * 3600 + civil.minute * 60 +
+           civil.second;
+}
+
+std::int64_t LocalTimeConverter::ToLocal(std::int64_t timestamp)
+{
+    const std::int64_t bucket = FloorDivide(timestamp, OffsetBucketSeconds);
+    if (!mToLocal.isValid || mToLocal.bucket != bucket) {
+        const std::time_t time = static_cast<std::time_t>(timestamp);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &time);
+#else
+        localtime_r(&time, &local);
+#endif // _WIN32
+
+        const CivilTime civil{ local.tm_year + 1900,
+            static_cast<unsigned>(local.tm_mon + 1),
+            static_cast<unsigned>(local.tm_mday),
+            static_cast<unsigned>(local.tm_hour),
+            static_cast<unsigned>(local.tm_min),
+            static_cast<unsigned>(local.tm_sec) };
+        mToLocal = CachedOffset{ bucket, FromCivilTime(civil) - timestamp, true };
+    }
+
+    return timestamp + mToLocal.offset;
+}
+
+std::int64_t LocalTimeConverter::FromLocal(std::int64_t localSeconds)
+{
+    const std::int64_t bucket = FloorDivide(localSeconds, OffsetBucketSeconds);
+    if (!mFromLocal.isValid || mFromLocal.bucket != bucket) {
+        const CivilTime civil = ToCivilTime(localSeconds);
+        std::tm local{};
+        local.tm_year = static_cast<int>(civil.year - 1900);
+        local.tm_mon = static_cast<int>(civil.month) - 1;
+        local.tm_mday = static_cast<int>(civil.day);
+        local.tm_hour = static_cast<int>(civil.hour);
+        local.tm_min = static_cast<int>(civil.minute);
+        local.tm_sec = static_cast<int>(civil.second);
+        local.tm_isdst = -1;
+
+        mFromLocal = CachedOffset{ bucket, localSeconds - static_cast<std::int64_t>(std::mktime(&local)), true };
+    }
+
+    return localSeconds - mFromLocal.offset;
+}
+} // namespace app::Core
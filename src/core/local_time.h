@@ -0,0 +1,68 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstdint>
+
+namespace app::Core
+{
+// A broken-down proleptic Gregorian date and time of day, with no time zone attached
+struct CivilTime {
+    std::int64_t year;
+    unsigned month;
+    unsigned day;
+    unsigned hour;
+    unsigned minute;
+    unsigned second;
+};
+
+// Days since 1970-01-01 of a civil date
+std::int64_t DaysFromCivil(std::int64_t year, unsigned month, unsigned day);
+
+// Splits seconds since 1970-01-01T00:00:00 into a civil date and time
+CivilTime ToCivilTime(std::int64_t seconds);
+
+// Seconds since 1970-01-01T00:00:00 of a civil date and time
+std::int64_t FromCivilTime(const CivilTime& civil);
+
+// Converts between unix timestamps and local wall-clock seconds (local time counted as if it were UTC).
+// Going through the C library per row is slow, so offsets are cached per quarter hour, the finest step any
+// time zone changes its offset at. Keep one converter per pass over sorted rows.
+class LocalTimeConverter final
+{
+public:
+    static constexpr std::int64_t OffsetBucketSeconds = 900;
+
+    std::int64_t ToLocal(std::int64_t timestamp);
+
+    // Wall-clock times skipped by a daylight saving change resolve the same way as mktime
+    std::int64_t FromLocal(std::int64_t localSeconds);
+
+private:
+    struct CachedOffset {
+        std::int64_t bucket = 0;
+        std::int64_t offset = 0;
+        bool isValid = false;
+    };
+
+    CachedOffset mToLocal;
+    CachedOffset mFromLocal;
+};
+} // namespace app::Core
@@ -0,0 +1,202 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "mapped_file.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace app::Core
+{
+#ifdef _WIN32
+MappedFile::MappedFile()
+    : pData(nullptr)
+    , mSize(0)
+    , pFile(INVALID_HANDLE_VALUE)
+    , pMapping(nullptr)
+{
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : pData(std::exchange(other.pData, nullptr))
+    , mSize(std::exchange(other.mSize, 0))
+    , pFile(std::exchange(other.pFile, INVALID_HANDLE_VALUE))
+    , pMapping(std::exchange(other.pMapping, nullptr))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        Close();
+        pData = std::exchange(other.pData, nullptr);
+        mSize = std::exchange(other.mSize, 0);
+        pFile = std::exchange(other.pFile, INVALID_HANDLE_VALUE);
+        pMapping = std::exchange(other.pMapping, nullptr);
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::filesystem::path& file)
+{
+    Close();
+
+    pFile = CreateFileW(file.wstring().c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+        nullptr);
+    if (pFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(pFile, &size) || size.QuadPart == 0) {
+        Close();
+        return false;
+    }
+
+    pMapping = CreateFileMappingW(pFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (pMapping == nullptr) {
+        Close();
+        return false;
+    }
+
+    pData = static_cast<const std::uint8_t*>(MapViewOfFile(pMapping, FILE_MAP_READ, 0, 0, 0));
+    if (pData == nullptr) {
+        Close();
+        return false;
+    }
+
+    mSize = static_cast<std::size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (pData != nullptr) {
+        UnmapViewOfFile(pData);
+        pData = nullptr;
+    }
+    if (pMapping != nullptr) {
+        CloseHandle(pMapping);
+        pMapping = nullptr;
+    }
+    if (pFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(pFile);
+        pFile = INVALID_HANDLE_VALUE;
+    }
+    mSize = 0;
+}
+#else
+MappedFile::MappedFile()
+    : pData(nullptr)
+    , mSize(0)
+    , mFileDescriptor(-1)
+{
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : pData(std::exchange(other.pData, nullptr))
+    , mSize(std::exchange(other.mSize, 0))
+    , mFileDescriptor(std::exchange(other.mFileDescriptor, -1))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        Close();
+        pData = std::exchange(other.pData, nullptr);
+        mSize = std::exchange(other.mSize, 0);
+        mFileDescriptor = std::exchange(other.mFileDescriptor, -1);
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::filesystem::path& file)
+{
+    Close();
+
+    mFileDescriptor = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (mFileDescriptor == -1) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(mFileDescriptor, &info) != 0 || info.st_size == 0) {
+        Close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, mFileDescriptor, 0);
+    if (data == MAP_FAILED) {
+        Close();
+        return false;
+    }
+
+    pData = static_cast<const std::uint8_t*>(data);
+    mSize = static_cast<std::size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (pData != nullptr) {
+        munmap(const_cast<std::uint8_t*>(pData), mSize);
+        pData = nullptr;
+    }
+    if (mFileDescriptor != -1) {
+        close(mFileDescriptor);
+        mFileDescriptor = -1;
+    }
+    mSize = 0;
+}
+#endif // _WIN32
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::IsOpen() const
+{
+    return pData != nullptr;
+}
+
+const std::uint8_t* MappedFile::Data() const
+{
+    return pData;
+}
+
+std::size_t MappedFile::Size() const
+{
+    return mSize;
+}
+} // namespace app::Core
@@ -0,0 +1,57 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace app::Core
+{
+// Read-only memory mapping of a whole file. Pages are only read from disk when first touched.
+class MappedFile final
+{
+public:
+    MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool Open(const std::filesystem::path& file);
+    void Close();
+
+    bool IsOpen() const;
+    const std::uint8_t* Data() const;
+    std::size_t Size() const;
+
+private:
+    const std::uint8_t* pData;
+    std::size_t mSize;
+#ifdef _WIN32
+    void* pFile;
+    void* pMapping;
+#else
+    int mFileDescriptor;
+#endif // _WIN32
+};
+} // namespace app::Core
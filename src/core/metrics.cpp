@@ -0,0 +1,272 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/fmt/fmt.h>
+
+#include "../utils/utils.h"
+
+namespace app::Core
+{
+namespace
+{
+int HighestBit(std::uint64_t value)
+{
+    int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+
+std::int64_t GetPercentile(const std::vector<std::int64_t>& buckets,
+    std::int64_t count,
+    double percentile,
+    std::int64_t min,
+    std::int64_t max)
+{
+    const auto rank = static_cast<std::int64_t>(percentile * static_cast<double>(count - 1)) + 1;
+    std::int64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            // the middle of the bucket, the recorded extremes are exact
+            const std::int64_t lower = LatencyHistogram::GetBucketLowerBound(i);
+            const std::int64_t upper =
+                i + 1 < LatencyHistogram::BucketCount ? LatencyHistogram::GetBucketLowerBound(i + 1) - 1 : max;
+            return std::clamp(lower + (upper - lower) / 2, min, max);
+        }
+    }
+    return max;
+}
+
+void AtomicMin(std::atomic<std::int64_t>& target, std::int64_t value)
+{
+    std::int64_t current = target.load(std::memory_order_relaxed);
+    while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void AtomicMax(std::atomic<std::int64_t>& target, std::int64_t value)
+{
+    std::int64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+} // namespace
+
+void LatencyHistogram::Record(std::chrono::nanoseconds duration)
+{
+    const std::int64_t value = std::max<std::int64_t>(0, duration.count());
+    mBuckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(value, std::memory_order_relaxed);
+    AtomicMin(mMin, value);
+    AtomicMax(mMax, value);
+}
+
+HistogramSnapshot LatencyHistogram::GetSnapshot() const
+{
+    // concurrent recording can make the fields disagree by an event or two, which is fine for reporting
+    std::vector<std::int64_t> buckets(BucketCount);
+    std::int64_t count = 0;
+    for (std::size_t i = 0; i < BucketCount; i++) {
+        buckets[i] = mBuckets[i].load(std::memory_order_relaxed);
+        count += buckets[i];
+    }
+
+    if (count == 0) {
+        return HistogramSnapshot{ 0, 0, 0, 0, 0, 0, 0, 0 };
+    }
+
+    const std::int64_t min = mMin.load(std::memory_order_relaxed);
+    const std::int64_t max = mMax.load(std::memory_order_relaxed);
+    return HistogramSnapshot{ count,
+        mSum.load(std::memory_order_relaxed),
+        min,
+        max,
+        GetPercentile(buckets, count, 0.5, min, max),
+        GetPercentile(buckets, count, 0.9, min, max),
+        GetPercentile(buckets, count, 0.99, min, max),
+        GetPercentile(buckets, count, 0.999, min, max) };
+}
+
+std::size_t LatencyHistogram::GetBucketIndex(std::int64_t value)
+{
+    // the first two powers of two are exact, after that the top SubBucketBits below the highest bit pick the bucket
+    if (value < 2 * SubBuckets) {
+        return static_cast<std::size_t>(std::max<std::int64_t>(0, value));
+    }
+
+    const int bit = HighestBit(static_cast<std::uint64_t>(value));
+    return static_cast<std::size_t>((bit - SubBucketBits) * SubBuckets + (value >> (bit - SubBucketBits)));
+}
+
+std::int64_t LatencyHistogram::GetBucketLowerBound(std::size_t index)
+{
+    const auto position = static_cast<std::int64_t>(index);
+    if (position < 2 * SubBuckets) {
+        return position;
+    }
+
+    const std::int64_t bit = position / SubBuckets + SubBucketBits - 1;
+    return (position % SubBuckets + SubBuckets) << (bit - SubBucketBits);
+}
+
+MetricsRegistry& MetricsRegistry::GetInstance()
+{
+    static MetricsRegistry instance;
+    return instance;
+}
+
+MetricsRegistry::MetricsRegistry()
+    : mMutex()
+    , mCounters()
+    , mGauges()
+    , mHistograms()
+    , mStart(std::chrono::steady_clock::now())
+{
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& counter = mCounters[name];
+    if (!counter) {
+        counter = std::make_unique<Counter>();
+    }
+    return *counter;
+}
+
+Gauge& MetricsRegistry::GetGauge(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& gauge = mGauges[name];
+    if (!gauge) {
+        gauge = std::make_unique<Gauge>();
+    }
+    return *gauge;
+}
+
+LatencyHistogram& MetricsRegistry::GetHistogram(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& histogram = mHistograms[name];
+    if (!histogram) {
+        histogram = std::make_unique<LatencyHistogram>();
+    }
+    return *histogram;
+}
+
+std::string MetricsRegistry::Format()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::string text = fmt::format("Uptime {0}s\n\nCounters\n",
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - mStart).count());
+    for (const auto& [name, counter] : mCounters) {
+        text += fmt::format("  {0:<40} {1:>12}\n", name, counter->Get());
+    }
+
+    text += "\nGauges\n";
+    for (const auto& [name, gauge] : mGauges) {
+        text += fmt::format("  {0:<40} {1:>12}\n", name, gauge->Get());
+    }
+
+    text += fmt::format("\nLatencies (us){0:<28} {1:>12} {2:>10} {3:>10} {4:>10} {5:>10} {6:>10}\n",
+        "",
+        "count",
+        "mean",
+        "p50",
+        "p90",
+        "p99",
+        "max");
+    for (const auto& [name, histogram] : mHistograms) {
+        const auto snapshot = histogram->GetSnapshot();
+        const double mean = snapshot.count > 0 ? static_cast<double>(snapshot.sum) / snapshot.count : 0.0;
+        text += fmt::format("  {0:<40} {1:>12} {2:>10.1f} {3:>10.1f} {4:>10.1f} {5:>10.1f} {6:>10.1f}\n",
+            name,
+            snapshot.count,
+            mean / 1000.0,
+            snapshot.p50 / 1000.0,
+            snapshot.p90 / 1000.0,
+            snapshot.p99 / 1000.0,
+            snapshot.max / 1000.0);
+    }
+    return text;
+}
+
+bool MetricsRegistry::WriteJson(const std::filesystem::path& file, std::shared_ptr<spdlog::logger> logger)
+{
+    nlohmann::ordered_json counters = nlohmann::ordered_json::object();
+    nlohmann::ordered_json gauges = nlohmann::ordered_json::object();
+    nlohmann::ordered_json histograms = nlohmann::ordered_json::object();
+    std::chrono::seconds uptime;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        uptime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - mStart);
+        for (const auto& [name, counter] : mCounters) {
+            counters[name] = counter->Get();
+        }
+        for (const auto& [name, gauge] : mGauges) {
+            gauges[name] = gauge->Get();
+        }
+        for (const auto& [name, histogram] : mHistograms) {
+            const auto snapshot = histogram->GetSnapshot();
+            histograms[name] = {
+                { "count", snapshot.count },
+                { "sum_ns", snapshot.sum },
+                { "min_ns", snapshot.min },
+                { "p50_ns", snapshot.p50 },
+                { "p90_ns", snapshot.p90 },
+                { "p99_ns", snapshot.p99 },
+                { "p999_ns", snapshot.p999 },
+                { "max_ns", snapshot.max },
+            };
+        }
+    }
+
+    const nlohmann::ordered_json document{
+        { "timestamp", Utils::ToISODateTime(Utils::UnixTimestamp()) },
+        { "uptime_seconds", uptime.count() },
+#ifdef TKS_DEBUG
+        { "build", "debug" },
+#else
+        { "build", "release" },
+#endif
+        { "counters", counters },
+        { "gauges", gauges },
+        { "histograms", histograms },
+    };
+
+    std::ofstream output(file, std::ios::out | std::ios::trunc);
+    output << document.dump(2) << '\n';
+    if (!output) {
+        logger->error("Failed to write metrics to {0}", file.u8string());
+        return false;
+    }
+
+    logger->info("Wrote metrics to {0}", file.u8string());
+    return true;
+}
+} // namespace app::Core
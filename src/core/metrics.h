@@ -0,0 +1,168 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+namespace app::Core
+{
+class Counter final
+{
+public:
+    void Add(std::int64_t value = 1)
+    {
+        mValue.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    std::int64_t Get() const
+    {
+        return mValue.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::int64_t> mValue{ 0 };
+};
+
+class Gauge final
+{
+public:
+    void Set(std::int64_t value)
+    {
+        mValue.store(value, std::memory_order_relaxed);
+    }
+
+    void Add(std::int64_t value)
+    {
+        mValue.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    std::int64_t Get() const
+    {
+        return mValue.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::int64_t> mValue{ 0 };
+};
+
+struct HistogramSnapshot {
+    std::int64_t count;
+    std::int64_t sum;
+    std::int64_t min;
+    std::int64_t max;
+    std::int64_t p50;
+    std::int64_t p90;
+    std::int64_t p99;
+    std::int64_t p999;
+};
+
+// Latency histogram in nanoseconds with HDR-style log-linear buckets: every power of two is split into
+// SubBuckets linear buckets, so a reported percentile is within 1/SubBuckets of the recorded value at any scale.
+// Recording is a handful of relaxed atomic adds and never takes a lock.
+class LatencyHistogram final
+{
+public:
+    static constexpr int SubBucketBits = 4;
+    static constexpr std::int64_t SubBuckets = std::int64_t{ 1 } << SubBucketBits;
+    // values are non-negative 64-bit integers, so the highest set bit is at most bit 62
+    static constexpr std::size_t BucketCount = (64 - SubBucketBits) * SubBuckets;
+
+    void Record(std::chrono::nanoseconds duration);
+
+    HistogramSnapshot GetSnapshot() const;
+
+    static std::size_t GetBucketIndex(std::int64_t value);
+    static std::int64_t GetBucketLowerBound(std::size_t index);
+
+private:
+    std::array<std::atomic<std::int64_t>, BucketCount> mBuckets{};
+    std::atomic<std::int64_t> mSum{ 0 };
+    std::atomic<std::int64_t> mMin{ std::numeric_limits<std::int64_t>::max() };
+    std::atomic<std::int64_t> mMax{ 0 };
+};
+
+// Process-wide named metrics. Looking a metric up takes a lock, so call sites keep the returned reference, which
+// stays valid for the lifetime of the process:
+//
+//     static auto& misses = MetricsRegistry::GetInstance().GetCounter("translation.misses");
+//     misses.Add();
+class MetricsRegistry final
+{
+public:
+    static MetricsRegistry& GetInstance();
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    Counter& GetCounter(const std::string& name);
+    Gauge& GetGauge(const std::string& name);
+    LatencyHistogram& GetHistogram(const std::string& name);
+
+    // A plain text table of every metric, for the diagnostics dialog
+    std::string Format();
+
+    bool WriteJson(const std::filesystem::path& file, std::shared_ptr<spdlog::logger> logger);
+
+private:
+    MetricsRegistry();
+
+    std::mutex mMutex;
+    std::map<std::string, std::unique_ptr<Counter>> mCounters;
+    std::map<std::string, std::unique_ptr<Gauge>> mGauges;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> mHistograms;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+// Records the time from construction to destruction into a histogram
+class ScopedLatency final
+{
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : mHistogram(histogram)
+        , mStart(std::chrono::steady_clock::now())
+    {
+    }
+    ScopedLatency(const ScopedLatency&) = delete;
+
+    ~ScopedLatency()
+    {
+        mHistogram.Record(std::chrono::steady_clock::now() - mStart);
+    }
+
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram& mHistogram;
+    std::chrono::steady_clock::time_point mStart;
+};
+} // namespace app::Core
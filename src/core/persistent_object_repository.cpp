@@ -0,0 +1,113 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "persistent_object_repository.h"
+
+#include "database.h"
+#include "metrics.h"
+#include "trace.h"
+
+namespace app::Core
+{
+const std::string PersistentObjectRepository::SelectAllQuery = "SELECT key, value FROM persistent_objects;";
+const std::string PersistentObjectRepository::InsertQuery =
+    "INSERT OR REPLACE INTO persistent_objects(key, value) VALUES(?, ?);";
+
+PersistentObjectRepository::PersistentObjectRepository(std::shared_ptr<Database> database,
+    std::shared_ptr<spdlog::logger> logger)
+    : pDatabase(database)
+    , pLogger(logger)
+{
+}
+
+bool PersistentObjectRepository::ReadAll(PersistentValues& values)
+{
+    TKS_TRACE_SCOPE("persistence/read_all");
+    static auto& latency = MetricsRegistry::GetInstance().GetHistogram("persistence.read_all");
+    const ScopedLatency timer(latency);
+
+    auto stmt = pDatabase->Prepare(SelectAllQuery);
+    if (!stmt) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    while (stmt.Step()) {
+        auto key = stmt.Column<std::string>(0);
+        if (sqlite3_column_type(stmt.Handle(), 1) == SQLITE_INTEGER) {
+            values.emplace_back(std::move(key), stmt.Column<long>(1));
+        } else {
+            values.emplace_back(std::move(key), stmt.Column<std::string>(1));
+        }
+    }
+
+    if (stmt.HasError()) {
+        pLogger->error("Error when executing statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    return true;
+}
+
+bool PersistentObjectRepository::Write(const PersistentValues& values)
+{
+    TKS_TRACE_SCOPE("persistence/write");
+    static auto& latency = MetricsRegistry::GetInstance().GetHistogram("persistence.write");
+    const ScopedLatency timer(latency);
+
+    if (!pDatabase->IsOpen()) {
+        pLogger->error("Database closed with {0} unsaved persistent values", values.size());
+        return false;
+    }
+
+    Transaction transaction(*pDatabase);
+    if (!transaction.IsActive()) {
+        return false;
+    }
+
+    for (const auto& [key, value] : values) {
+        auto stmt = pDatabase->Prepare(InsertQuery);
+        if (!stmt || !stmt.Bind(key)) {
+            pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+            return false;
+        }
+
+        bool bound = false;
+        if (auto flag = std::get_if<bool>(&value)) {
+            bound = stmt.BindAt(2, *flag);
+        } else if (auto number = std::get_if<long>(&value)) {
+            bound = stmt.BindAt(2, *number);
+        } else {
+            bound = stmt.BindAt(2, std::get<std::string>(value));
+        }
+
+        if (!bound) {
+            pLogger->error("Failed to bind {0}", stmt.ErrorMessage());
+            return false;
+        }
+
+        if (!stmt.Execute()) {
+            pLogger->error("Error when executing statement {0}", stmt.ErrorMessage());
+            return false;
+        }
+    }
+
+    return transaction.Commit();
+}
+} // namespace app::Core
@@ -0,0 +1,60 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace app::Core
+{
+class Database;
+
+// Values are kept in their native SQLite type, text is UTF-8
+using PersistentValue = std::variant<bool, long, std::string>;
+using PersistentValues = std::vector<std::pair<std::string, PersistentValue>>;
+
+// Reads and writes the persistent_objects table behind the window state persistence
+class PersistentObjectRepository final
+{
+public:
+    PersistentObjectRepository(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger);
+    PersistentObjectRepository(const PersistentObjectRepository&) = delete;
+    ~PersistentObjectRepository() = default;
+
+    PersistentObjectRepository& operator=(const PersistentObjectRepository&) = delete;
+
+    bool ReadAll(PersistentValues& values);
+
+    // Writes all values in one transaction, replacing the stored value of each key
+    bool Write(const PersistentValues& values);
+
+private:
+    std::shared_ptr<Database> pDatabase;
+    std::shared_ptr<spdlog::logger> pLogger;
+
+    static const std::string SelectAllQuery;
+    static const std::string InsertQuery;
+};
+} // namespace app::Core
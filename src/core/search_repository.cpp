@@ -0,0 +1,198 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "search_repository.h"
+
+#include <cctype>
+
+#include "database.h"
+
+namespace app::Core
+{
+// Every match is scored and the page is cut by rank. CROSS JOIN keeps the index as the outer loop, otherwise a
+// selective filter can make SQLite run the match once per time entry.
+const std::string SearchRepository::SearchTimeEntriesQuery =
+    "SELECT te.time_entry_id, te.task_id, te.employer_id, te.start_time, te.duration, "
+    "snippet(time_entries_fts, 0, '[', ']', '...', 12), bm25(time_entries_fts) "
+    "FROM time_entries_fts "
+    "CROSS JOIN time_entries te ON te.time_entry_id = time_entries_fts.rowid "
+    "WHERE time_entries_fts MATCH ?1 "
+    "AND (?2 IS NULL OR te.employer_id = ?2) "
+    "AND (?3 IS NULL OR te.start_time >= ?3) "
+    "AND (?4 IS NULL OR te.start_time < ?4) "
+    "ORDER BY bm25(time_entries_fts) "
+    "LIMIT ?5 OFFSET ?6;";
+// ids grow with every insert, so walking the index backwards by rowid yields the newest matches first and stops as
+// soon as the page is full
+const std::string SearchRepository::SearchNewestTimeEntriesQuery =
+    "SELECT te.time_entry_id, te.task_id, te.employer_id, te.start_time, te.duration, "
+    "snippet(time_entries_fts, 0, '[', ']', '...', 12), bm25(time_entries_fts) "
+    "FROM time_entries_fts "
+    "CROSS JOIN time_entries te ON te.time_entry_id = time_entries_fts.rowid "
+    "WHERE time_entries_fts MATCH ?1 "
+    "AND (?2 IS NULL OR te.employer_id = ?2) "
+    "AND (?3 IS NULL OR te.start_time >= ?3) "
+    "AND (?4 IS NULL OR te.start_time < ?4) "
+    "ORDER BY time_entries_fts.rowid DESC "
+    "LIMIT ?5 OFFSET ?6;";
+// a hit in the task name counts ten times as much as one in its description
+const std::string SearchRepository::SearchTasksQuery =
+    "SELECT t.task_id, t.employer_id, t.name, "
+    "snippet(tasks_fts, 1, '[', ']', '...', 12), bm25(tasks_fts, 10.0, 1.0) "
+    "FROM tasks_fts "
+    "CROSS JOIN tasks t ON t.task_id = tasks_fts.rowid "
+    "WHERE tasks_fts MATCH ?1 "
+    "AND (?2 IS NULL OR t.employer_id = ?2) "
+    "ORDER BY bm25(tasks_fts, 10.0, 1.0) "
+    "LIMIT ?3 OFFSET ?4;";
+
+SearchRepository::SearchRepository(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger)
+    : pDatabase(database)
+    , pLogger(logger)
+{
+}
+
+bool SearchRepository::SearchTimeEntries(const TimeEntrySearch& search,
+    std::vector<TimeEntrySearchResult>& results,
+    bool& hasMore)
+{
+    hasMore = false;
+
+    const std::string match = BuildMatchExpression(search.text);
+    if (match.empty() || search.pageSize <= 0) {
+        return true;
+    }
+
+    // one extra row tells whether there is another page
+    auto stmt = pDatabase->Prepare(
+        search.order == SearchOrder::Newest ? SearchNewestTimeEntriesQuery : SearchTimeEntriesQuery);
+    if (!stmt || !stmt.Bind(match,
+                     search.employerId,
+                     search.from,
+                     search.to,
+                     search.pageSize + 1,
+                     static_cast<std::int64_t>(search.page) * search.pageSize)) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    int count = 0;
+    while (stmt.Step()) {
+        if (++count > search.pageSize) {
+            hasMore = true;
+            break;
+        }
+
+        results.push_back(stmt.RowAs<TimeEntrySearchResult,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t,
+            std::string,
+            double>());
+    }
+
+    if (stmt.HasError()) {
+        pLogger->error("Failed to search time entries for {0} - ({1})", search.text, stmt.ErrorMessage());
+        return false;
+    }
+
+    return true;
+}
+
+bool SearchRepository::SearchTasks(const TaskSearch& search, std::vector<TaskSearchResult>& results, bool& hasMore)
+{
+    hasMore = false;
+
+    const std::string match = BuildMatchExpression(search.text);
+    if (match.empty() || search.pageSize <= 0) {
+        return true;
+    }
+
+    auto stmt = pDatabase->Prepare(SearchTasksQuery);
+    if (!stmt ||
+        !stmt.Bind(
+            match, search.employerId, search.pageSize + 1, static_cast<std::int64_t>(search.page) * search.pageSize)) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    int count = 0;
+    while (stmt.Step()) {
+        if (++count > search.pageSize) {
+            hasMore = true;
+            break;
+        }
+
+        results.push_back(
+            stmt.RowAs<TaskSearchResult, std::int64_t, std::int64_t, std::string, std::string, double>());
+    }
+
+    if (stmt.HasError()) {
+        pLogger->error("Failed to search tasks for {0} - ({1})", search.text, stmt.ErrorMessage());
+        return false;
+    }
+
+    return true;
+}
+
+std::string SearchRepository::BuildMatchExpression(const std::string& text)
+{
+    std::string expression;
+    std::size_t position = 0;
+
+    while (position < text.size()) {
+        while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) {
+            position++;
+        }
+
+        std::size_t end = position;
+        while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end]))) {
+            end++;
+        }
+
+        if (end == position) {
+            break;
+        }
+
+        if (!expression.empty()) {
+            expression += ' ';
+        }
+
+        expression += '"';
+        for (std::size_t i = position; i < end; i++) {
+            if (text[i] == '"') {
+                expression += '"';
+            }
+            expression += text[i];
+        }
+        expression += '"';
+
+        // single letters would expand to most of the index, so only longer words are prefixes
+        if (end - position >= 2) {
+            expression += '*';
+        }
+
+        position = end;
+    }
+
+    return expression;
+}
+} // namespace app::Core
@@ -0,0 +1,104 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace app::Core
+{
+class Database;
+
+// Newest pages through the matches newest first without scoring them, which stays fast for broad terms on large
+// databases and is the default. Relevance ranks every match by bm25, which takes most of a second for a term
+// matching hundreds of thousands of entries, so it is for an explicit "best matches" request.
+enum class SearchOrder { Newest, Relevance };
+
+// Free text plus optional filters, the time range is [from, to) in unix seconds
+struct TimeEntrySearch {
+    std::string text;
+    std::optional<std::int64_t> employerId;
+    std::optional<std::int64_t> from;
+    std::optional<std::int64_t> to;
+    SearchOrder order = SearchOrder::Newest;
+    int pageSize = 50;
+    int page = 0;
+};
+
+struct TaskSearch {
+    std::string text;
+    std::optional<std::int64_t> employerId;
+    int pageSize = 50;
+    int page = 0;
+};
+
+// Snippets mark the matched terms with [ and ], rank is bm25 where lower is better (also filled in for Newest)
+struct TimeEntrySearchResult {
+    std::int64_t timeEntryId;
+    std::int64_t taskId;
+    std::int64_t employerId;
+    std::int64_t startTime;
+    std::int64_t duration;
+    std::string snippet;
+    double rank;
+};
+
+struct TaskSearchResult {
+    std::int64_t taskId;
+    std::int64_t employerId;
+    std::string name;
+    std::string snippet;
+    double rank;
+};
+
+// Ranked full-text search over the time_entries_fts and tasks_fts indexes
+class SearchRepository final
+{
+public:
+    SearchRepository(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger);
+    SearchRepository(const SearchRepository&) = delete;
+    ~SearchRepository() = default;
+
+    SearchRepository& operator=(const SearchRepository&) = delete;
+
+    // Reads one page of results, hasMore tells whether a following page exists.
+    // Entries of archived years are not in the index and are never found, see TimeEntryArchive.
+    bool SearchTimeEntries(const TimeEntrySearch& search, std::vector<TimeEntrySearchResult>& results, bool& hasMore);
+    bool SearchTasks(const TaskSearch& search, std::vector<TaskSearchResult>& results, bool& hasMore);
+
+    // Turns what the user typed into an FTS5 match expression: every word is quoted so FTS5 syntax is taken
+    // literally, words of two or more characters match as prefixes and all words have to match.
+    // Returns an empty string when there is nothing to search for.
+    static std::string BuildMatchExpression(const std::string& text);
+
+private:
+    std::shared_ptr<Database> pDatabase;
+    std::shared_ptr<spdlog::logger> pLogger;
+
+    static const std::string SearchTimeEntriesQuery;
+    static const std::string SearchNewestTimeEntriesQuery;
+    static const std::string SearchTasksQuery;
+};
+} // namespace app::Core
@@ -0,0 +1,80 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "slow_query_log.h"
+
+#include <algorithm>
+
+namespace app::Core
+{
+SlowQueryLog& SlowQueryLog::GetInstance()
+{
+    static SlowQueryLog instance;
+    return instance;
+}
+
+SlowQueryLog::SlowQueryLog()
+    : mMutex()
+    , mGroups()
+    , mTokens(-1.0)
+    , mLastRefill(Clock::now())
+{
+}
+
+bool SlowQueryLog::Admit(const std::string& sql,
+    std::chrono::nanoseconds duration,
+    int reportsPerMinute,
+    SlowQueryReport& report)
+{
+    const auto now = Clock::now();
+    const double limit = static_cast<double>(std::max(reportsPerMinute, 1));
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // token bucket, refilled continuously up to one minute's worth of reports
+    const std::chrono::duration<double, std::ratio<60>> elapsed = now - mLastRefill;
+    mTokens = mTokens < 0.0 ? limit : std::min(limit, mTokens + elapsed.count() * limit);
+    mLastRefill = now;
+
+    // statements with inlined values can make every run distinct, start over rather than grow without bound
+    if (mGroups.size() >= MaxGroups && mGroups.find(sql) == mGroups.end()) {
+        mGroups.clear();
+    }
+
+    auto& group = mGroups[sql];
+    group.pending++;
+    group.pendingMax = std::max(group.pendingMax, duration);
+
+    if (group.bReported && now - group.lastReport < GroupInterval) {
+        return false;
+    }
+    if (mTokens < 1.0) {
+        return false;
+    }
+    mTokens -= 1.0;
+
+    report.occurrences = group.pending;
+    report.maxDuration = group.pendingMax;
+    group.pending = 0;
+    group.pendingMax = std::chrono::nanoseconds(0);
+    group.lastReport = now;
+    group.bReported = true;
+    return true;
+}
+} // namespace app::Core
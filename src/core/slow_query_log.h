@@ -0,0 +1,79 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace app::Core
+{
+struct SlowQueryReport {
+    // the statement as prepared, with its parameters as placeholders
+    std::string sql;
+    std::string expandedSql;
+    std::chrono::nanoseconds duration;
+    // slow runs of this statement since its last report, this one included, and the slowest of them
+    std::int64_t occurrences;
+    std::chrono::nanoseconds maxDuration;
+};
+
+// Decides which slow statements get logged, for all connections together. Runs are grouped by their SQL text
+// and a group is reported at most once per GroupInterval, with the runs in between folded into its next report.
+// On top of that, no more than the configured number of reports per minute go out in total.
+class SlowQueryLog final
+{
+public:
+    static constexpr std::chrono::seconds GroupInterval{ 60 };
+    static constexpr std::size_t MaxGroups = 1000;
+
+    static SlowQueryLog& GetInstance();
+
+    SlowQueryLog(const SlowQueryLog&) = delete;
+
+    SlowQueryLog& operator=(const SlowQueryLog&) = delete;
+
+    // Counts a slow run of sql and returns true when it should be reported now, with the group totals in report
+    bool Admit(const std::string& sql,
+        std::chrono::nanoseconds duration,
+        int reportsPerMinute,
+        SlowQueryReport& report);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Group {
+        std::int64_t pending = 0;
+        std::chrono::nanoseconds pendingMax{ 0 };
+        Clock::time_point lastReport;
+        bool bReported = false;
+    };
+
+    SlowQueryLog();
+
+    std::mutex mMutex;
+    std::unordered_map<std::string, Group> mGroups;
+    double mTokens;
+    Clock::time_point mLastRefill;
+};
+} // namespace app::Core
@@ -0,0 +1,99 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "startup_timer.h"
+
+#include <fstream>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/fmt/fmt.h>
+
+#include "../utils/utils.h"
+
+namespace app::Core
+{
+namespace
+{
+double ToMilliseconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+} // namespace
+
+StartupTimer::StartupTimer()
+    : mStart(std::chrono::steady_clock::now())
+    , mLastMark(mStart)
+    , mPhases()
+{
+}
+
+void StartupTimer::Mark(const std::string& phase)
+{
+    const auto now = std::chrono::steady_clock::now();
+    mPhases.push_back(StartupPhase{ phase, now - mLastMark });
+    mLastMark = now;
+}
+
+const std::vector<StartupPhase>& StartupTimer::GetPhases() const
+{
+    return mPhases;
+}
+
+std::chrono::nanoseconds StartupTimer::GetTotal() const
+{
+    return mLastMark - mStart;
+}
+
+std::string StartupTimer::Format() const
+{
+    std::string line = fmt::format("Startup took {0:.1f}ms:", ToMilliseconds(GetTotal()));
+    for (std::size_t i = 0; i < mPhases.size(); i++) {
+        line += fmt::format(
+            "{0} {1} {2:.1f}ms", i == 0 ? "" : ",", mPhases[i].name, ToMilliseconds(mPhases[i].duration));
+    }
+    return line;
+}
+
+bool StartupTimer::WriteJson(const std::filesystem::path& file, std::shared_ptr<spdlog::logger> logger) const
+{
+    nlohmann::ordered_json phases = nlohmann::ordered_json::array();
+    for (const auto& phase : mPhases) {
+        phases.push_back({ { "name", phase.name }, { "ms", ToMilliseconds(phase.duration) } });
+    }
+
+    const nlohmann::ordered_json document{
+        { "timestamp", Utils::ToISODateTime(Utils::UnixTimestamp()) },
+#ifdef TKS_DEBUG
+        { "build", "debug" },
+#else
+        { "build", "release" },
+#endif
+        { "total_ms", ToMilliseconds(GetTotal()) },
+        { "phases", phases },
+    };
+
+    std::ofstream output(file, std::ios::out | std::ios::trunc);
+    output << document.dump(2) << '\n';
+    if (!output) {
+        logger->error("Failed to write startup timings to {0}", file.u8string());
+        return false;
+    }
+    return true;
+}
+} // namespace app::Core
@@ -0,0 +1,63 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace app::Core
+{
+struct StartupPhase {
+    std::string name;
+    std::chrono::nanoseconds duration;
+};
+
+// Times consecutive startup phases on the monotonic clock. Each Mark closes the phase that began at the previous
+// mark, or at construction for the first one, so the phases always add up to the total.
+class StartupTimer final
+{
+public:
+    StartupTimer();
+    StartupTimer(const StartupTimer&) = delete;
+    ~StartupTimer() = default;
+
+    StartupTimer& operator=(const StartupTimer&) = delete;
+
+    void Mark(const std::string& phase);
+
+    const std::vector<StartupPhase>& GetPhases() const;
+    std::chrono::nanoseconds GetTotal() const;
+
+    // One line such as "Startup took 412.3ms: environment 0.4ms, logger 1.2ms, ..."
+    std::string Format() const;
+
+    bool WriteJson(const std::filesystem::path& file, std::shared_ptr<spdlog::logger> logger) const;
+
+private:
+    std::chrono::steady_clock::time_point mStart;
+    std::chrono::steady_clock::time_point mLastMark;
+    std::vector<StartupPhase> mPhases;
+};
+} // namespace app::Core
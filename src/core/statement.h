@@ -0,0 +1,337 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <sqlite3.h>
+
+#include "metrics.h"
+
+namespace app::Core
+{
+template<typename T>
+struct IsOptional : std::false_type {
+};
+
+template<typename T>
+struct IsOptional<std::optional<T>> : std::true_type {
+};
+
+// RAII handle over a prepared statement.
+//
+// Statements handed out by the Database statement cache are reset and have their bindings cleared when the handle
+// goes out of scope, all other statements are finalized.
+//
+// Text bound from lvalues (std::string, std::string_view, const char*) is bound with SQLITE_STATIC and is not
+// copied, so it must outlive the last call to Step/Execute. Temporary std::string values are copied by SQLite.
+//
+// Each execution is timed from its first Step until it is done, reset or released, into the sqlite.statement
+// histogram. That includes the time the caller spends on each row.
+class Statement final
+{
+public:
+    Statement()
+        : pDb(nullptr)
+        , pStmt(nullptr)
+        , pInUse(nullptr)
+        , mResultCode(SQLITE_MISUSE)
+        , bStepping(false)
+        , mStartedAt()
+    {
+    }
+
+    Statement(sqlite3* db, sqlite3_stmt* stmt, bool* inUse = nullptr)
+        : pDb(db)
+        , pStmt(stmt)
+        , pInUse(inUse)
+        , mResultCode(SQLITE_OK)
+        , bStepping(false)
+        , mStartedAt()
+    {
+        if (pInUse != nullptr) {
+            *pInUse = true;
+        }
+    }
+
+    Statement(const Statement&) = delete;
+
+    Statement(Statement&& other) noexcept
+        : pDb(std::exchange(other.pDb, nullptr))
+        , pStmt(std::exchange(other.pStmt, nullptr))
+        , pInUse(std::exchange(other.pInUse, nullptr))
+        , mResultCode(other.mResultCode)
+        , bStepping(std::exchange(other.bStepping, false))
+        , mStartedAt(other.mStartedAt)
+    {
+    }
+
+    ~Statement()
+    {
+        Release();
+    }
+
+    Statement& operator=(const Statement&) = delete;
+
+    Statement& operator=(Statement&& other) noexcept
+    {
+        if (this != &other) {
+            Release();
+            pDb = std::exchange(other.pDb, nullptr);
+            pStmt = std::exchange(other.pStmt, nullptr);
+            pInUse = std::exchange(other.pInUse, nullptr);
+            mResultCode = other.mResultCode;
+            bStepping = std::exchange(other.bStepping, false);
+            mStartedAt = other.mStartedAt;
+        }
+        return *this;
+    }
+
+    explicit operator bool() const
+    {
+        return pStmt != nullptr;
+    }
+
+    sqlite3_stmt* Handle() const
+    {
+        return pStmt;
+    }
+
+    int ResultCode() const
+    {
+        return mResultCode;
+    }
+
+    bool HasError() const
+    {
+        if (pStmt == nullptr) {
+            return true;
+        }
+        return mResultCode != SQLITE_OK && mResultCode != SQLITE_ROW && mResultCode != SQLITE_DONE;
+    }
+
+    const char* ErrorMessage() const
+    {
+        return pDb != nullptr ? sqlite3_errmsg(pDb) : "statement was not prepared";
+    }
+
+    // Binds each argument to the parameter at its position, starting at index 1
+    template<typename... Args>
+    bool Bind(Args&&... args)
+    {
+        return BindFrom(1, std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    bool BindAt(int index, T&& value)
+    {
+        using Type = std::decay_t<T>;
+
+        if constexpr (std::is_same_v<Type, std::nullptr_t>) {
+            mResultCode = sqlite3_bind_null(pStmt, index);
+        } else if constexpr (IsOptional<Type>::value) {
+            if (!value.has_value()) {
+                mResultCode = sqlite3_bind_null(pStmt, index);
+            } else if constexpr (std::is_lvalue_reference_v<T>) {
+                return BindAt(index, *value);
+            } else {
+                return BindAt(index, std::move(*value));
+            }
+        } else if constexpr (std::is_same_v<Type, bool>) {
+            mResultCode = sqlite3_bind_int(pStmt, index, value ? 1 : 0);
+        } else if constexpr (std::is_integral_v<Type> || std::is_enum_v<Type>) {
+            if constexpr (sizeof(Type) <= sizeof(int)) {
+                mResultCode = sqlite3_bind_int(pStmt, index, static_cast<int>(value));
+            } else {
+                mResultCode = sqlite3_bind_int64(pStmt, index, static_cast<sqlite3_int64>(value));
+            }
+        } else if constexpr (std::is_floating_point_v<Type>) {
+            mResultCode = sqlite3_bind_double(pStmt, index, static_cast<double>(value));
+        } else if constexpr (std::is_same_v<Type, std::string> && !std::is_lvalue_reference_v<T>) {
+            mResultCode =
+                sqlite3_bind_text(pStmt, index, value.data(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
+        } else if constexpr (std::is_convertible_v<const Type&, std::string_view>) {
+            const std::string_view text = value;
+            mResultCode = sqlite3_bind_text(pStmt, index, text.data(), static_cast<int>(text.size()), SQLITE_STATIC);
+        } else {
+            static_assert(sizeof(Type) == 0, "Unsupported statement parameter type");
+        }
+
+        return mResultCode == SQLITE_OK;
+    }
+
+    // Returns true when a row is available, false when the statement is done or failed (see HasError)
+    bool Step()
+    {
+        if (!bStepping) {
+            bStepping = true;
+            mStartedAt = std::chrono::steady_clock::now();
+        }
+
+        mResultCode = sqlite3_step(pStmt);
+        if (mResultCode != SQLITE_ROW) {
+            FinishExecution();
+            return false;
+        }
+        return true;
+    }
+
+    // Steps through the statement until it is done, discarding any rows
+    bool Execute()
+    {
+        while (Step()) {
+        }
+        return mResultCode == SQLITE_DONE;
+    }
+
+    void Reset()
+    {
+        FinishExecution();
+        sqlite3_reset(pStmt);
+        mResultCode = SQLITE_OK;
+    }
+
+    bool IsNull(int index) const
+    {
+        return sqlite3_column_type(pStmt, index) == SQLITE_NULL;
+    }
+
+    // Reads a column of the current row. std::string_view results point into SQLite's
+    // buffer and are only valid until the next call to Step or Reset
+    template<typename T>
+    T Column(int index) const
+    {
+        if constexpr (IsOptional<T>::value) {
+            if (IsNull(index)) {
+                return std::nullopt;
+            }
+            return Column<typename T::value_type>(index);
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return sqlite3_column_int(pStmt, index) != 0;
+        } else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+            if constexpr (sizeof(T) <= sizeof(int)) {
+                return static_cast<T>(sqlite3_column_int(pStmt, index));
+            } else {
+                return static_cast<T>(sqlite3_column_int64(pStmt, index));
+            }
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return static_cast<T>(sqlite3_column_double(pStmt, index));
+        } else if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>) {
+            const char* text = reinterpret_cast<const char*>(sqlite3_column_text(pStmt, index));
+            if (text == nullptr) {
+                return T();
+            }
+            return T(text, static_cast<std::size_t>(sqlite3_column_bytes(pStmt, index)));
+        } else {
+            static_assert(sizeof(T) == 0, "Unsupported statement column type");
+        }
+    }
+
+    // Reads the leading columns of the current row into a tuple
+    template<typename... Columns>
+    std::tuple<Columns...> Row() const
+    {
+        return RowImpl<Columns...>(std::index_sequence_for<Columns...>());
+    }
+
+    // Reads the leading columns of the current row into an aggregate, in member declaration order
+    template<typename T, typename... Columns>
+    T RowAs() const
+    {
+        return RowAsImpl<T, Columns...>(std::index_sequence_for<Columns...>());
+    }
+
+private:
+    bool BindFrom(int)
+    {
+        return true;
+    }
+
+    template<typename Arg, typename... Rest>
+    bool BindFrom(int index, Arg&& arg, Rest&&... rest)
+    {
+        if (!BindAt(index, std::forward<Arg>(arg))) {
+            return false;
+        }
+        return BindFrom(index + 1, std::forward<Rest>(rest)...);
+    }
+
+    template<typename... Columns, std::size_t... Indices>
+    std::tuple<Columns...> RowImpl(std::index_sequence<Indices...>) const
+    {
+        return std::tuple<Columns...>(Column<Columns>(static_cast<int>(Indices))...);
+    }
+
+    template<typename T, typename... Columns, std::size_t... Indices>
+    T RowAsImpl(std::index_sequence<Indices...>) const
+    {
+        return T{ Column<Columns>(static_cast<int>(Indices))... };
+    }
+
+    void FinishExecution()
+    {
+        if (!bStepping) {
+            return;
+        }
+        bStepping = false;
+
+        static auto& latency = MetricsRegistry::GetInstance().GetHistogram("sqlite.statement");
+        static auto& errors = MetricsRegistry::GetInstance().GetCounter("sqlite.errors");
+        latency.Record(std::chrono::steady_clock::now() - mStartedAt);
+        if (HasError()) {
+            errors.Add();
+        }
+    }
+
+    void Release()
+    {
+        if (pStmt == nullptr) {
+            return;
+        }
+
+        FinishExecution();
+
+        if (pInUse != nullptr) {
+            sqlite3_reset(pStmt);
+            sqlite3_clear_bindings(pStmt);
+            *pInUse = false;
+        } else {
+            sqlite3_finalize(pStmt);
+        }
+
+        pStmt = nullptr;
+        pInUse = nullptr;
+    }
+
+    sqlite3* pDb;
+    sqlite3_stmt* pStmt;
+    bool* pInUse;
+    int mResultCode;
+    bool bStepping;
+    std::chrono::steady_clock::time_point mStartedAt;
+};
+} // namespace app::Core
@@ -0,0 +1,536 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "time_entry_archive.h"
+
+#include <algorithm>
+#include <chrono>
+#include <system_error>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "daily_totals_repository.h"
+#include "database.h"
+#include "local_time.h"
+
+#include "../utils/utils.h"
+
+namespace
+{
+const std::string ArchiveExtension = ".db";
+const std::string PartialExtension = ".part";
+const std::string PartialSchema = "archive_part";
+} // namespace
+
+namespace app::Core
+{
+const std::string TimeEntryArchive::SelectArchivedYearsQuery =
+    "SELECT year, file_name, year_start, year_end, entry_count, total_duration, max_time_entry_id "
+    "FROM archived_years ORDER BY year;";
+const std::string TimeEntryArchive::InsertArchivedYearQuery =
+    "INSERT INTO archived_years "
+    "(year, file_name, year_start, year_end, entry_count, total_duration, max_time_entry_id) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?);";
+const std::string TimeEntryArchive::SelectFirstYearQuery = "SELECT min(start_time) FROM main.time_entries;";
+const std::string TimeEntryArchive::SelectTotalsQuery =
+    "SELECT count(*), coalesce(sum(duration), 0), coalesce(max(time_entry_id), 0) "
+    "FROM {0}.time_entries WHERE start_time >= ? AND start_time < ?;";
+const std::string TimeEntryArchive::AttachQuery = "ATTACH DATABASE ? AS {0};";
+const std::string TimeEntryArchive::DetachQuery = "DETACH DATABASE {0};";
+// the archive is a new file that is checked before it is used, a rollback journal would only slow the copy down
+const std::string TimeEntryArchive::CreateArchiveQuery =
+    "PRAGMA archive_part.journal_mode = OFF;"
+    "PRAGMA archive_part.synchronous = FULL;"
+    "CREATE TABLE archive_part.time_entries"
+    "("
+    "    time_entry_id INTEGER PRIMARY KEY NOT NULL,"
+    "    task_id INTEGER NOT NULL,"
+    "    employer_id INTEGER NOT NULL,"
+    "    start_time INTEGER NOT NULL,"
+    "    duration INTEGER NOT NULL,"
+    "    description TEXT,"
+    "    date_created INTEGER NOT NULL,"
+    "    date_modified INTEGER NOT NULL"
+    ");";
+const std::string TimeEntryArchive::CopyEntriesQuery =
+    "INSERT INTO archive_part.time_entries "
+    "SELECT time_entry_id, task_id, employer_id, start_time, duration, description, date_created, date_modified "
+    "FROM main.time_entries "
+    "WHERE start_time >= ? AND start_time < ? "
+    "ORDER BY time_entry_id;";
+const std::string TimeEntryArchive::CreateArchiveIndexesQuery =
+    "CREATE INDEX archive_part.idx_time_entries_start_time ON time_entries(start_time);"
+    "CREATE INDEX archive_part.idx_time_entries_employer_id_start_time "
+    "ON time_entries(employer_id, start_time, duration);";
+const std::string TimeEntryArchive::DeleteEntriesQuery =
+    "DELETE FROM main.time_entries WHERE start_time >= ? AND start_time < ?;";
+const std::string TimeEntryArchive::SelectDailyTotalsQuery =
+    "SELECT employer_id, day, total_duration, entry_count FROM main.employer_daily_totals WHERE day BETWEEN ? AND ?;";
+const std::string TimeEntryArchive::RestoreDailyTotalQuery =
+    "INSERT OR REPLACE INTO main.employer_daily_totals (employer_id, day, total_duration, entry_count) "
+    "VALUES (?, ?, ?, ?);";
+// deletes from the external content index are stored as tombstones until its segments are merged
+const std::string TimeEntryArchive::OptimizeSearchQuery =
+    "INSERT INTO main.time_entries_fts (time_entries_fts) VALUES ('optimize');";
+const std::string TimeEntryArchive::VacuumQuery = "VACUUM main;";
+
+TimeEntryArchive::TimeEntryArchive(std::shared_ptr<Database> database,
+    const std::filesystem::path& databaseFile,
+    std::shared_ptr<spdlog::logger> logger)
+    : pDatabase(database)
+    , pLogger(logger)
+    , mDirectory(databaseFile.parent_path())
+    , mDatabaseName(databaseFile.stem().u8string())
+    , mArchivedYears()
+    , mAttached()
+{
+}
+
+TimeEntryArchive::~TimeEntryArchive()
+{
+    if (pDatabase->IsOpen()) {
+        DetachAll();
+    }
+}
+
+bool TimeEntryArchive::Load()
+{
+    mArchivedYears.clear();
+
+    auto stmt = pDatabase->Prepare(SelectArchivedYearsQuery);
+    if (!stmt) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    while (stmt.Step()) {
+        auto archived = stmt.RowAs<ArchivedYear,
+            int,
+            std::string,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t>();
+        mArchivedYears.emplace(archived.year, std::move(archived));
+    }
+
+    if (stmt.HasError()) {
+        pLogger->error("Failed to read archived years {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    pLogger->info("Found {0} archived years", mArchivedYears.size());
+    return true;
+}
+
+bool TimeEntryArchive::IsArchived(int year) const
+{
+    return mArchivedYears.find(year) != mArchivedYears.end();
+}
+
+bool TimeEntryArchive::IsArchivedTime(std::int64_t timestamp) const
+{
+    return std::any_of(mArchivedYears.begin(), mArchivedYears.end(), [timestamp](const auto& archived) {
+        return archived.second.yearStart <= timestamp && timestamp < archived.second.yearEnd;
+    });
+}
+
+const std::map<int, ArchivedYear>& TimeEntryArchive::GetArchivedYears() const
+{
+    return mArchivedYears;
+}
+
+std::filesystem::path TimeEntryArchive::GetArchivePath(int year) const
+{
+    return mDirectory / std::filesystem::u8path(mDatabaseName + "-" + std::to_string(year) + ArchiveExtension);
+}
+
+bool TimeEntryArchive::ArchiveClosedYears(int keepClosedYears)
+{
+    const int currentYear = GetCurrentYear();
+    std::optional<int> firstYear;
+    if (!GetFirstYear(firstYear)) {
+        return false;
+    }
+
+    bool archivedAny = false;
+    for (int year = firstYear.value_or(currentYear); year < currentYear - keepClosedYears; year++) {
+        if (IsArchived(year)) {
+            continue;
+        }
+
+        if (!ArchiveYear(year)) {
+            return false;
+        }
+        archivedAny = IsArchived(year) || archivedAny;
+    }
+
+    if (!archivedAny) {
+        return true;
+    }
+
+    // deleted rows only leave free pages behind, the file shrinks once it is rebuilt
+    const auto start = std::chrono::steady_clock::now();
+    if (!pDatabase->Execute(OptimizeSearchQuery) || !pDatabase->Execute(VacuumQuery)) {
+        return false;
+    }
+
+    pLogger->info("Compacted the database in {0}ms",
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+bool TimeEntryArchive::ArchiveYear(int year)
+{
+    if (IsArchived(year)) {
+        pLogger->info("Year {0} is already archived", year);
+        return true;
+    }
+
+    const int currentYear = GetCurrentYear();
+    if (year >= currentYear) {
+        pLogger->error("Cannot archive {0}, only years before {1} are closed", year, currentYear);
+        return false;
+    }
+
+    LocalTimeConverter converter;
+    const std::int64_t yearStart = converter.FromLocal(DaysFromCivil(year, 1, 1) * 86400);
+    const std::int64_t yearEnd = converter.FromLocal(DaysFromCivil(year + 1, 1, 1) * 86400);
+
+    ArchivedYear archived{ year, GetArchivePath(year).filename().u8string(), yearStart, yearEnd, 0, 0, 0 };
+    {
+        auto stmt = pDatabase->PrepareUncached(fmt::format(SelectTotalsQuery, "main"));
+        if (!stmt || !stmt.Bind(yearStart, yearEnd) || !stmt.Step()) {
+            pLogger->error("Failed to count the time entries of {0} - ({1})", year, stmt.ErrorMessage());
+            return false;
+        }
+        archived.entryCount = stmt.Column<std::int64_t>(0);
+        archived.totalDuration = stmt.Column<std::int64_t>(1);
+        archived.maxTimeEntryId = stmt.Column<std::int64_t>(2);
+    }
+
+    if (archived.entryCount == 0) {
+        pLogger->info("No time entries to archive in {0}", year);
+        return true;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (!WriteArchive(year, yearStart, yearEnd, archived) || !RemoveArchivedEntries(archived)) {
+        return false;
+    }
+
+    // the rows only moved, a cache loading through this archive keeps its totals
+    mArchivedYears.emplace(year, archived);
+
+    pLogger->info("Archived {0} time entries of {1} into {2} in {3}ms",
+        archived.entryCount,
+        year,
+        archived.fileName,
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+bool TimeEntryArchive::ForEachSource(std::int64_t from,
+    std::int64_t to,
+    const std::function<bool(const std::string& schema, std::int64_t from, std::int64_t to)>& callback)
+{
+    static const std::string MainSchema = "main";
+
+    std::int64_t cursor = from;
+    while (cursor < to) {
+        const ArchivedYear* covering = nullptr;
+        std::int64_t nextArchiveStart = to;
+
+        for (const auto& [year, archived] : mArchivedYears) {
+            if (archived.yearStart <= cursor && cursor < archived.yearEnd) {
+                covering = &archived;
+                break;
+            }
+            if (archived.yearStart > cursor) {
+                nextArchiveStart = std::min(nextArchiveStart, archived.yearStart);
+            }
+        }
+
+        if (covering == nullptr) {
+            if (!callback(MainSchema, cursor, nextArchiveStart)) {
+                return false;
+            }
+            cursor = nextArchiveStart;
+            continue;
+        }
+
+        std::string schema;
+        const std::int64_t segmentEnd = std::min(to, covering->yearEnd);
+        if (!Attach(*covering, schema) || !callback(schema, cursor, segmentEnd)) {
+            return false;
+        }
+        cursor = segmentEnd;
+    }
+
+    return true;
+}
+
+void TimeEntryArchive::DetachAll()
+{
+    while (!mAttached.empty()) {
+        if (!Detach(mAttached.back())) {
+            mAttached.pop_back();
+        }
+    }
+}
+
+bool TimeEntryArchive::Attach(const ArchivedYear& archived, std::string& schema)
+{
+    schema = GetSchemaName(archived.year);
+
+    auto attached = std::find(mAttached.begin(), mAttached.end(), schema);
+    if (attached != mAttached.end()) {
+        std::rotate(mAttached.begin(), attached, attached + 1);
+        return true;
+    }
+
+    if (mAttached.size() >= MaxAttached && !Detach(mAttached.back())) {
+        return false;
+    }
+
+    const auto file = mDirectory / std::filesystem::u8path(archived.fileName);
+    auto stmt = pDatabase->PrepareUncached(fmt::format(AttachQuery, schema));
+    if (!stmt || !stmt.Bind(GetReadOnlyUri(file)) || !stmt.Execute()) {
+        pLogger->error("Failed to attach archive {0} - ({1})", file.u8string(), stmt.ErrorMessage());
+        return false;
+    }
+
+    mAttached.insert(mAttached.begin(), schema);
+    return true;
+}
+
+bool TimeEntryArchive::Detach(const std::string& schema)
+{
+    if (!pDatabase->Execute(fmt::format(DetachQuery, schema))) {
+        return false;
+    }
+
+    mAttached.erase(std::remove(mAttached.begin(), mAttached.end(), schema), mAttached.end());
+    return true;
+}
+
+bool TimeEntryArchive::WriteArchive(int year, std::int64_t yearStart, std::int64_t yearEnd, ArchivedYear& archived)
+{
+    const auto file = GetArchivePath(year);
+    auto partialFile = file;
+    partialFile += PartialExtension;
+
+    std::error_code ec;
+    std::filesystem::remove(partialFile, ec);
+
+    {
+        auto stmt = pDatabase->PrepareUncached(fmt::format(AttachQuery, PartialSchema));
+        if (!stmt || !stmt.Bind(partialFile.u8string()) || !stmt.Execute()) {
+            pLogger->error("Failed to create archive {0} - ({1})", partialFile.u8string(), stmt.ErrorMessage());
+            return false;
+        }
+    }
+
+    auto copy = [&]() {
+        if (!pDatabase->Execute(CreateArchiveQuery)) {
+            return false;
+        }
+
+        Transaction transaction(*pDatabase);
+        if (!transaction.IsActive()) {
+            return false;
+        }
+
+        auto stmt = pDatabase->PrepareUncached(CopyEntriesQuery);
+        if (!stmt || !stmt.Bind(yearStart, yearEnd) || !stmt.Execute()) {
+            pLogger->error("Failed to copy the time entries of {0} - ({1})", year, stmt.ErrorMessage());
+            return false;
+        }
+
+        if (!pDatabase->Execute(CreateArchiveIndexesQuery)) {
+            return false;
+        }
+
+        auto totals = pDatabase->PrepareUncached(fmt::format(SelectTotalsQuery, PartialSchema));
+        if (!totals || !totals.Bind(yearStart, yearEnd) || !totals.Step()) {
+            pLogger->error("Failed to check archive {0} - ({1})", partialFile.u8string(), totals.ErrorMessage());
+            return false;
+        }
+
+        if (totals.Column<std::int64_t>(0) != archived.entryCount ||
+            totals.Column<std::int64_t>(1) != archived.totalDuration) {
+            pLogger->error("Archive {0} holds {1} entries, expected {2}",
+                partialFile.u8string(),
+                totals.Column<std::int64_t>(0),
+                archived.entryCount);
+            return false;
+        }
+
+        return transaction.Commit();
+    };
+
+    const bool copied = copy();
+    if (!Detach(PartialSchema) || !copied) {
+        std::filesystem::remove(partialFile, ec);
+        return false;
+    }
+
+    std::filesystem::rename(partialFile, file, ec);
+    if (ec) {
+        pLogger->error("Failed to rename archive {0} - ({1})", partialFile.u8string(), ec.message());
+        std::filesystem::remove(partialFile, ec);
+        return false;
+    }
+
+    return true;
+}
+
+bool TimeEntryArchive::RemoveArchivedEntries(const ArchivedYear& archived)
+{
+    Transaction transaction(*pDatabase);
+    if (!transaction.IsActive()) {
+        return false;
+    }
+
+    // another connection may have written to the year since the archive was copied
+    {
+        auto stmt = pDatabase->PrepareUncached(fmt::format(SelectTotalsQuery, "main"));
+        if (!stmt || !stmt.Bind(archived.yearStart, archived.yearEnd) || !stmt.Step()) {
+            pLogger->error("Failed to count the time entries of {0} - ({1})", archived.year, stmt.ErrorMessage());
+            return false;
+        }
+
+        if (stmt.Column<std::int64_t>(0) != archived.entryCount ||
+            stmt.Column<std::int64_t>(1) != archived.totalDuration ||
+            stmt.Column<std::int64_t>(2) != archived.maxTimeEntryId) {
+            pLogger->error("Time entries of {0} changed while they were archived", archived.year);
+            return false;
+        }
+    }
+
+    // the delete trigger takes the year out of the daily totals, those rows are put back as they were
+    std::vector<DailyTotal> totals;
+    {
+        const std::string firstDay = fmt::format("{0:04d}-01-01", archived.year);
+        const std::string lastDay = fmt::format("{0:04d}-12-31", archived.year);
+        auto stmt = pDatabase->Prepare(SelectDailyTotalsQuery);
+        if (!stmt || !stmt.Bind(firstDay, lastDay)) {
+            pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+            return false;
+        }
+
+        while (stmt.Step()) {
+            totals.push_back(stmt.RowAs<DailyTotal, std::int64_t, std::string, std::int64_t, std::int64_t>());
+        }
+
+        if (stmt.HasError()) {
+            pLogger->error("Failed to read daily totals {0}", stmt.ErrorMessage());
+            return false;
+        }
+    }
+
+    {
+        auto stmt = pDatabase->PrepareUncached(DeleteEntriesQuery);
+        if (!stmt || !stmt.Bind(archived.yearStart, archived.yearEnd) || !stmt.Execute()) {
+            pLogger->error("Failed to delete the time entries of {0} - ({1})", archived.year, stmt.ErrorMessage());
+            return false;
+        }
+    }
+
+    for (const auto& total : totals) {
+        auto stmt = pDatabase->Prepare(RestoreDailyTotalQuery);
+        if (!stmt || !stmt.Bind(total.employerId, total.day, total.totalDuration, total.entryCount) ||
+            !stmt.Execute()) {
+            pLogger->error("Failed to restore daily totals {0}", stmt.ErrorMessage());
+            return false;
+        }
+    }
+
+    {
+        auto stmt = pDatabase->Prepare(InsertArchivedYearQuery);
+        if (!stmt ||
+            !stmt.Bind(archived.year,
+                archived.fileName,
+                archived.yearStart,
+                archived.yearEnd,
+                archived.entryCount,
+                archived.totalDuration,
+                archived.maxTimeEntryId) ||
+            !stmt.Execute()) {
+            pLogger->error("Failed to record archived year {0} - ({1})", archived.year, stmt.ErrorMessage());
+            return false;
+        }
+    }
+
+    return transaction.Commit();
+}
+
+int TimeEntryArchive::GetCurrentYear()
+{
+    LocalTimeConverter converter;
+    return static_cast<int>(ToCivilTime(converter.ToLocal(Utils::UnixTimestamp())).year);
+}
+
+bool TimeEntryArchive::GetFirstYear(std::optional<int>& year)
+{
+    auto stmt = pDatabase->Prepare(SelectFirstYearQuery);
+    if (!stmt || !stmt.Step()) {
+        pLogger->error("Failed to read the first year of time entries {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    year.reset();
+    if (auto firstStart = stmt.Column<std::optional<std::int64_t>>(0)) {
+        LocalTimeConverter converter;
+        year = static_cast<int>(ToCivilTime(converter.ToLocal(*firstStart)).year);
+    }
+    return true;
+}
+
+std::string TimeEntryArchive::GetSchemaName(int year)
+{
+    return "archive_" + std::to_string(year);
+}
+
+std::string TimeEntryArchive::GetReadOnlyUri(const std::filesystem::path& file)
+{
+    static const char Hex[] = "0123456789ABCDEF";
+
+    // archives never change once written, immutable also skips the locking
+    const std::string path = file.generic_u8string();
+    std::string uri = "file:";
+    if (path.empty() || path.front() != '/') {
+        uri += '/';
+    }
+
+    for (unsigned char c : path) {
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '/' || c == ':' ||
+            c == '-' || c == '_' || c == '.' || c == '~') {
+            uri += static_cast<char>(c);
+        } else {
+            uri += '%';
+            uri += Hex[c >> 4];
+            uri += Hex[c & 0x0F];
+        }
+    }
+
+    return uri + "?mode=ro&immutable=1";
+}
+} // namespace app::Core
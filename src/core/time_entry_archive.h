@@ -0,0 +1,126 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace app::Core
+{
+class Database;
+
+struct ArchivedYear {
+    int year;
+    std::string fileName;
+    std::int64_t yearStart;
+    std::int64_t yearEnd;
+    std::int64_t entryCount;
+    std::int64_t totalDuration;
+    // new time entries get ids past this one, so no id is handed out twice
+    std::int64_t maxTimeEntryId;
+};
+
+// Moves the time entries of closed years out of the main database into <database name>-<year>.db files next to
+// it, and attaches those files read-only when a query's range needs them.
+//
+// Years follow local time, the same as the daily totals. Employers, tasks and the daily totals of archived years
+// stay in the main database, only time entry rows move. Archived rows are read-only and are no longer found by
+// full-text search. At most MaxAttached archives are attached at once, the least recently used is detached first.
+// Archives cannot be attached inside a transaction.
+class TimeEntryArchive final
+{
+public:
+    static constexpr std::size_t MaxAttached = 8;
+
+    TimeEntryArchive(std::shared_ptr<Database> database,
+        const std::filesystem::path& databaseFile,
+        std::shared_ptr<spdlog::logger> logger);
+    TimeEntryArchive(const TimeEntryArchive&) = delete;
+    ~TimeEntryArchive();
+
+    TimeEntryArchive& operator=(const TimeEntryArchive&) = delete;
+
+    // Reads the list of archived years
+    bool Load();
+
+    bool IsArchived(int year) const;
+    bool IsArchivedTime(std::int64_t timestamp) const;
+    const std::map<int, ArchivedYear>& GetArchivedYears() const;
+    std::filesystem::path GetArchivePath(int year) const;
+
+    // Archives every closed year except the newest keepClosedYears of them, then compacts the main database
+    bool ArchiveClosedYears(int keepClosedYears);
+
+    // Moves the entries of one closed year into its archive file. The archive is written and checked before
+    // anything is deleted from the main database.
+    bool ArchiveYear(int year);
+
+    // Splits [from, to) into consecutive pieces that each come from one schema, "main" or an attached archive,
+    // and stops at the first piece the callback fails
+    bool ForEachSource(std::int64_t from,
+        std::int64_t to,
+        const std::function<bool(const std::string& schema, std::int64_t from, std::int64_t to)>& callback);
+
+    void DetachAll();
+
+private:
+    bool Attach(const ArchivedYear& archived, std::string& schema);
+    bool Detach(const std::string& schema);
+    bool WriteArchive(int year, std::int64_t yearStart, std::int64_t yearEnd, ArchivedYear& archived);
+    bool RemoveArchivedEntries(const ArchivedYear& archived);
+    bool GetFirstYear(std::optional<int>& year);
+
+    static int GetCurrentYear();
+    static std::string GetSchemaName(int year);
+    static std::string GetReadOnlyUri(const std::filesystem::path& file);
+
+    std::shared_ptr<Database> pDatabase;
+    std::shared_ptr<spdlog::logger> pLogger;
+    std::filesystem::path mDirectory;
+    std::string mDatabaseName;
+    std::map<int, ArchivedYear> mArchivedYears;
+    // attached schemas, most recently used first
+    std::vector<std::string> mAttached;
+
+    static const std::string SelectArchivedYearsQuery;
+    static const std::string InsertArchivedYearQuery;
+    static const std::string SelectFirstYearQuery;
+    static const std::string SelectTotalsQuery;
+    static const std::string AttachQuery;
+    static const std::string DetachQuery;
+    static const std::string CreateArchiveQuery;
+    static const std::string CopyEntriesQuery;
+    static const std::string CreateArchiveIndexesQuery;
+    static const std::string DeleteEntriesQuery;
+    static const std::string SelectDailyTotalsQuery;
+    static const std::string RestoreDailyTotalQuery;
+    static const std::string OptimizeSearchQuery;
+    static const std::string VacuumQuery;
+};
+} // namespace app::Core
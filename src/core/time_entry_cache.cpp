@@ -0,0 +1,312 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "time_entry_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "database.h"
+#include "time_entry_archive.h"
+
+namespace
+{
+constexpr std::int64_t SecondsPerWeek = 7 * 24 * 60 * 60;
+// rows filtered at a time by GroupByEmployerAndWeek, the selection stays in L1
+constexpr std::size_t GroupBlockSize = 4096;
+} // namespace
+
+namespace app::Core
+{
+// {0} is the schema holding the entries, "main" or an attached archive
+const std::string TimeEntryCache::CountQuery =
+    "SELECT count(*) FROM {0}.time_entries WHERE start_time >= ? AND start_time < ?;";
+const std::string TimeEntryCache::SelectRangeQuery =
+    "SELECT time_entry_id, task_id, employer_id, start_time, duration "
+    "FROM {0}.time_entries "
+    "WHERE start_time >= ? AND start_time < ?;";
+
+TimeEntryCache::TimeEntryCache(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger)
+    : pDatabase(database)
+    , pLogger(logger)
+    , pArchive(nullptr)
+    , mTimeEntryIds()
+    , mTaskIds()
+    , mStartTimes()
+    , mDurations()
+    , mEmployerSlots()
+    , mRowIndex()
+    , mEmployerSlotIndex()
+    , mSlotEmployerIds()
+    , pSumDurations(GetSumDurationsKernel())
+{
+}
+
+void TimeEntryCache::SetArchive(std::shared_ptr<TimeEntryArchive> archive)
+{
+    pArchive = archive;
+}
+
+bool TimeEntryCache::Load()
+{
+    Clear();
+
+    std::int64_t count = 0;
+    const bool counted = ForEachSource([&](const std::string& schema, std::int64_t from, std::int64_t to) {
+        auto stmt = pDatabase->PrepareUncached(fmt::format(CountQuery, schema));
+        if (!stmt || !stmt.Bind(from, to) || !stmt.Step()) {
+            pLogger->error("Failed to count time entries {0}", stmt.ErrorMessage());
+            return false;
+        }
+        count += stmt.Column<std::int64_t>(0);
+        return true;
+    });
+    if (!counted) {
+        return false;
+    }
+
+    mTimeEntryIds.reserve(count);
+    mTaskIds.reserve(count);
+    mStartTimes.reserve(count);
+    mDurations.reserve(count);
+    mEmployerSlots.reserve(count);
+    mRowIndex.reserve(count);
+
+    const bool loaded = ForEachSource([&](const std::string& schema, std::int64_t from, std::int64_t to) {
+        auto stmt = pDatabase->PrepareUncached(fmt::format(SelectRangeQuery, schema));
+        if (!stmt || !stmt.Bind(from, to)) {
+            pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+            return false;
+        }
+
+        while (stmt.Step()) {
+            Append(stmt.Column<std::int64_t>(0),
+                stmt.Column<std::int64_t>(1),
+                stmt.Column<std::int64_t>(2),
+                stmt.Column<std::int64_t>(3),
+                stmt.Column<std::int64_t>(4));
+        }
+
+        if (stmt.HasError()) {
+            pLogger->error("Failed to read time entries {0}", stmt.ErrorMessage());
+            return false;
+        }
+        return true;
+    });
+    if (!loaded) {
+        Clear();
+        return false;
+    }
+
+    pLogger->info("Loaded {0} time entries into the cache, using {1} kernels", Size(), GetSumDurationsKernelName());
+    return true;
+}
+
+void TimeEntryCache::Clear()
+{
+    mTimeEntryIds.clear();
+    mTaskIds.clear();
+    mStartTimes.clear();
+    mDurations.clear();
+    mEmployerSlots.clear();
+    mRowIndex.clear();
+    mEmployerSlotIndex.clear();
+    mSlotEmployerIds.clear();
+}
+
+std::size_t TimeEntryCache::Size() const
+{
+    return mTimeEntryIds.size();
+}
+
+void TimeEntryCache::Insert(const TimeEntry& entry)
+{
+    if (mRowIndex.find(entry.timeEntryId) != mRowIndex.end()) {
+        Update(entry);
+        return;
+    }
+
+    Append(entry.timeEntryId, entry.taskId, entry.employerId, entry.startTime, entry.duration);
+}
+
+void TimeEntryCache::Update(const TimeEntry& entry)
+{
+    // the repository only updates rows that exist, a missing one is left out rather than counted twice later
+    auto found = mRowIndex.find(entry.timeEntryId);
+    if (found == mRowIndex.end()) {
+        pLogger->warn("Time entry {0} is not in the cache, not updating it", entry.timeEntryId);
+        return;
+    }
+
+    const std::size_t row = found->second;
+    mTaskIds[row] = entry.taskId;
+    mStartTimes[row] = entry.startTime;
+    mDurations[row] = static_cast<std::int32_t>(entry.duration);
+    mEmployerSlots[row] = GetEmployerSlot(entry.employerId);
+}
+
+void TimeEntryCache::Remove(std::int64_t timeEntryId)
+{
+    auto found = mRowIndex.find(timeEntryId);
+    if (found == mRowIndex.end()) {
+        return;
+    }
+
+    const std::size_t row = found->second;
+    const std::size_t last = mTimeEntryIds.size() - 1;
+    mRowIndex.erase(found);
+
+    if (row != last) {
+        mTimeEntryIds[row] = mTimeEntryIds[last];
+        mTaskIds[row] = mTaskIds[last];
+        mStartTimes[row] = mStartTimes[last];
+        mDurations[row] = mDurations[last];
+        mEmployerSlots[row] = mEmployerSlots[last];
+        mRowIndex[mTimeEntryIds[row]] = row;
+    }
+
+    mTimeEntryIds.pop_back();
+    mTaskIds.pop_back();
+    mStartTimes.pop_back();
+    mDurations.pop_back();
+    mEmployerSlots.pop_back();
+}
+
+std::int64_t TimeEntryCache::SumDurations(std::int64_t from, std::int64_t to) const
+{
+    return pSumDurations(
+        mStartTimes.data(), mDurations.data(), mEmployerSlots.data(), Size(), from, to, AnyEmployerSlot);
+}
+
+std::int64_t TimeEntryCache::SumDurations(std::int64_t from, std::int64_t to, std::int64_t employerId) const
+{
+    auto slot = mEmployerSlotIndex.find(employerId);
+    if (slot == mEmployerSlotIndex.end()) {
+        return 0;
+    }
+
+    return pSumDurations(
+        mStartTimes.data(), mDurations.data(), mEmployerSlots.data(), Size(), from, to, slot->second);
+}
+
+std::vector<EmployerWeekTotal> TimeEntryCache::GroupByEmployerAndWeek(std::int64_t from,
+    std::int64_t to,
+    std::int64_t weekOrigin) const
+{
+    std::vector<EmployerWeekTotal> totals;
+    if (to <= from || mStartTimes.empty()) {
+        return totals;
+    }
+
+    // Only the span of the cached start times can hold a total, so a range as wide as "all time" sizes the cells
+    // like that span and nothing below overflows
+    const auto [minStart, maxStart] = std::minmax_element(mStartTimes.begin(), mStartTimes.end());
+    from = std::max(from, *minStart);
+    const std::int64_t lastStart = std::min(to - 1, *maxStart);
+    if (lastStart < from) {
+        return totals;
+    }
+
+    // The origin moves by whole weeks to the last week start at or before from, so the weeks keep their weekday
+    // and time of day. Remainders keep the arithmetic in range for any origin.
+    const std::int64_t offset = ((from % SecondsPerWeek - weekOrigin % SecondsPerWeek) % SecondsPerWeek +
+                                    SecondsPerWeek) % SecondsPerWeek;
+    weekOrigin = from - offset;
+
+    // one cell per employer slot and week, so each row is a single indexed add
+    const std::size_t weekCount = static_cast<std::size_t>((lastStart - weekOrigin) / SecondsPerWeek) + 1;
+    std::vector<std::int64_t> cells(mSlotEmployerIds.size() * weekCount, 0);
+
+    // Rows are unordered, so a branch on the range mispredicts about half the time on ranges that cover part of
+    // the cache. Each block is first filtered without branches into a list of matching rows, then those are added.
+    std::array<std::uint32_t, GroupBlockSize> selected;
+    const std::size_t count = Size();
+    for (std::size_t first = 0; first < count; first += GroupBlockSize) {
+        const std::size_t last = std::min(count, first + GroupBlockSize);
+
+        std::size_t selectedCount = 0;
+        for (std::size_t i = first; i < last; i++) {
+            const std::int64_t start = mStartTimes[i];
+            selected[selectedCount] = static_cast<std::uint32_t>(i - first);
+            selectedCount += static_cast<std::size_t>((start >= from) & (start < to));
+        }
+
+        for (std::size_t j = 0; j < selectedCount; j++) {
+            const std::size_t i = first + selected[j];
+            const auto week = static_cast<std::size_t>((mStartTimes[i] - weekOrigin) / SecondsPerWeek);
+            cells[static_cast<std::size_t>(mEmployerSlots[i]) * weekCount + week] += mDurations[i];
+        }
+    }
+
+    for (std::size_t slot = 0; slot < mSlotEmployerIds.size(); slot++) {
+        for (std::size_t week = 0; week < weekCount; week++) {
+            const std::int64_t total = cells[slot * weekCount + week];
+            if (total != 0) {
+                totals.push_back({ mSlotEmployerIds[slot],
+                    weekOrigin + static_cast<std::int64_t>(week) * SecondsPerWeek,
+                    total });
+            }
+        }
+    }
+
+    return totals;
+}
+
+bool TimeEntryCache::ForEachSource(
+    const std::function<bool(const std::string& schema, std::int64_t from, std::int64_t to)>& callback)
+{
+    const std::int64_t from = std::numeric_limits<std::int64_t>::min();
+    const std::int64_t to = std::numeric_limits<std::int64_t>::max();
+    if (pArchive == nullptr) {
+        return callback("main", from, to);
+    }
+    return pArchive->ForEachSource(from, to, callback);
+}
+
+std::int32_t TimeEntryCache::GetEmployerSlot(std::int64_t employerId)
+{
+    auto found = mEmployerSlotIndex.find(employerId);
+    if (found != mEmployerSlotIndex.end()) {
+        return found->second;
+    }
+
+    // slots are never reused, an employer without entries just keeps an empty slot
+    const auto slot = static_cast<std::int32_t>(mSlotEmployerIds.size());
+    mSlotEmployerIds.push_back(employerId);
+    mEmployerSlotIndex.emplace(employerId, slot);
+    return slot;
+}
+
+void TimeEntryCache::Append(std::int64_t timeEntryId,
+    std::int64_t taskId,
+    std::int64_t employerId,
+    std::int64_t startTime,
+    std::int64_t duration)
+{
+    mRowIndex.emplace(timeEntryId, mTimeEntryIds.size());
+    mTimeEntryIds.push_back(timeEntryId);
+    mTaskIds.push_back(taskId);
+    mStartTimes.push_back(startTime);
+    mDurations.push_back(static_cast<std::int32_t>(duration));
+    mEmployerSlots.push_back(GetEmployerSlot(employerId));
+}
+} // namespace app::Core
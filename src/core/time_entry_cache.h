@@ -0,0 +1,118 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "aggregation_kernels.h"
+#include "time_entry_repository.h"
+
+namespace app::Core
+{
+class Database;
+class TimeEntryArchive;
+
+struct EmployerWeekTotal {
+    std::int64_t employerId;
+    std::int64_t weekStart;
+    std::int64_t totalDuration;
+};
+
+// Keeps the numeric columns of every time entry in memory, one contiguous vector per column, so totals over
+// large ranges are answered by the aggregation kernels instead of SQLite. Descriptions are not cached.
+//
+// Employer ids are stored as small dense slots so the kernels compare 32-bit values and grouping can index
+// an array. Rows are unordered: removal moves the last row into the gap.
+//
+// The cache is filled once by Load and kept current by the TimeEntryRepository it is attached to.
+// With an archive set, the entries of archived years are loaded from their archive files as well, so archiving a
+// year changes no total. It is not thread safe.
+class TimeEntryCache final
+{
+public:
+    TimeEntryCache(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger);
+    TimeEntryCache(const TimeEntryCache&) = delete;
+    ~TimeEntryCache() = default;
+
+    TimeEntryCache& operator=(const TimeEntryCache&) = delete;
+
+    // Loads the entries of archived years too, set before Load
+    void SetArchive(std::shared_ptr<TimeEntryArchive> archive);
+
+    // Replaces the contents with the rows currently in time_entries and the archives
+    bool Load();
+    void Clear();
+
+    std::size_t Size() const;
+
+    void Insert(const TimeEntry& entry);
+    // Leaves the cache as it is when the entry is not in it
+    void Update(const TimeEntry& entry);
+    void Remove(std::int64_t timeEntryId);
+
+    // Sums the durations of the entries starting in [from, to)
+    std::int64_t SumDurations(std::int64_t from, std::int64_t to) const;
+    std::int64_t SumDurations(std::int64_t from, std::int64_t to, std::int64_t employerId) const;
+
+    // Totals the entries starting in [from, to) per employer and per week, where weeks are fixed seven day spans
+    // counted from weekOrigin (for example the local midnight of a Monday at or before from). Any origin works, it is
+    // moved by whole weeks. Results are ordered by employer slot and then week, empty weeks are left out.
+    std::vector<EmployerWeekTotal> GroupByEmployerAndWeek(std::int64_t from,
+        std::int64_t to,
+        std::int64_t weekOrigin) const;
+
+private:
+    // Calls the callback with "main" and every start time without an archive
+    bool ForEachSource(
+        const std::function<bool(const std::string& schema, std::int64_t from, std::int64_t to)>& callback);
+    std::int32_t GetEmployerSlot(std::int64_t employerId);
+    void Append(std::int64_t timeEntryId,
+        std::int64_t taskId,
+        std::int64_t employerId,
+        std::int64_t startTime,
+        std::int64_t duration);
+
+    std::shared_ptr<Database> pDatabase;
+    std::shared_ptr<spdlog::logger> pLogger;
+    std::shared_ptr<TimeEntryArchive> pArchive;
+
+    std::vector<std::int64_t> mTimeEntryIds;
+    std::vector<std::int64_t> mTaskIds;
+    std::vector<std::int64_t> mStartTimes;
+    std::vector<std::int32_t> mDurations;
+    std::vector<std::int32_t> mEmployerSlots;
+
+    std::unordered_map<std::int64_t, std::size_t> mRowIndex;
+    std::unordered_map<std::int64_t, std::int32_t> mEmployerSlotIndex;
+    std::vector<std::int64_t> mSlotEmployerIds;
+
+    SumDurationsKernel pSumDurations;
+
+    static const std::string CountQuery;
+    static const std::string SelectRangeQuery;
+};
+} // namespace app::Core
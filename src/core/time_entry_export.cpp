@@ -0,0 +1,472 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "time_entry_export.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <nlohmann/json.hpp>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "buffered_file_writer.h"
+#include "database.h"
+#include "local_time.h"
+#include "time_entry_archive.h"
+
+#include "../utils/utils.h"
+
+namespace
+{
+using app::Core::BufferedFileWriter;
+using app::Core::CivilTime;
+using app::Core::ExportRow;
+using app::Core::ExportWriter;
+using app::Core::LocalTimeConverter;
+using app::Core::ToCivilTime;
+
+// Formats timestamps in C++ rather than with a strftime per row, which is most of the cost of the export query
+class TimestampFormatter final
+{
+public:
+    // YYYY-MM-DDTHH:MM:SS in local time
+    std::string_view Local(std::int64_t timestamp, char (&buffer)[20])
+    {
+        const CivilTime civil = ToCivilTime(mConverter.ToLocal(timestamp));
+        char* out = buffer;
+        out = WriteDigits(out, civil.year, 4);
+        *out++ = '-';
+        out = WriteDigits(out, civil.month, 2);
+        *out++ = '-';
+        out = WriteDigits(out, civil.day, 2);
+        *out++ = 'T';
+        out = WriteDigits(out, civil.hour, 2);
+        *out++ = ':';
+        out = WriteDigits(out, civil.minute, 2);
+        *out++ = ':';
+        out = WriteDigits(out, civil.second, 2);
+        return std::string_view(buffer, static_cast<std::size_t>(out - buffer));
+    }
+
+    // YYYYMMDDTHHMMSSZ, the iCalendar UTC form
+    static std::string_view Utc(std::int64_t timestamp, char (&buffer)[17])
+    {
+        const CivilTime civil = ToCivilTime(timestamp);
+        char* out = buffer;
+        out = WriteDigits(out, civil.year, 4);
+        out = WriteDigits(out, civil.month, 2);
+        out = WriteDigits(out, civil.day, 2);
+        *out++ = 'T';
+        out = WriteDigits(out, civil.hour, 2);
+        out = WriteDigits(out, civil.minute, 2);
+        out = WriteDigits(out, civil.second, 2);
+        *out++ = 'Z';
+        return std::string_view(buffer, static_cast<std::size_t>(out - buffer));
+    }
+
+private:
+    static char* WriteDigits(char* out, std::int64_t value, int width)
+    {
+        for (int i = width - 1; i >= 0; i--) {
+            out[i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        return out + width;
+    }
+
+    LocalTimeConverter mConverter;
+};
+
+// RFC 4180 with CRLF line ends and a byte order mark so spreadsheets detect UTF-8
+class CsvExportWriter final : public ExportWriter
+{
+public:
+    void Begin(BufferedFileWriter& out) override
+    {
+        out.Write("\xEF\xBB\xBF");
+        out.Write("id,employer,task,start,duration_seconds,description\r\n");
+    }
+
+    void WriteRow(BufferedFileWriter& out, const ExportRow& row) override
+    {
+        out.Write(std::to_string(row.timeEntryId));
+        out.Write(',');
+        WriteText(out, row.employer);
+        out.Write(',');
+        WriteText(out, row.task);
+        out.Write(',');
+        out.Write(row.localStart);
+        out.Write(',');
+        out.Write(std::to_string(row.duration));
+        out.Write(',');
+        WriteText(out, row.description);
+        out.Write("\r\n");
+    }
+
+    void End(BufferedFileWriter&) override
+    {
+    }
+
+private:
+    // A leading formula character would be evaluated by spreadsheets, an apostrophe keeps it text. Text that
+    // already starts with an apostrophe the import would take for this guard gets one as well, so the import
+    // removing a single guard apostrophe from quoted fields gives back the original text.
+    static bool NeedsFormulaGuard(std::string_view text)
+    {
+        if (text.size() >= 2 && text.front() == '\'') {
+            return std::string_view("=+-@'").find(text[1]) != std::string_view::npos;
+        }
+        return !text.empty() && std::string_view("=+-@").find(text.front()) != std::string_view::npos;
+    }
+
+    static void WriteText(BufferedFileWriter& out, std::string_view text)
+    {
+        const bool formula = NeedsFormulaGuard(text);
+        const bool quoted = formula || text.find_first_of(",\"\r\n") != std::string_view::npos ||
+                            (!text.empty() && (text.front() == ' ' || text.back() == ' '));
+
+        if (!quoted) {
+            out.Write(text);
+            return;
+        }
+
+        out.Write('"');
+        if (formula) {
+            out.Write('\'');
+        }
+
+        std::size_t start = 0;
+        for (std::size_t quote = text.find('"'); quote != std::string_view::npos; quote = text.find('"', start)) {
+            out.Write(text.substr(start, quote + 1 - start));
+            out.Write('"');
+            start = quote + 1;
+        }
+        out.Write(text.substr(start));
+        out.Write('"');
+    }
+};
+
+// A JSON array with one object per line. Each row is built and serialized on its own, so only one row is ever
+// held as a json value.
+class JsonExportWriter final : public ExportWriter
+{
+public:
+    void Begin(BufferedFileWriter& out) override
+    {
+        out.Write('[');
+        bFirst = true;
+    }
+
+    void WriteRow(BufferedFileWriter& out, const ExportRow& row) override
+    {
+        mRow["id"] = row.timeEntryId;
+        mRow["employer"] = row.employer;
+        mRow["task"] = row.task;
+        mRow["start"] = row.localStart;
+        mRow["startTime"] = row.startTime;
+        mRow["duration"] = row.duration;
+        mRow["description"] = row.description;
+
+        out.Write(bFirst ? "\n  " : ",\n  ");
+        out.Write(mRow.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+        bFirst = false;
+    }
+
+    void End(BufferedFileWriter& out) override
+    {
+        out.Write(bFirst ? "]\n" : "\n]\n");
+    }
+
+private:
+    nlohmann::json mRow = nlohmann::json::object();
+    bool bFirst = true;
+};
+
+// RFC 5545 calendar with one event per entry, folded at 75 octets without splitting UTF-8 sequences
+class ICalendarExportWriter final : public ExportWriter
+{
+public:
+    explicit ICalendarExportWriter(std::string utcNow)
+        : mUtcNow(std::move(utcNow))
+        , mLine()
+    {
+    }
+
+    void Begin(BufferedFileWriter& out) override
+    {
+        out.Write("BEGIN:VCALENDAR\r\n"
+                  "VERSION:2.0\r\n"
+                  "PRODID:-//Taskies//Time entries//EN\r\n"
+                  "CALSCALE:GREGORIAN\r\n");
+    }
+
+    void WriteRow(BufferedFileWriter& out, const ExportRow& row) override
+    {
+        out.Write("BEGIN:VEVENT\r\n");
+
+        mLine = "UID:time-entry-" + std::to_string(row.timeEntryId) + "@taskies";
+        WriteLine(out);
+
+        mLine = "DTSTAMP:" + mUtcNow;
+        WriteLine(out);
+
+        mLine = "DTSTART:";
+        mLine += row.utcStart;
+        WriteLine(out);
+
+        mLine = "DTEND:";
+        mLine += row.utcEnd;
+        WriteLine(out);
+
+        mLine = "SUMMARY:";
+        AppendText(row.task);
+        mLine += " (";
+        AppendText(row.employer);
+        mLine += ')';
+        WriteLine(out);
+
+        if (!row.description.empty()) {
+            mLine = "DESCRIPTION:";
+            AppendText(row.description);
+            WriteLine(out);
+        }
+
+        out.Write("END:VEVENT\r\n");
+    }
+
+    void End(BufferedFileWriter& out) override
+    {
+        out.Write("END:VCALENDAR\r\n");
+    }
+
+private:
+    static constexpr std::size_t MaxLineOctets = 75;
+
+    void AppendText(std::string_view text)
+    {
+        for (char c : text) {
+            switch (c) {
+            case '\\':
+            case ';':
+            case ',':
+                mLine += '\\';
+                mLine += c;
+                break;
+            case '\n':
+                mLine += "\\n";
+                break;
+            case '\r':
+                break;
+            default:
+                mLine += c;
+            }
+        }
+    }
+
+    void WriteLine(BufferedFileWriter& out)
+    {
+        const std::string_view line = mLine;
+
+        std::size_t position = 0;
+        bool first = true;
+        while (position < line.size()) {
+            // continuation lines start with a space, which counts towards their length
+            const std::size_t limit = first ? MaxLineOctets : MaxLineOctets - 1;
+            std::size_t end = std::min(line.size(), position + limit);
+            while (end < line.size() && end > position + 1 && (static_cast<unsigned char>(line[end]) & 0xC0) == 0x80) {
+                end--;
+            }
+
+            if (!first) {
+                out.Write(' ');
+            }
+            out.Write(line.substr(position, end - position));
+            out.Write("\r\n");
+
+            position = end;
+            first = false;
+        }
+    }
+
+    std::string mUtcNow;
+    std::string mLine;
+};
+} // namespace
+
+namespace app::Core
+{
+// {0} is the schema holding the entries, "main" or an attached archive. Tasks and employers stay in main.
+const std::string TimeEntryExporter::CountQuery =
+    "SELECT count(*) "
+    "FROM {0}.time_entries "
+    "WHERE start_time >= ?1 AND start_time < ?2 AND (?3 IS NULL OR employer_id = ?3);";
+const std::string TimeEntryExporter::SelectQuery =
+    "SELECT te.time_entry_id, e.name, t.name, te.start_time, te.duration, coalesce(te.description, '') "
+    "FROM {0}.time_entries te "
+    "JOIN main.tasks t ON t.task_id = te.task_id "
+    "JOIN main.employers e ON e.employer_id = te.employer_id "
+    "WHERE te.start_time >= ?1 AND te.start_time < ?2 AND (?3 IS NULL OR te.employer_id = ?3) "
+    "ORDER BY te.start_time;";
+
+std::unique_ptr<ExportWriter> ExportWriter::Create(ExportFormat format, const std::string& utcNow)
+{
+    switch (format) {
+    case ExportFormat::Csv:
+        return std::make_unique<CsvExportWriter>();
+    case ExportFormat::Json:
+        return std::make_unique<JsonExportWriter>();
+    case ExportFormat::ICalendar:
+        return std::make_unique<ICalendarExportWriter>(utcNow);
+    }
+    return nullptr;
+}
+
+TimeEntryExporter::TimeEntryExporter(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger)
+    : pDatabase(database)
+    , pLogger(logger)
+    , pArchive(nullptr)
+{
+}
+
+void TimeEntryExporter::SetArchive(std::shared_ptr<TimeEntryArchive> archive)
+{
+    pArchive = archive;
+}
+
+ExportStatus TimeEntryExporter::Export(const ExportOptions& options,
+    const ProgressCallback& onProgress,
+    const std::atomic<bool>& cancelled,
+    std::int64_t& rowsWritten)
+{
+    const auto startedAt = std::chrono::steady_clock::now();
+    rowsWritten = 0;
+
+    std::int64_t total = 0;
+    const bool counted = ForEachSource(
+        options.from, options.to, [&](const std::string& schema, std::int64_t sourceFrom, std::int64_t sourceTo) {
+            auto stmt = pDatabase->Prepare(fmt::format(CountQuery, schema));
+            if (!stmt || !stmt.Bind(sourceFrom, sourceTo, options.employerId) || !stmt.Step()) {
+                pLogger->error("Failed to count time entries to export {0}", stmt.ErrorMessage());
+                return false;
+            }
+            total += stmt.Column<std::int64_t>(0);
+            return true;
+        });
+    if (!counted) {
+        return ExportStatus::Failed;
+    }
+
+    TimestampFormatter formatter;
+    char localStart[20];
+    char utcStart[17];
+    char utcEnd[17];
+
+    auto writer = ExportWriter::Create(options.format,
+        std::string(TimestampFormatter::Utc(Utils::UnixTimestamp(), utcStart)));
+
+    BufferedFileWriter out;
+    if (!out.Open(options.file)) {
+        pLogger->error("Failed to open export file {0}", options.file.u8string());
+        return ExportStatus::Failed;
+    }
+
+    onProgress(0, total);
+    writer->Begin(out);
+
+    // sources come in time order, so the rows of each one follow on from the previous
+    ExportStatus status = ExportStatus::Failed;
+    const bool exported = ForEachSource(
+        options.from, options.to, [&](const std::string& schema, std::int64_t sourceFrom, std::int64_t sourceTo) {
+            auto stmt = pDatabase->Prepare(fmt::format(SelectQuery, schema));
+            if (!stmt || !stmt.Bind(sourceFrom, sourceTo, options.employerId)) {
+                pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+                return false;
+            }
+
+            while (stmt.Step()) {
+                if (cancelled.load(std::memory_order_relaxed)) {
+                    pLogger->info("Export to {0} cancelled after {1} rows", options.file.u8string(), rowsWritten);
+                    status = ExportStatus::Cancelled;
+                    return false;
+                }
+
+                const std::int64_t startTime = stmt.Column<std::int64_t>(3);
+                const std::int64_t duration = stmt.Column<std::int64_t>(4);
+                const ExportRow row = { stmt.Column<std::int64_t>(0),
+                    stmt.Column<std::string_view>(1),
+                    stmt.Column<std::string_view>(2),
+                    startTime,
+                    duration,
+                    stmt.Column<std::string_view>(5),
+                    formatter.Local(startTime, localStart),
+                    TimestampFormatter::Utc(startTime, utcStart),
+                    TimestampFormatter::Utc(startTime + duration, utcEnd) };
+                writer->WriteRow(out, row);
+
+                if (++rowsWritten % ProgressInterval == 0) {
+                    if (!out.Good()) {
+                        pLogger->error("Failed to write export file {0}", options.file.u8string());
+                        return false;
+                    }
+                    onProgress(rowsWritten, total);
+                }
+            }
+
+            if (stmt.HasError()) {
+                pLogger->error("Failed to read time entries to export {0}", stmt.ErrorMessage());
+                return false;
+            }
+            return true;
+        });
+
+    if (!exported) {
+        return status;
+    }
+
+    writer->End(out);
+
+    const std::uint64_t bytesWritten = out.BytesWritten();
+    if (!out.Commit()) {
+        pLogger->error("Failed to write export file {0}", options.file.u8string());
+        return ExportStatus::Failed;
+    }
+
+    onProgress(rowsWritten, total);
+
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startedAt);
+    pLogger->info("Exported {0} time entries ({1} bytes) to {2} in {3}ms",
+        rowsWritten,
+        bytesWritten,
+        options.file.u8string(),
+        elapsed.count());
+    return ExportStatus::Completed;
+}
+
+bool TimeEntryExporter::ForEachSource(std::int64_t from,
+    std::int64_t to,
+    const std::function<bool(const std::string& schema, std::int64_t from, std::int64_t to)>& callback)
+{
+    if (pArchive == nullptr) {
+        return callback("main", from, to);
+    }
+    return pArchive->ForEachSource(from, to, callback);
+}
+} // namespace app::Core
@@ -0,0 +1,117 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+namespace app::Core
+{
+class Database;
+class BufferedFileWriter;
+class TimeEntryArchive;
+
+enum class ExportFormat { Csv, Json, ICalendar };
+
+enum class ExportStatus { Completed, Cancelled, Failed };
+
+// Exports the entries starting in [from, to), optionally for one employer
+struct ExportOptions {
+    ExportFormat format;
+    std::filesystem::path file;
+    std::int64_t from;
+    std::int64_t to;
+    std::optional<std::int64_t> employerId;
+};
+
+// One row of the export cursor. The views point into SQLite's buffers and are only valid until the next step.
+struct ExportRow {
+    std::int64_t timeEntryId;
+    std::string_view employer;
+    std::string_view task;
+    std::int64_t startTime;
+    std::int64_t duration;
+    std::string_view description;
+    std::string_view localStart;
+    std::string_view utcStart;
+    std::string_view utcEnd;
+};
+
+// Turns export rows into one file format. Writers keep no rows, only what they need between rows.
+class ExportWriter
+{
+public:
+    virtual ~ExportWriter() = default;
+
+    virtual void Begin(BufferedFileWriter& out) = 0;
+    virtual void WriteRow(BufferedFileWriter& out, const ExportRow& row) = 0;
+    virtual void End(BufferedFileWriter& out) = 0;
+
+    // utcNow is the export time as an iCalendar UTC timestamp
+    static std::unique_ptr<ExportWriter> Create(ExportFormat format, const std::string& utcNow);
+};
+
+// Streams time entries from a stepped cursor through a format writer into a buffered file,
+// so memory use does not grow with the number of rows
+class TimeEntryExporter final
+{
+public:
+    // Called with the rows written so far and the total, every ProgressInterval rows and once at the end
+    using ProgressCallback = std::function<void(std::int64_t written, std::int64_t total)>;
+
+    static constexpr std::int64_t ProgressInterval = 4096;
+
+    TimeEntryExporter(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger);
+    TimeEntryExporter(const TimeEntryExporter&) = delete;
+    ~TimeEntryExporter() = default;
+
+    TimeEntryExporter& operator=(const TimeEntryExporter&) = delete;
+
+    // Reads the rows of archived years from their archive files
+    void SetArchive(std::shared_ptr<TimeEntryArchive> archive);
+
+    // The target file is only replaced when the export completes
+    ExportStatus Export(const ExportOptions& options,
+        const ProgressCallback& onProgress,
+        const std::atomic<bool>& cancelled,
+        std::int64_t& rowsWritten);
+
+private:
+    // Calls the callback with "main" and the whole range without an archive
+    bool ForEachSource(std::int64_t from,
+        std::int64_t to,
+        const std::function<bool(const std::string& schema, std::int64_t from, std::int64_t to)>& callback);
+
+    std::shared_ptr<Database> pDatabase;
+    std::shared_ptr<spdlog::logger> pLogger;
+    std::shared_ptr<TimeEntryArchive> pArchive;
+
+    static const std::string CountQuery;
+    static const std::string SelectQuery;
+};
+} // namespace app::Core
@@ -0,0 +1,508 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "time_entry_import.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+
+#include "csv_reader.h"
+#include "database.h"
+#include "mapped_file.h"
+#include "time_entry_archive.h"
+
+namespace app::Core
+{
+namespace
+{
+std::string_view Trim(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// The CSV export quotes text starting with a formula character behind an apostrophe so spreadsheets keep it as
+// text, the apostrophe is not part of the value
+std::string_view RemoveFormulaGuard(std::string_view text)
+{
+    if (text.size() >= 2 && text.front() == '\'' && std::string_view("=+-@'").find(text[1]) != std::string_view::npos) {
+        text.remove_prefix(1);
+    }
+    return text;
+}
+
+bool ParseInteger(std::string_view text, std::int64_t& value)
+{
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && end == text.data() + text.size() && !text.empty();
+}
+
+// Reads a fixed number of digits, for the parts of a date and time
+bool ParseDigits(std::string_view& text, std::size_t count, unsigned& value)
+{
+    if (text.size() < count) {
+        return false;
+    }
+
+    value = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<unsigned>(text[i] - '0');
+    }
+    text.remove_prefix(count);
+    return true;
+}
+
+bool ParseSeparator(std::string_view& text, std::string_view separators)
+{
+    if (text.empty() || separators.find(text.front()) == std::string_view::npos) {
+        return false;
+    }
+    text.remove_prefix(1);
+    return true;
+}
+
+// Seconds, or H:MM[:SS]
+bool ParseDuration(std::string_view text, std::int64_t& duration)
+{
+    const std::size_t colon = text.find(':');
+    if (colon == std::string_view::npos) {
+        return ParseInteger(text, duration);
+    }
+
+    std::int64_t hours = 0;
+    if (!ParseInteger(text.substr(0, colon), hours) || hours < 0) {
+        return false;
+    }
+    text.remove_prefix(colon + 1);
+
+    unsigned minutes = 0;
+    unsigned seconds = 0;
+    if (!ParseDigits(text, 2, minutes) || minutes > 59) {
+        return false;
+    }
+    if (!text.empty() && (!ParseSeparator(text, ":") || !ParseDigits(text, 2, seconds) || seconds > 59)) {
+        return false;
+    }
+
+    duration = hours * 3600 + minutes * 60 + seconds;
+    return text.empty();
+}
+} // namespace
+
+const std::string TimeEntryImporter::SelectEmployersQuery =
+    "SELECT employer_id, name FROM employers ORDER BY employer_id;";
+const std::string TimeEntryImporter::SelectTasksQuery =
+    "SELECT task_id, employer_id, name FROM tasks ORDER BY task_id;";
+const std::string TimeEntryImporter::InsertEmployerQuery = "INSERT INTO employers (name) VALUES (?);";
+const std::string TimeEntryImporter::InsertTaskQuery = "INSERT INTO tasks (employer_id, name) VALUES (?, ?);";
+
+TimeEntryImporter::TimeEntryImporter(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger)
+    : pDatabase(database)
+    , pArchive(nullptr)
+    , pLogger(logger)
+    , mRepository(database, logger)
+    , mLocalTime()
+    , mEmployerIds()
+    , mTaskIds()
+    , mPendingEmployers()
+    , mPendingTasks()
+    , mLookupKey()
+{
+}
+
+void TimeEntryImporter::SetCache(std::shared_ptr<TimeEntryCache> cache)
+{
+    mRepository.SetCache(cache);
+}
+
+void TimeEntryImporter::SetArchive(std::shared_ptr<TimeEntryArchive> archive)
+{
+    pArchive = archive;
+    mRepository.SetArchive(archive);
+}
+
+bool TimeEntryImporter::Import(const std::filesystem::path& file, ImportSummary& summary)
+{
+    const auto startedAt = std::chrono::steady_clock::now();
+    summary = ImportSummary();
+
+    MappedFile mapped;
+    if (!mapped.Open(file)) {
+        pLogger->error("Failed to open import file {0}", file.u8string());
+        return false;
+    }
+
+    CsvReader reader(std::string_view(reinterpret_cast<const char*>(mapped.Data()), mapped.Size()));
+    std::vector<std::string_view> fields;
+
+    Columns columns;
+    if (reader.Next(fields) != CsvReader::Status::Record || !ReadColumns(fields, columns)) {
+        pLogger->error("Import file {0} has no header naming the employer, task, start and duration or end columns",
+            file.u8string());
+        return false;
+    }
+
+    if (!LoadNames()) {
+        return false;
+    }
+
+    std::vector<TimeEntry> batch;
+    batch.reserve(BatchSize);
+    std::string error;
+
+    for (auto status = reader.Next(fields); status != CsvReader::Status::End; status = reader.Next(fields)) {
+        if (status == CsvReader::Status::Malformed) {
+            Reject(summary, reader.Line(), reader.Error());
+            continue;
+        }
+
+        // blank lines carry no row
+        if (fields.size() == 1 && fields[0].empty()) {
+            continue;
+        }
+
+        if (fields.size() < columns.required) {
+            Reject(summary,
+                reader.Line(),
+                "expected " + std::to_string(columns.required) + " fields but found " + std::to_string(fields.size()));
+            continue;
+        }
+
+        for (const int column : { columns.employer, columns.task, columns.description }) {
+            if (column >= 0 && reader.IsQuoted(static_cast<std::size_t>(column))) {
+                fields[column] = RemoveFormulaGuard(fields[column]);
+            }
+        }
+
+        TimeEntry entry{};
+        if (!ParseRow(fields, columns, entry, error)) {
+            Reject(summary, reader.Line(), error);
+            continue;
+        }
+
+        if (pArchive != nullptr && pArchive->IsArchivedTime(entry.startTime)) {
+            Reject(summary, reader.Line(), "start falls in an archived year");
+            continue;
+        }
+
+        entry.employerId = ResolveEmployer(Trim(fields[columns.employer]));
+        entry.taskId = ResolveTask(entry.employerId, Trim(fields[columns.task]));
+
+        batch.push_back(std::move(entry));
+        if (batch.size() == BatchSize && !FlushBatch(batch, summary)) {
+            return false;
+        }
+    }
+
+    if (!FlushBatch(batch, summary)) {
+        return false;
+    }
+
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startedAt);
+    pLogger->info("Imported {0} time entries from {1} in {2}ms, {3} rows rejected",
+        summary.rowsImported,
+        file.u8string(),
+        elapsed.count(),
+        summary.rowsRejected);
+    return true;
+}
+
+bool TimeEntryImporter::ReadColumns(const std::vector<std::string_view>& header, Columns& columns)
+{
+    std::string name;
+    for (std::size_t i = 0; i < header.size(); i++) {
+        const std::string_view trimmed = Trim(header[i]);
+        name.assign(trimmed.begin(), trimmed.end());
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+        const int index = static_cast<int>(i);
+        if (name == "employer") {
+            columns.employer = index;
+        } else if (name == "task") {
+            columns.task = index;
+        } else if (name == "start") {
+            columns.start = index;
+        } else if (name == "duration_seconds" || name == "duration") {
+            columns.duration = index;
+        } else if (name == "end") {
+            columns.end = index;
+        } else if (name == "description") {
+            columns.description = index;
+        } else {
+            continue;
+        }
+
+        columns.required = i + 1;
+    }
+
+    return columns.employer >= 0 && columns.task >= 0 && columns.start >= 0 &&
+           (columns.duration >= 0 || columns.end >= 0);
+}
+
+bool TimeEntryImporter::LoadNames()
+{
+    mEmployerIds.clear();
+    mTaskIds.clear();
+    mPendingEmployers.clear();
+    mPendingTasks.clear();
+
+    auto employers = pDatabase->Prepare(SelectEmployersQuery);
+    if (!employers) {
+        pLogger->error("Failed to prepare statement {0}", employers.ErrorMessage());
+        return false;
+    }
+
+    while (employers.Step()) {
+        mEmployerIds.emplace(employers.Column<std::string>(1), employers.Column<std::int64_t>(0));
+    }
+
+    if (employers.HasError()) {
+        pLogger->error("Failed to read employers {0}", employers.ErrorMessage());
+        return false;
+    }
+
+    auto tasks = pDatabase->Prepare(SelectTasksQuery);
+    if (!tasks) {
+        pLogger->error("Failed to prepare statement {0}", tasks.ErrorMessage());
+        return false;
+    }
+
+    while (tasks.Step()) {
+        const std::int64_t employerId = tasks.Column<std::int64_t>(1);
+        SetTaskKey(employerId, tasks.Column<std::string_view>(2));
+        mTaskIds.emplace(mLookupKey, tasks.Column<std::int64_t>(0));
+    }
+
+    if (tasks.HasError()) {
+        pLogger->error("Failed to read tasks {0}", tasks.ErrorMessage());
+        return false;
+    }
+
+    return true;
+}
+
+bool TimeEntryImporter::ParseRow(const std::vector<std::string_view>& fields,
+    const Columns& columns,
+    TimeEntry& entry,
+    std::string& error)
+{
+    if (Trim(fields[columns.employer]).empty()) {
+        error = "employer is empty";
+        return false;
+    }
+
+    if (Trim(fields[columns.task]).empty()) {
+        error = "task is empty";
+        return false;
+    }
+
+    if (!ParseTime(Trim(fields[columns.start]), entry.startTime)) {
+        error = "start is not a unix timestamp or a YYYY-MM-DD HH:MM[:SS] time";
+        return false;
+    }
+
+    if (columns.duration >= 0) {
+        if (!ParseDuration(Trim(fields[columns.duration]), entry.duration)) {
+            error = "duration is not a number of seconds or H:MM[:SS]";
+            return false;
+        }
+    } else {
+        std::int64_t end = 0;
+        if (!ParseTime(Trim(fields[columns.end]), end)) {
+            error = "end is not a unix timestamp or a YYYY-MM-DD HH:MM[:SS] time";
+            return false;
+        }
+        entry.duration = end - entry.startTime;
+    }
+
+    if (entry.duration < 0) {
+        error = "duration is negative";
+        return false;
+    }
+
+    if (entry.duration > TimeEntryRepository::MaxDuration) {
+        error = "duration is longer than " + std::to_string(TimeEntryRepository::MaxDuration) + " seconds";
+        return false;
+    }
+
+    if (columns.description >= 0) {
+        entry.description.assign(fields[columns.description].begin(), fields[columns.description].end());
+    }
+
+    return true;
+}
+
+bool TimeEntryImporter::ParseTime(std::string_view text, std::int64_t& timestamp)
+{
+    if (ParseInteger(text, timestamp)) {
+        return true;
+    }
+
+    CivilTime civil{};
+    unsigned year = 0;
+    if (!ParseDigits(text, 4, year) || !ParseSeparator(text, "-") || !ParseDigits(text, 2, civil.month) ||
+        !ParseSeparator(text, "-") || !ParseDigits(text, 2, civil.day) || !ParseSeparator(text, "T ") ||
+        !ParseDigits(text, 2, civil.hour) || !ParseSeparator(text, ":") || !ParseDigits(text, 2, civil.minute)) {
+        return false;
+    }
+
+    if (!text.empty() && text.front() == ':' && (!ParseSeparator(text, ":") || !ParseDigits(text, 2, civil.second))) {
+        return false;
+    }
+
+    const bool isUtc = !text.empty() && text.front() == 'Z';
+    if (isUtc) {
+        text.remove_prefix(1);
+    }
+
+    if (!text.empty() || civil.month < 1 || civil.month > 12 || civil.day < 1 || civil.day > 31 ||
+        civil.hour > 23 || civil.minute > 59 || civil.second > 59) {
+        return false;
+    }
+
+    civil.year = year;
+    const std::int64_t seconds = FromCivilTime(civil);
+    timestamp = isUtc ? seconds : mLocalTime.FromLocal(seconds);
+    return true;
+}
+
+std::int64_t TimeEntryImporter::ResolveEmployer(std::string_view name)
+{
+    mLookupKey.assign(name.begin(), name.end());
+    auto found = mEmployerIds.find(mLookupKey);
+    if (found != mEmployerIds.end()) {
+        return found->second;
+    }
+
+    // created with the batch, until then the employer has a negative placeholder id
+    mPendingEmployers.push_back(mLookupKey);
+    const auto employerId = -static_cast<std::int64_t>(mPendingEmployers.size());
+    mEmployerIds.emplace(mLookupKey, employerId);
+    return employerId;
+}
+
+std::int64_t TimeEntryImporter::ResolveTask(std::int64_t employerId, std::string_view name)
+{
+    SetTaskKey(employerId, name);
+    auto found = mTaskIds.find(mLookupKey);
+    if (found != mTaskIds.end()) {
+        return found->second;
+    }
+
+    mPendingTasks.push_back(PendingTask{ employerId, std::string(name) });
+    const auto taskId = -static_cast<std::int64_t>(mPendingTasks.size());
+    mTaskIds.emplace(mLookupKey, taskId);
+    return taskId;
+}
+
+bool TimeEntryImporter::CreatePendingNames(std::vector<TimeEntry>& batch)
+{
+    std::vector<std::int64_t> employerIds;
+    employerIds.reserve(mPendingEmployers.size());
+    for (const auto& name : mPendingEmployers) {
+        auto stmt = pDatabase->Prepare(InsertEmployerQuery);
+        if (!stmt || !stmt.Bind(name) || !stmt.Execute()) {
+            pLogger->error("Failed to insert employer {0} - ({1})", name, stmt.ErrorMessage());
+            return false;
+        }
+
+        employerIds.push_back(sqlite3_last_insert_rowid(pDatabase->Handle()));
+        mEmployerIds[name] = employerIds.back();
+    }
+
+    const auto toEmployerId = [&](std::int64_t employerId) {
+        return employerId < 0 ? employerIds[static_cast<std::size_t>(-employerId - 1)] : employerId;
+    };
+
+    std::vector<std::int64_t> taskIds;
+    taskIds.reserve(mPendingTasks.size());
+    for (const auto& task : mPendingTasks) {
+        const std::int64_t employerId = toEmployerId(task.employerId);
+        auto stmt = pDatabase->Prepare(InsertTaskQuery);
+        if (!stmt || !stmt.Bind(employerId, task.name) || !stmt.Execute()) {
+            pLogger->error("Failed to insert task {0} - ({1})", task.name, stmt.ErrorMessage());
+            return false;
+        }
+
+        taskIds.push_back(sqlite3_last_insert_rowid(pDatabase->Handle()));
+        SetTaskKey(task.employerId, task.name);
+        mTaskIds.erase(mLookupKey);
+        SetTaskKey(employerId, task.name);
+        mTaskIds[mLookupKey] = taskIds.back();
+    }
+
+    for (auto& entry : batch) {
+        entry.employerId = toEmployerId(entry.employerId);
+        if (entry.taskId < 0) {
+            entry.taskId = taskIds[static_cast<std::size_t>(-entry.taskId - 1)];
+        }
+    }
+
+    mPendingEmployers.clear();
+    mPendingTasks.clear();
+    return true;
+}
+
+bool TimeEntryImporter::FlushBatch(std::vector<TimeEntry>& batch, ImportSummary& summary)
+{
+    if (batch.empty()) {
+        return true;
+    }
+
+    // new employers and tasks are written in the batch's transaction, a failed batch leaves none of them behind
+    const std::size_t employersCreated = mPendingEmployers.size();
+    const std::size_t tasksCreated = mPendingTasks.size();
+    const auto createNames = [this](std::vector<TimeEntry>& entries) { return CreatePendingNames(entries); };
+    if (!mRepository.BulkInsert(batch, createNames)) {
+        pLogger->error("Failed to import a batch of {0} time entries", batch.size());
+        return false;
+    }
+
+    summary.rowsImported += static_cast<std::int64_t>(batch.size());
+    summary.employersCreated += static_cast<std::int64_t>(employersCreated);
+    summary.tasksCreated += static_cast<std::int64_t>(tasksCreated);
+    batch.clear();
+    return true;
+}
+
+void TimeEntryImporter::SetTaskKey(std::int64_t employerId, std::string_view name)
+{
+    mLookupKey.assign(reinterpret_cast<const char*>(&employerId), sizeof(employerId));
+    mLookupKey.append(name.begin(), name.end());
+}
+
+void TimeEntryImporter::Reject(ImportSummary& summary, std::int64_t line, std::string message)
+{
+    summary.rowsRejected++;
+    if (summary.errors.size() < MaxReportedErrors) {
+        summary.errors.push_back(ImportError{ line, std::move(message) });
+    }
+}
+} // namespace app::Core
@@ -0,0 +1,139 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "local_time.h"
+#include "time_entry_repository.h"
+
+namespace app::Core
+{
+class Database;
+class TimeEntryArchive;
+class TimeEntryCache;
+
+struct ImportError {
+    std::int64_t line;
+    std::string message;
+};
+
+struct ImportSummary {
+    std::int64_t rowsImported = 0;
+    std::int64_t rowsRejected = 0;
+    std::int64_t employersCreated = 0;
+    std::int64_t tasksCreated = 0;
+    // The first MaxReportedErrors rejected rows, rowsRejected has the full count
+    std::vector<ImportError> errors;
+};
+
+// Imports time entries from a CSV file, such as one written by the CSV export.
+//
+// The first row names the columns: employer, task, start and either duration_seconds (or duration) or end are
+// required, description is optional and any other column is ignored. Start and end are unix timestamps or local
+// YYYY-MM-DD HH:MM[:SS] times (a T separator and a Z suffix for UTC are accepted), durations are seconds or
+// H:MM[:SS]. Employers and tasks are matched by name and created when missing, in the transaction of the first
+// batch that uses them. The apostrophe the export puts in front of quoted text starting with a formula character is
+// removed again.
+//
+// The file is memory mapped and read in place. Rows go in with TimeEntryRepository::BulkInsert every BatchSize
+// rows, so each batch is one transaction with one prepared statement. Within a batch the search index and the daily
+// totals are brought up to date once over all its rows rather than by the triggers row by row. A bad row is reported
+// with its line number and skipped, it does not stop the import.
+class TimeEntryImporter final
+{
+public:
+    static constexpr std::size_t BatchSize = 50000;
+    static constexpr std::size_t MaxReportedErrors = 1000;
+
+    TimeEntryImporter(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger);
+    TimeEntryImporter(const TimeEntryImporter&) = delete;
+    ~TimeEntryImporter() = default;
+
+    TimeEntryImporter& operator=(const TimeEntryImporter&) = delete;
+
+    void SetCache(std::shared_ptr<TimeEntryCache> cache);
+
+    // Rows starting in an archived year are rejected
+    void SetArchive(std::shared_ptr<TimeEntryArchive> archive);
+
+    // Returns false when the file cannot be read, it has no usable header or a batch fails to commit.
+    // Batches committed before a failure stay imported.
+    bool Import(const std::filesystem::path& file, ImportSummary& summary);
+
+private:
+    struct PendingTask {
+        std::int64_t employerId;
+        std::string name;
+    };
+
+    struct Columns {
+        int employer = -1;
+        int task = -1;
+        int start = -1;
+        int duration = -1;
+        int end = -1;
+        int description = -1;
+        std::size_t required = 0;
+    };
+
+    bool ReadColumns(const std::vector<std::string_view>& header, Columns& columns);
+    bool LoadNames();
+    bool ParseRow(const std::vector<std::string_view>& fields,
+        const Columns& columns,
+        TimeEntry& entry,
+        std::string& error);
+    bool ParseTime(std::string_view text, std::int64_t& timestamp);
+    // Return the id of the named employer or task. Ones not in the database yet get a negative placeholder id
+    // and are created by CreatePendingNames inside the transaction of the batch that uses them.
+    std::int64_t ResolveEmployer(std::string_view name);
+    std::int64_t ResolveTask(std::int64_t employerId, std::string_view name);
+    bool CreatePendingNames(std::vector<TimeEntry>& batch);
+    bool FlushBatch(std::vector<TimeEntry>& batch, ImportSummary& summary);
+    void SetTaskKey(std::int64_t employerId, std::string_view name);
+
+    static void Reject(ImportSummary& summary, std::int64_t line, std::string message);
+
+    std::shared_ptr<Database> pDatabase;
+    std::shared_ptr<TimeEntryArchive> pArchive;
+    std::shared_ptr<spdlog::logger> pLogger;
+    TimeEntryRepository mRepository;
+    LocalTimeConverter mLocalTime;
+    std::unordered_map<std::string, std::int64_t> mEmployerIds;
+    std::unordered_map<std::string, std::int64_t> mTaskIds;
+    std::vector<std::string> mPendingEmployers;
+    std::vector<PendingTask> mPendingTasks;
+    std::string mLookupKey;
+
+    static const std::string SelectEmployersQuery;
+    static const std::string SelectTasksQuery;
+    static const std::string InsertEmployerQuery;
+    static const std::string InsertTaskQuery;
+};
+} // namespace app::Core
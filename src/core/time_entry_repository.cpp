@@ -0,0 +1,433 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "time_entry_repository.h"
+
+#include <limits>
+#include <optional>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "database.h"
+#include "time_entry_archive.h"
+#include "time_entry_cache.h"
+
+namespace app::Core
+{
+// The local day is stored with the entry when it is written, see the daily totals triggers.
+// Ids continue past the archived ones, SQLite on its own would hand out ids that an archive already holds.
+const std::string TimeEntryRepository::InsertQuery =
+    "INSERT INTO time_entries (time_entry_id, task_id, employer_id, start_time, duration, description, day) "
+    "VALUES (max((SELECT coalesce(max(time_entry_id), 0) FROM time_entries), "
+    "(SELECT coalesce(max(max_time_entry_id), 0) FROM archived_years)) + 1, "
+    "?1, ?2, ?3, ?4, ?5, date(?3, 'unixepoch', 'localtime'));";
+const std::string TimeEntryRepository::BulkInsertQuery = [] {
+    std::string query = "INSERT INTO time_entries "
+                        "(time_entry_id, task_id, employer_id, start_time, duration, description, day) VALUES ";
+    for (std::size_t i = 0; i < TimeEntryRepository::RowsPerStatement; i++) {
+        const std::size_t first = i * 6 + 1;
+        query += fmt::format("{0}(?{1}, ?{2}, ?{3}, ?{4}, ?{5}, ?{6}, date(?{4}, 'unixepoch', 'localtime'))",
+            i == 0 ? "" : ", ",
+            first,
+            first + 1,
+            first + 2,
+            first + 3,
+            first + 4,
+            first + 5);
+    }
+    return query + ";";
+}();
+const std::string TimeEntryRepository::InsertWithIdQuery =
+    "INSERT INTO time_entries (time_entry_id, task_id, employer_id, start_time, duration, description, day) "
+    "VALUES (?1, ?2, ?3, ?4, ?5, ?6, date(?4, 'unixepoch', 'localtime'));";
+const std::string TimeEntryRepository::SelectMaxIdQuery =
+    "SELECT max((SELECT coalesce(max(time_entry_id), 0) FROM time_entries), "
+    "(SELECT coalesce(max(max_time_entry_id), 0) FROM archived_years));";
+// While BulkInsert's row is in bulk_insert_active the time entry insert triggers do nothing, the two queries after
+// these do their work once over all new rows and must stay in step with the triggers. NOT INDEXED keeps the totals
+// on a rowid range over the new rows, otherwise the planner scans the whole table through the employer index to
+// save the GROUP BY sort.
+const std::string TimeEntryRepository::BeginBulkInsertQuery = "INSERT INTO bulk_insert_active (active) VALUES (1);";
+const std::string TimeEntryRepository::EndBulkInsertQuery = "DELETE FROM bulk_insert_active;";
+const std::string TimeEntryRepository::IndexInsertedQuery =
+    "INSERT INTO time_entries_fts (rowid, description) "
+    "SELECT time_entry_id, description FROM time_entries WHERE time_entry_id >= ?;";
+const std::string TimeEntryRepository::AddInsertedTotalsQuery =
+    "INSERT INTO employer_daily_totals (employer_id, day, total_duration, entry_count) "
+    "SELECT employer_id, day, SUM(duration), COUNT(*) "
+    "FROM time_entries NOT INDEXED "
+    "WHERE time_entry_id >= ? "
+    "GROUP BY employer_id, day "
+    "ON CONFLICT (employer_id, day) DO UPDATE "
+    "SET total_duration = total_duration + excluded.total_duration, "
+    "entry_count = entry_count + excluded.entry_count;";
+const std::string TimeEntryRepository::UpdateQuery =
+    "UPDATE time_entries "
+    "SET task_id = ?1, employer_id = ?2, start_time = ?3, duration = ?4, description = ?5, "
+    "day = date(?3, 'unixepoch', 'localtime'), date_modified = strftime('%s','now', 'localtime') "
+    "WHERE time_entry_id = ?6;";
+const std::string TimeEntryRepository::DeleteQuery = "DELETE FROM time_entries WHERE time_entry_id = ?;";
+const std::string TimeEntryRepository::SelectRangeQuery =
+    "SELECT time_entry_id, task_id, employer_id, start_time, duration, description "
+    "FROM time_entries "
+    "WHERE start_time >= ? AND start_time < ? "
+    "ORDER BY start_time;";
+const std::string TimeEntryRepository::SelectArchivedStartQuery =
+    "SELECT start_time FROM {0}.time_entries WHERE time_entry_id = ?;";
+const std::string TimeEntryRepository::SelectArchivedRangeQuery =
+    "SELECT time_entry_id, task_id, employer_id, start_time, duration, description "
+    "FROM {0}.time_entries "
+    "WHERE start_time >= ? AND start_time < ? "
+    "ORDER BY start_time;";
+
+TimeEntryRepository::TimeEntryRepository(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger)
+    : pDatabase(database)
+    , pCache(nullptr)
+    , pArchive(nullptr)
+    , pLogger(logger)
+{
+}
+
+void TimeEntryRepository::SetCache(std::shared_ptr<TimeEntryCache> cache)
+{
+    pCache = cache;
+}
+
+void TimeEntryRepository::SetArchive(std::shared_ptr<TimeEntryArchive> archive)
+{
+    pArchive = archive;
+}
+
+bool TimeEntryRepository::Insert(TimeEntry& entry)
+{
+    if (!IsValid(entry) || IsArchived(entry) || !InsertEntry(entry)) {
+        return false;
+    }
+
+    entry.timeEntryId = sqlite3_last_insert_rowid(pDatabase->Handle());
+    if (pCache != nullptr) {
+        pCache->Insert(entry);
+    }
+    return true;
+}
+
+bool TimeEntryRepository::BulkInsert(const std::vector<TimeEntry>& entries)
+{
+    return InsertBatch(entries, nullptr);
+}
+
+bool TimeEntryRepository::BulkInsert(std::vector<TimeEntry>& entries,
+    const std::function<bool(std::vector<TimeEntry>& entries)>& beforeInsert)
+{
+    return InsertBatch(entries, [&]() { return beforeInsert(entries); });
+}
+
+bool TimeEntryRepository::InsertBatch(const std::vector<TimeEntry>& entries, const std::function<bool()>& beforeInsert)
+{
+    for (const auto& entry : entries) {
+        if (!IsValid(entry) || IsArchived(entry)) {
+            return false;
+        }
+    }
+
+    Transaction transaction(*pDatabase);
+    if (!transaction.IsActive()) {
+        return false;
+    }
+
+    if (beforeInsert && !beforeInsert()) {
+        return false;
+    }
+
+    // ids are handed out one past the largest, archived ones included, the write lock keeps them stable
+    std::int64_t firstId = 0;
+    {
+        auto stmt = pDatabase->Prepare(SelectMaxIdQuery);
+        if (!stmt || !stmt.Step()) {
+            pLogger->error("Failed to read the largest time entry id {0}", stmt.ErrorMessage());
+            return false;
+        }
+        firstId = stmt.Column<std::int64_t>(0) + 1;
+    }
+
+    // Indexing and totalling row by row through the insert triggers costs more than the inserts themselves.
+    // The triggers skip the rows of this transaction and their work is done once over all new rows. The marker
+    // row is removed again before the commit, so no other connection ever sees it.
+    if (!pDatabase->Execute(BeginBulkInsertQuery)) {
+        return false;
+    }
+
+    // full groups of rows go in through a multi-row statement and only the remainder one row at a time
+    const std::size_t bulkRows = entries.size() - entries.size() % RowsPerStatement;
+    if (bulkRows > 0) {
+        auto stmt = pDatabase->Prepare(BulkInsertQuery);
+        if (!stmt) {
+            pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+            return false;
+        }
+
+        for (std::size_t first = 0; first < bulkRows; first += RowsPerStatement) {
+            stmt.Reset();
+            for (std::size_t i = 0; i < RowsPerStatement; i++) {
+                if (!BindEntry(stmt, static_cast<int>(i * 6), firstId + first + i, entries[first + i])) {
+                    pLogger->error("Failed to bind {0}", stmt.ErrorMessage());
+                    return false;
+                }
+            }
+
+            if (!stmt.Execute()) {
+                pLogger->error("Failed to insert time entries {0}", stmt.ErrorMessage());
+                return false;
+            }
+        }
+    }
+
+    if (bulkRows < entries.size()) {
+        auto stmt = pDatabase->Prepare(InsertWithIdQuery);
+        if (!stmt) {
+            pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+            return false;
+        }
+
+        for (std::size_t i = bulkRows; i < entries.size(); i++) {
+            stmt.Reset();
+            if (!BindEntry(stmt, 0, firstId + i, entries[i])) {
+                pLogger->error("Failed to bind {0}", stmt.ErrorMessage());
+                return false;
+            }
+
+            if (!stmt.Execute()) {
+                pLogger->error("Failed to insert time entry {0}", stmt.ErrorMessage());
+                return false;
+            }
+        }
+    }
+
+    if (!ApplyInsertTriggers(firstId) || !pDatabase->Execute(EndBulkInsertQuery) || !transaction.Commit()) {
+        return false;
+    }
+
+    // the cache only learns about the rows once the transaction has committed
+    if (pCache != nullptr) {
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            TimeEntry inserted = entries[i];
+            inserted.timeEntryId = firstId + static_cast<std::int64_t>(i);
+            pCache->Insert(inserted);
+        }
+    }
+
+    return true;
+}
+
+bool TimeEntryRepository::ApplyInsertTriggers(std::int64_t firstId)
+{
+    {
+        auto stmt = pDatabase->Prepare(IndexInsertedQuery);
+        if (!stmt || !stmt.Bind(firstId) || !stmt.Execute()) {
+            pLogger->error("Failed to index the inserted time entries {0}", stmt.ErrorMessage());
+            return false;
+        }
+    }
+
+    auto stmt = pDatabase->Prepare(AddInsertedTotalsQuery);
+    if (!stmt || !stmt.Bind(firstId) || !stmt.Execute()) {
+        pLogger->error("Failed to add the inserted time entries to the daily totals {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    return true;
+}
+
+bool TimeEntryRepository::Update(const TimeEntry& entry)
+{
+    if (!IsValid(entry) || IsArchived(entry)) {
+        return false;
+    }
+
+    auto stmt = pDatabase->Prepare(UpdateQuery);
+    if (!stmt ||
+        !stmt.Bind(entry.taskId,
+            entry.employerId,
+            entry.startTime,
+            entry.duration,
+            entry.description,
+            entry.timeEntryId)) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    if (!stmt.Execute()) {
+        pLogger->error("Failed to update time entry {0} - ({1})", entry.timeEntryId, stmt.ErrorMessage());
+        return false;
+    }
+
+    if (sqlite3_changes(pDatabase->Handle()) != 1) {
+        ReportMissing(entry.timeEntryId);
+        return false;
+    }
+
+    if (pCache != nullptr) {
+        pCache->Update(entry);
+    }
+    return true;
+}
+
+bool TimeEntryRepository::Delete(std::int64_t timeEntryId)
+{
+    auto stmt = pDatabase->Prepare(DeleteQuery);
+    if (!stmt || !stmt.Bind(timeEntryId)) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    if (!stmt.Execute()) {
+        pLogger->error("Failed to delete time entry {0} - ({1})", timeEntryId, stmt.ErrorMessage());
+        return false;
+    }
+
+    if (sqlite3_changes(pDatabase->Handle()) != 1) {
+        ReportMissing(timeEntryId);
+        return false;
+    }
+
+    if (pCache != nullptr) {
+        pCache->Remove(timeEntryId);
+    }
+    return true;
+}
+
+bool TimeEntryRepository::GetRange(std::int64_t from, std::int64_t to, std::vector<TimeEntry>& entries)
+{
+    if (pArchive == nullptr) {
+        return ReadRange(SelectRangeQuery, from, to, entries);
+    }
+
+    // sources come in time order, so the pieces concatenate in start time order
+    return pArchive->ForEachSource(
+        from, to, [&](const std::string& schema, std::int64_t sourceFrom, std::int64_t sourceTo) {
+            const std::string query =
+                schema == "main" ? SelectRangeQuery : fmt::format(SelectArchivedRangeQuery, schema);
+            return ReadRange(query, sourceFrom, sourceTo, entries);
+        });
+}
+
+bool TimeEntryRepository::BindEntry(Statement& stmt, int offset, std::int64_t timeEntryId, const TimeEntry& entry)
+{
+    return stmt.BindAt(offset + 1, timeEntryId) && stmt.BindAt(offset + 2, entry.taskId) &&
+           stmt.BindAt(offset + 3, entry.employerId) && stmt.BindAt(offset + 4, entry.startTime) &&
+           stmt.BindAt(offset + 5, entry.duration) && stmt.BindAt(offset + 6, entry.description);
+}
+
+bool TimeEntryRepository::ReadRange(const std::string& query,
+    std::int64_t from,
+    std::int64_t to,
+    std::vector<TimeEntry>& entries)
+{
+    auto stmt = pDatabase->Prepare(query);
+    if (!stmt || !stmt.Bind(from, to)) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    while (stmt.Step()) {
+        entries.push_back(stmt.RowAs<TimeEntry,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t,
+            std::int64_t,
+            std::string>());
+    }
+
+    if (stmt.HasError()) {
+        pLogger->error("Failed to read time entries {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    return true;
+}
+
+bool TimeEntryRepository::IsValid(const TimeEntry& entry) const
+{
+    if (entry.duration >= 0 && entry.duration <= MaxDuration) {
+        return true;
+    }
+
+    pLogger->error("Time entry duration {0} is outside 0 to {1} seconds", entry.duration, MaxDuration);
+    return false;
+}
+
+bool TimeEntryRepository::IsArchived(const TimeEntry& entry) const
+{
+    if (pArchive == nullptr || !pArchive->IsArchivedTime(entry.startTime)) {
+        return false;
+    }
+
+    pLogger->error("Time entry starting at {0} falls in an archived year", entry.startTime);
+    return true;
+}
+
+void TimeEntryRepository::ReportMissing(std::int64_t timeEntryId)
+{
+    // archived entries are read-only, an id that only an archive holds is reported the way IsArchived does
+    std::optional<std::int64_t> archivedStart;
+    if (pArchive != nullptr) {
+        pArchive->ForEachSource(std::numeric_limits<std::int64_t>::min(),
+            std::numeric_limits<std::int64_t>::max(),
+            [&](const std::string& schema, std::int64_t, std::int64_t) {
+                if (schema == "main") {
+                    return true;
+                }
+
+                auto stmt = pDatabase->Prepare(fmt::format(SelectArchivedStartQuery, schema));
+                if (!stmt || !stmt.Bind(timeEntryId)) {
+                    pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+                    return false;
+                }
+
+                if (stmt.Step()) {
+                    archivedStart = stmt.Column<std::int64_t>(0);
+                }
+                return !archivedStart.has_value() && !stmt.HasError();
+            });
+    }
+
+    if (archivedStart.has_value()) {
+        pLogger->error("Time entry starting at {0} falls in an archived year", *archivedStart);
+    } else {
+        pLogger->error("Time entry {0} does not exist", timeEntryId);
+    }
+}
+
+bool TimeEntryRepository::InsertEntry(const TimeEntry& entry)
+{
+    auto stmt = pDatabase->Prepare(InsertQuery);
+    if (!stmt || !stmt.Bind(entry.taskId, entry.employerId, entry.startTime, entry.duration, entry.description)) {
+        pLogger->error("Failed to prepare statement {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    if (!stmt.Execute()) {
+        pLogger->error("Failed to insert time entry {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    return true;
+}
+} // namespace app::Core
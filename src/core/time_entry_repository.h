@@ -0,0 +1,118 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace app::Core
+{
+class Database;
+class Statement;
+class TimeEntryArchive;
+class TimeEntryCache;
+
+// Times are unix timestamps in seconds, durations are in seconds
+struct TimeEntry {
+    std::int64_t timeEntryId;
+    std::int64_t taskId;
+    std::int64_t employerId;
+    std::int64_t startTime;
+    std::int64_t duration;
+    std::string description;
+};
+
+class TimeEntryRepository final
+{
+public:
+    TimeEntryRepository(std::shared_ptr<Database> database, std::shared_ptr<spdlog::logger> logger);
+    TimeEntryRepository(const TimeEntryRepository&) = delete;
+    ~TimeEntryRepository() = default;
+
+    TimeEntryRepository& operator=(const TimeEntryRepository&) = delete;
+
+    // Keeps the cache in step with every successful write made through this repository
+    void SetCache(std::shared_ptr<TimeEntryCache> cache);
+
+    // Routes range reads over archived years to their archive files. Archived years are closed: entries cannot be
+    // written into them and archived entries cannot be updated or deleted.
+    void SetArchive(std::shared_ptr<TimeEntryArchive> archive);
+
+    // Durations are kept as 32-bit values by TimeEntryCache, writes with a longer or negative duration fail
+    static constexpr std::int64_t MaxDuration = std::numeric_limits<std::int32_t>::max();
+
+    // Inserts the entry and sets its id
+    bool Insert(TimeEntry& entry);
+
+    // Rows per statement in BulkInsert, within SQLite's oldest default limit of 999 parameters
+    static constexpr std::size_t RowsPerStatement = 64;
+
+    // Inserts all entries in one transaction with reused prepared statements, ids are not read back
+    bool BulkInsert(const std::vector<TimeEntry>& entries);
+
+    // Runs beforeInsert inside the same transaction first, it may write rows the entries refer to and fill in
+    // their ids. What it writes commits or rolls back together with the entries.
+    bool BulkInsert(std::vector<TimeEntry>& entries,
+        const std::function<bool(std::vector<TimeEntry>& entries)>& beforeInsert);
+
+    // Update and Delete fail when no time entry in the main database has the id, archived entries included
+    bool Update(const TimeEntry& entry);
+    bool Delete(std::int64_t timeEntryId);
+
+    // Reads the entries starting in [from, to) ordered by start time
+    bool GetRange(std::int64_t from, std::int64_t to, std::vector<TimeEntry>& entries);
+
+private:
+    bool InsertEntry(const TimeEntry& entry);
+    bool InsertBatch(const std::vector<TimeEntry>& entries, const std::function<bool()>& beforeInsert);
+    bool IsValid(const TimeEntry& entry) const;
+    bool IsArchived(const TimeEntry& entry) const;
+    void ReportMissing(std::int64_t timeEntryId);
+    bool ApplyInsertTriggers(std::int64_t firstId);
+    bool ReadRange(const std::string& query, std::int64_t from, std::int64_t to, std::vector<TimeEntry>& entries);
+    static bool BindEntry(Statement& stmt, int offset, std::int64_t timeEntryId, const TimeEntry& entry);
+
+    std::shared_ptr<Database> pDatabase;
+    std::shared_ptr<TimeEntryCache> pCache;
+    std::shared_ptr<TimeEntryArchive> pArchive;
+    std::shared_ptr<spdlog::logger> pLogger;
+
+    static const std::string InsertQuery;
+    static const std::string BulkInsertQuery;
+    static const std::string InsertWithIdQuery;
+    static const std::string SelectMaxIdQuery;
+    static const std::string BeginBulkInsertQuery;
+    static const std::string EndBulkInsertQuery;
+    static const std::string IndexInsertedQuery;
+    static const std::string AddInsertedTotalsQuery;
+    static const std::string UpdateQuery;
+    static const std::string DeleteQuery;
+    static const std::string SelectRangeQuery;
+    static const std::string SelectArchivedStartQuery;
+    static const std::string SelectArchivedRangeQuery;
+};
+} // namespace app::Core
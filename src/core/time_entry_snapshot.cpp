@@ -0,0 +1,435 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "time_entry_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+namespace
+{
+constexpr char HeaderMagic[8] = { 'T', 'K', 'S', 'S', 'N', 'A', 'P', '1' };
+constexpr char TrailerMagic[4] = { 'T', 'K', 'S', 'E' };
+constexpr std::uint32_t FormatVersion = 1;
+
+constexpr std::size_t HeaderSize = 8 + 4 + 4 + 8 + 8 + 8 * 3;
+constexpr std::size_t BlockEntrySize = 8 * 3 + 4 + 4 + 8 * 2 * 5;
+constexpr std::size_t TrailerSize = 8 + 4 + 4;
+
+void PutU32(std::string& buffer, std::uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void PutU64(std::string& buffer, std::uint64_t value)
+{
+    for (int i = 0; i < 8; i++) {
+        buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void PutI64(std::string& buffer, std::int64_t value)
+{
+    PutU64(buffer, static_cast<std::uint64_t>(value));
+}
+
+std::uint32_t GetU32(const std::uint8_t* data)
+{
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<std::uint32_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+std::uint64_t GetU64(const std::uint8_t* data)
+{
+    std::uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= static_cast<std::uint64_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+std::int64_t GetI64(const std::uint8_t* data)
+{
+    return static_cast<std::int64_t>(GetU64(data));
+}
+
+std::uint64_t ZigZagEncode(std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t ZigZagDecode(std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+void PutVarint(std::string& buffer, std::uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+bool GetVarint(const std::uint8_t*& data, const std::uint8_t* end, std::uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7) {
+        const std::uint8_t byte = *data++;
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+namespace app::Core
+{
+TimeEntrySnapshot::TimeEntrySnapshot()
+    : mFile()
+    , mYear(0)
+    , mYearStart(0)
+    , mYearEnd(0)
+    , mSignature({ 0, 0, 0 })
+    , mFooterOffset(0)
+    , mBlockCount(0)
+{
+}
+
+bool TimeEntrySnapshot::Write(const std::filesystem::path& file,
+    int year,
+    std::int64_t yearStart,
+    std::int64_t yearEnd,
+    const SnapshotSignature& signature,
+    const std::vector<TimeEntry>& entries)
+{
+    std::string buffer;
+    buffer.reserve(HeaderSize + entries.size() * 12);
+
+    buffer.append(HeaderMagic, sizeof(HeaderMagic));
+    PutU32(buffer, FormatVersion);
+    PutU32(buffer, static_cast<std::uint32_t>(year));
+    PutI64(buffer, yearStart);
+    PutI64(buffer, yearEnd);
+    PutI64(buffer, signature.rowCount);
+    PutI64(buffer, signature.maxTimeEntryId);
+    PutI64(buffer, signature.maxDateModified);
+
+    std::vector<Block> blocks;
+    for (std::size_t first = 0; first < entries.size(); first += BlockRows) {
+        const std::size_t last = std::min(entries.size(), first + BlockRows);
+
+        Block block = {};
+        block.firstStart = entries[first].startTime;
+        block.lastStart = entries[last - 1].startTime;
+        block.rowCount = static_cast<std::uint32_t>(last - first);
+
+        for (int column = 0; column < ColumnCount; column++) {
+            block.offsets[column] = buffer.size();
+
+            // every block starts from zero so it can be decoded on its own
+            std::int64_t previous = 0;
+            for (std::size_t i = first; i < last; i++) {
+                const TimeEntry& entry = entries[i];
+                switch (column) {
+                case TimeEntryIdColumn:
+                    PutVarint(buffer, ZigZagEncode(entry.timeEntryId - previous));
+                    previous = entry.timeEntryId;
+                    break;
+                case TaskIdColumn:
+                    PutVarint(buffer, ZigZagEncode(entry.taskId - previous));
+                    previous = entry.taskId;
+                    break;
+                case EmployerIdColumn:
+                    PutVarint(buffer, ZigZagEncode(entry.employerId - previous));
+                    previous = entry.employerId;
+                    break;
+                case StartTimeColumn:
+                    PutVarint(buffer, ZigZagEncode(entry.startTime - previous));
+                    previous = entry.startTime;
+                    break;
+                case DurationColumn:
+                    // durations do not follow each other, a delta would only make them larger
+                    PutVarint(buffer, ZigZagEncode(entry.duration));
+                    block.totalDuration += entry.duration;
+                    break;
+                }
+            }
+
+            block.lengths[column] = buffer.size() - block.offsets[column];
+        }
+
+        blocks.push_back(block);
+    }
+
+    const std::uint64_t footerOffset = buffer.size();
+    for (const auto& block : blocks) {
+        PutI64(buffer, block.firstStart);
+        PutI64(buffer, block.lastStart);
+        PutI64(buffer, block.totalDuration);
+        PutU32(buffer, block.rowCount);
+        PutU32(buffer, 0);
+        for (int column = 0; column < ColumnCount; column++) {
+            PutU64(buffer, block.offsets[column]);
+            PutU64(buffer, block.lengths[column]);
+        }
+    }
+
+    PutU64(buffer, footerOffset);
+    PutU32(buffer, static_cast<std::uint32_t>(blocks.size()));
+    buffer.append(TrailerMagic, sizeof(TrailerMagic));
+
+    std::filesystem::path temporaryFile = file;
+    temporaryFile += ".tmp";
+
+    {
+        std::ofstream stream(temporaryFile, std::ios::binary | std::ios::trunc);
+        if (!stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size())) || !stream.flush()) {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temporaryFile, file, ec);
+    if (ec) {
+        std::filesystem::remove(temporaryFile, ec);
+        return false;
+    }
+
+    return true;
+}
+
+bool TimeEntrySnapshot::Open(const std::filesystem::path& file)
+{
+    Close();
+
+    if (!mFile.Open(file)) {
+        return false;
+    }
+
+    const std::uint8_t* data = mFile.Data();
+    const std::size_t size = mFile.Size();
+    if (size < HeaderSize + TrailerSize || std::memcmp(data, HeaderMagic, sizeof(HeaderMagic)) != 0 ||
+        GetU32(data + 8) != FormatVersion ||
+        std::memcmp(data + size - sizeof(TrailerMagic), TrailerMagic, sizeof(TrailerMagic)) != 0) {
+        Close();
+        return false;
+    }
+
+    mFooterOffset = GetU64(data + size - TrailerSize);
+    mBlockCount = GetU32(data + size - TrailerSize + 8);
+    // compared by subtraction, a corrupt footer offset near the top of the range must not wrap the sum around
+    if (mFooterOffset < HeaderSize || mFooterOffset > size - TrailerSize ||
+        size - TrailerSize - mFooterOffset != static_cast<std::uint64_t>(mBlockCount) * BlockEntrySize) {
+        Close();
+        return false;
+    }
+
+    mYear = static_cast<int>(GetU32(data + 12));
+    mYearStart = GetI64(data + 16);
+    mYearEnd = GetI64(data + 24);
+    mSignature = { GetI64(data + 32), GetI64(data + 40), GetI64(data + 48) };
+    return true;
+}
+
+void TimeEntrySnapshot::Close()
+{
+    mFile.Close();
+    mYear = 0;
+    mYearStart = 0;
+    mYearEnd = 0;
+    mSignature = { 0, 0, 0 };
+    mFooterOffset = 0;
+    mBlockCount = 0;
+}
+
+bool TimeEntrySnapshot::IsOpen() const
+{
+    return mFile.IsOpen();
+}
+
+int TimeEntrySnapshot::Year() const
+{
+    return mYear;
+}
+
+std::int64_t TimeEntrySnapshot::YearStart() const
+{
+    return mYearStart;
+}
+
+std::int64_t TimeEntrySnapshot::YearEnd() const
+{
+    return mYearEnd;
+}
+
+const SnapshotSignature& TimeEntrySnapshot::Signature() const
+{
+    return mSignature;
+}
+
+bool TimeEntrySnapshot::SumDurations(std::int64_t from,
+    std::int64_t to,
+    std::optional<std::int64_t> employerId,
+    std::int64_t& totalDuration) const
+{
+    std::int64_t total = 0;
+    std::vector<std::int64_t> startTimes;
+    std::vector<std::int64_t> durations;
+    std::vector<std::int64_t> employerIds;
+
+    for (std::uint32_t i = 0; i < mBlockCount; i++) {
+        const Block block = ReadBlock(i);
+        if (block.lastStart < from || block.firstStart >= to) {
+            continue;
+        }
+
+        // whole blocks inside the range are answered from the footer without touching their pages
+        if (!employerId.has_value() && block.firstStart >= from && block.lastStart < to) {
+            total += block.totalDuration;
+            continue;
+        }
+
+        if (!DecodeColumn(block, StartTimeColumn, startTimes) || !DecodeColumn(block, DurationColumn, durations) ||
+            (employerId.has_value() && !DecodeColumn(block, EmployerIdColumn, employerIds))) {
+            return false;
+        }
+
+        for (std::uint32_t row = 0; row < block.rowCount; row++) {
+            if (startTimes[row] >= from && startTimes[row] < to &&
+                (!employerId.has_value() || employerIds[row] == *employerId)) {
+                total += durations[row];
+            }
+        }
+    }
+
+    totalDuration = total;
+    return true;
+}
+
+bool TimeEntrySnapshot::Read(std::int64_t from, std::int64_t to, std::vector<TimeEntry>& entries) const
+{
+    std::vector<std::int64_t> columns[ColumnCount];
+    const std::size_t firstAppended = entries.size();
+
+    for (std::uint32_t i = 0; i < mBlockCount; i++) {
+        const Block block = ReadBlock(i);
+        if (block.lastStart < from || block.firstStart >= to) {
+            continue;
+        }
+
+        bool decoded = true;
+        for (int column = 0; column < ColumnCount && decoded; column++) {
+            decoded = DecodeColumn(block, static_cast<Column>(column), columns[column]);
+        }
+        if (!decoded) {
+            entries.resize(firstAppended);
+            return false;
+        }
+
+        for (std::uint32_t row = 0; row < block.rowCount; row++) {
+            const std::int64_t startTime = columns[StartTimeColumn][row];
+            if (startTime >= from && startTime < to) {
+                entries.push_back({ columns[TimeEntryIdColumn][row],
+                    columns[TaskIdColumn][row],
+                    columns[EmployerIdColumn][row],
+                    startTime,
+                    columns[DurationColumn][row],
+                    std::string() });
+            }
+        }
+    }
+
+    return true;
+}
+
+TimeEntrySnapshot::Block TimeEntrySnapshot::ReadBlock(std::uint32_t index) const
+{
+    const std::uint8_t* data = mFile.Data() + mFooterOffset + index * BlockEntrySize;
+
+    Block block;
+    block.firstStart = GetI64(data);
+    block.lastStart = GetI64(data + 8);
+    block.totalDuration = GetI64(data + 16);
+    block.rowCount = GetU32(data + 24);
+    for (int column = 0; column < ColumnCount; column++) {
+        block.offsets[column] = GetU64(data + 32 + column * 16);
+        block.lengths[column] = GetU64(data + 40 + column * 16);
+    }
+    return block;
+}
+
+bool TimeEntrySnapshot::DecodeColumn(const Block& block, Column column, std::vector<std::int64_t>& values) const
+{
+    const std::uint64_t offset = block.offsets[column];
+    const std::uint64_t length = block.lengths[column];
+    if (offset < HeaderSize || offset > mFooterOffset || length > mFooterOffset - offset) {
+        return false;
+    }
+
+    // every row takes at least one byte, so a row count from a corrupt footer cannot size the buffer past the column
+    if (block.rowCount == 0 || block.rowCount > BlockRows || block.rowCount > length) {
+        return false;
+    }
+
+    const std::uint8_t* data = mFile.Data() + offset;
+    const std::uint8_t* end = data + length;
+
+    values.resize(block.rowCount);
+    std::int64_t previous = 0;
+    std::int64_t total = 0;
+    for (std::uint32_t row = 0; row < block.rowCount; row++) {
+        std::uint64_t encoded;
+        if (!GetVarint(data, end, encoded)) {
+            return false;
+        }
+
+        if (column == DurationColumn) {
+            values[row] = ZigZagDecode(encoded);
+            total += values[row];
+        } else {
+            previous += ZigZagDecode(encoded);
+            values[row] = previous;
+        }
+    }
+
+    // a column must use up exactly its bytes and agree with what the footer says about the block
+    if (data != end) {
+        return false;
+    }
+    if (column == StartTimeColumn) {
+        return values.front() == block.firstStart && values.back() == block.lastStart;
+    }
+    if (column == DurationColumn) {
+        return total == block.totalDuration;
+    }
+    return true;
+}
+} // namespace app::Core
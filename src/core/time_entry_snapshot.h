@@ -0,0 +1,114 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "mapped_file.h"
+#include "time_entry_repository.h"
+
+namespace app::Core
+{
+// Describes the rows a snapshot was written from, so a stale snapshot can be detected
+struct SnapshotSignature {
+    std::int64_t rowCount;
+    std::int64_t maxTimeEntryId;
+    std::int64_t maxDateModified;
+};
+
+// Read-only columnar copy of the time entries of one closed year.
+//
+// Layout, all integers little-endian:
+//   header  magic "TKSSNAP1", version, year, [yearStart, yearEnd), signature
+//   blocks  up to BlockRows rows sorted by start time, each column stored separately as zigzag varints of the
+//           difference to the previous row in the block (durations are stored as is)
+//   footer  per block: first and last start time, row count, total duration, column offsets and lengths
+//   trailer footer offset, block count and the end magic "TKSE"
+//
+// Opening only maps the file and checks the footer, blocks are decoded when a query touches them.
+// Descriptions are not part of the snapshot.
+class TimeEntrySnapshot final
+{
+public:
+    static constexpr std::uint32_t BlockRows = 4096;
+
+    TimeEntrySnapshot();
+    TimeEntrySnapshot(const TimeEntrySnapshot&) = delete;
+    TimeEntrySnapshot(TimeEntrySnapshot&&) = default;
+    ~TimeEntrySnapshot() = default;
+
+    TimeEntrySnapshot& operator=(const TimeEntrySnapshot&) = delete;
+    TimeEntrySnapshot& operator=(TimeEntrySnapshot&&) = default;
+
+    // Writes the entries, which must be sorted by start time, to a temporary file that then replaces the target
+    static bool Write(const std::filesystem::path& file,
+        int year,
+        std::int64_t yearStart,
+        std::int64_t yearEnd,
+        const SnapshotSignature& signature,
+        const std::vector<TimeEntry>& entries);
+
+    bool Open(const std::filesystem::path& file);
+    void Close();
+    bool IsOpen() const;
+
+    int Year() const;
+    std::int64_t YearStart() const;
+    std::int64_t YearEnd() const;
+    const SnapshotSignature& Signature() const;
+
+    // Sums the durations of the entries starting in [from, to), optionally for one employer.
+    // Returns false when a block the range touches cannot be decoded.
+    bool SumDurations(std::int64_t from,
+        std::int64_t to,
+        std::optional<std::int64_t> employerId,
+        std::int64_t& totalDuration) const;
+
+    // Appends the entries starting in [from, to) in start time order, with empty descriptions.
+    // Returns false and appends nothing when a block the range touches cannot be decoded.
+    bool Read(std::int64_t from, std::int64_t to, std::vector<TimeEntry>& entries) const;
+
+private:
+    enum Column { TimeEntryIdColumn, TaskIdColumn, EmployerIdColumn, StartTimeColumn, DurationColumn, ColumnCount };
+
+    struct Block {
+        std::int64_t firstStart;
+        std::int64_t lastStart;
+        std::int64_t totalDuration;
+        std::uint32_t rowCount;
+        std::uint64_t offsets[ColumnCount];
+        std::uint64_t lengths[ColumnCount];
+    };
+
+    Block ReadBlock(std::uint32_t index) const;
+    bool DecodeColumn(const Block& block, Column column, std::vector<std::int64_t>& values) const;
+
+    MappedFile mFile;
+    int mYear;
+    std::int64_t mYearStart;
+    std::int64_t mYearEnd;
+    SnapshotSignature mSignature;
+    std::uint64_t mFooterOffset;
+    std::uint32_t mBlockCount;
+};
+} // namespace app::Core
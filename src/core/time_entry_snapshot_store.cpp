@@ -0,0 +1,362 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "time_entry_snapshot_store.h"
+
+#include <algorithm>
+#include <cctype>
+#include <system_error>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "database.h"
+#include "time_entry_archive.h"
+
+namespace
+{
+const std::string SnapshotExtension = ".snapshot";
+} // namespace
+
+namespace app::Core
+{
+const std::string TimeEntrySnapshotStore::SelectCurrentYearQuery =
+    "SELECT CAST(strftime('%Y', 'now', 'localtime') AS INTEGER);";
+const std::string TimeEntrySnapshotStore::SelectYearBoundsQuery =
+    "SELECT CAST(strftime('%s', printf('%04d-01-01', ?1), 'utc') AS INTEGER), "
+    "CAST(strftime('%s', printf('%04d-01-01', ?1 + 1), 'utc') AS INTEGER);";
+const std::string TimeEntrySnapshotStore::SelectFirstYearQuery =
+    "SELECT CAST(strftime('%Y', min(start_time), 'unixepoch', 'localtime') AS INTEGER) FROM time_entries;";
+const std::string TimeEntrySnapshotStore::SelectSignatureQuery =
+    "SELECT count(*), coalesce(max(time_entry_id), 0), coalesce(max(date_modified), 0) "
+    "FROM time_entries "
+    "WHERE start_time >= ? AND start_time < ?;";
+const std::string TimeEntrySnapshotStore::SumDurationsQuery =
+    "SELECT coalesce(sum(duration), 0) "
+    "FROM time_entries "
+    "WHERE start_time >= ?1 AND start_time < ?2 AND (?3 IS NULL OR employer_id = ?3);";
+const std::string TimeEntrySnapshotStore::SumArchivedDurationsQuery =
+    "SELECT coalesce(sum(duration), 0) "
+    "FROM {0}.time_entries "
+    "WHERE start_time >= ?1 AND start_time < ?2 AND (?3 IS NULL OR employer_id = ?3);";
+
+TimeEntrySnapshotStore::TimeEntrySnapshotStore(std::shared_ptr<Database> database,
+    const std::filesystem::path& databaseFile,
+    std::shared_ptr<spdlog::logger> logger)
+    : pDatabase(database)
+    , pArchive(nullptr)
+    , pLogger(logger)
+    , mRepository(database, logger)
+    , mDirectory(databaseFile.parent_path())
+    , mDatabaseName(databaseFile.stem().u8string())
+    , mSnapshots()
+{
+}
+
+void TimeEntrySnapshotStore::SetArchive(std::shared_ptr<TimeEntryArchive> archive)
+{
+    pArchive = archive;
+    mRepository.SetArchive(archive);
+}
+
+bool TimeEntrySnapshotStore::Open()
+{
+    Close();
+
+    std::error_code ec;
+    std::filesystem::directory_iterator directory(mDirectory, ec);
+    if (ec) {
+        pLogger->error("Failed to list snapshots in {0} - ({1})", mDirectory.u8string(), ec.message());
+        return false;
+    }
+
+    const std::string prefix = mDatabaseName + "-";
+    for (const auto& file : directory) {
+        const std::string name = file.path().filename().u8string();
+        if (name.size() != prefix.size() + 4 + SnapshotExtension.size() ||
+            name.compare(0, prefix.size(), prefix) != 0 || file.path().extension().u8string() != SnapshotExtension) {
+            continue;
+        }
+
+        const std::string yearText = name.substr(prefix.size(), 4);
+        if (!std::all_of(yearText.begin(), yearText.end(), [](unsigned char c) { return std::isdigit(c); })) {
+            continue;
+        }
+
+        const int year = std::stoi(yearText);
+        TimeEntrySnapshot snapshot;
+        if (!snapshot.Open(file.path()) || snapshot.Year() != year) {
+            pLogger->warn("Ignoring unreadable snapshot {0}", file.path().u8string());
+            continue;
+        }
+
+        mSnapshots.emplace(year, std::move(snapshot));
+    }
+
+    pLogger->info("Opened {0} time entry snapshots", mSnapshots.size());
+    return true;
+}
+
+bool TimeEntrySnapshotStore::Refresh()
+{
+    int currentYear = 0;
+    if (!GetCurrentYear(currentYear)) {
+        return false;
+    }
+
+    std::optional<int> firstYear;
+    {
+        auto stmt = pDatabase->Prepare(SelectFirstYearQuery);
+        if (!stmt || !stmt.Step()) {
+            pLogger->error("Failed to read the first year of time entries {0}", stmt.ErrorMessage());
+            return false;
+        }
+        firstYear = stmt.Column<std::optional<int>>(0);
+    }
+
+    for (int year = firstYear.value_or(currentYear); year < currentYear; year++) {
+        if (pArchive != nullptr && pArchive->IsArchived(year)) {
+            continue;
+        }
+
+        std::int64_t yearStart = 0;
+        std::int64_t yearEnd = 0;
+        SnapshotSignature signature;
+        if (!GetYearBounds(year, yearStart, yearEnd) || !GetSignature(yearStart, yearEnd, signature)) {
+            return false;
+        }
+
+        auto existing = mSnapshots.find(year);
+        if (existing != mSnapshots.end()) {
+            const SnapshotSignature& current = existing->second.Signature();
+            if (current.rowCount == signature.rowCount && current.maxTimeEntryId == signature.maxTimeEntryId &&
+                current.maxDateModified == signature.maxDateModified) {
+                continue;
+            }
+
+            // the mapping has to go before the file can be replaced
+            mSnapshots.erase(existing);
+        }
+
+        if (signature.rowCount == 0) {
+            std::error_code ec;
+            std::filesystem::remove(GetSnapshotPath(year), ec);
+            continue;
+        }
+
+        if (!WriteSnapshot(year, yearStart, yearEnd, signature)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void TimeEntrySnapshotStore::Close()
+{
+    mSnapshots.clear();
+}
+
+std::filesystem::path TimeEntrySnapshotStore::GetSnapshotPath(int year) const
+{
+    return mDirectory / std::filesystem::u8path(mDatabaseName + "-" + std::to_string(year) + SnapshotExtension);
+}
+
+bool TimeEntrySnapshotStore::SumDurations(std::int64_t from,
+    std::int64_t to,
+    std::optional<std::int64_t> employerId,
+    std::int64_t& totalDuration)
+{
+    totalDuration = 0;
+    return ForEachSegment(
+        from, to, [&](const TimeEntrySnapshot* snapshot, std::int64_t segmentFrom, std::int64_t segmentTo) {
+            std::int64_t snapshotDuration = 0;
+            if (snapshot != nullptr && snapshot->SumDurations(segmentFrom, segmentTo, employerId, snapshotDuration)) {
+                totalDuration += snapshotDuration;
+                return true;
+            }
+
+            std::int64_t liveDuration = 0;
+            if (!SumLive(segmentFrom, segmentTo, employerId, liveDuration)) {
+                return false;
+            }
+            totalDuration += liveDuration;
+            return snapshot == nullptr || RewriteSnapshot(snapshot->Year());
+        });
+}
+
+bool TimeEntrySnapshotStore::GetRange(std::int64_t from, std::int64_t to, std::vector<TimeEntry>& entries)
+{
+    return ForEachSegment(
+        from, to, [&](const TimeEntrySnapshot* snapshot, std::int64_t segmentFrom, std::int64_t segmentTo) {
+            if (snapshot != nullptr && snapshot->Read(segmentFrom, segmentTo, entries)) {
+                return true;
+            }
+
+            if (!mRepository.GetRange(segmentFrom, segmentTo, entries)) {
+                return false;
+            }
+            return snapshot == nullptr || RewriteSnapshot(snapshot->Year());
+        });
+}
+
+bool TimeEntrySnapshotStore::ForEachSegment(std::int64_t from,
+    std::int64_t to,
+    const std::function<bool(const TimeEntrySnapshot* snapshot, std::int64_t from, std::int64_t to)>& callback)
+{
+    std::int64_t cursor = from;
+    while (cursor < to) {
+        const TimeEntrySnapshot* covering = nullptr;
+        std::int64_t nextSnapshotStart = to;
+
+        for (const auto& [year, snapshot] : mSnapshots) {
+            if (snapshot.YearStart() <= cursor && cursor < snapshot.YearEnd()) {
+                covering = &snapshot;
+                break;
+            }
+            if (snapshot.YearStart() > cursor) {
+                nextSnapshotStart = std::min(nextSnapshotStart, snapshot.YearStart());
+            }
+        }
+
+        const std::int64_t segmentEnd = covering != nullptr ? std::min(to, covering->YearEnd()) : nextSnapshotStart;
+        if (!callback(covering, cursor, segmentEnd)) {
+            return false;
+        }
+        cursor = segmentEnd;
+    }
+
+    return true;
+}
+
+bool TimeEntrySnapshotStore::GetCurrentYear(int& year)
+{
+    auto stmt = pDatabase->Prepare(SelectCurrentYearQuery);
+    if (!stmt || !stmt.Step()) {
+        pLogger->error("Failed to read the current year {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    year = stmt.Column<int>(0);
+    return true;
+}
+
+bool TimeEntrySnapshotStore::GetYearBounds(int year, std::int64_t& yearStart, std::int64_t& yearEnd)
+{
+    auto stmt = pDatabase->Prepare(SelectYearBoundsQuery);
+    if (!stmt || !stmt.Bind(year) || !stmt.Step()) {
+        pLogger->error("Failed to compute the bounds of year {0} - ({1})", year, stmt.ErrorMessage());
+        return false;
+    }
+
+    yearStart = stmt.Column<std::int64_t>(0);
+    yearEnd = stmt.Column<std::int64_t>(1);
+    return true;
+}
+
+bool TimeEntrySnapshotStore::GetSignature(std::int64_t yearStart, std::int64_t yearEnd, SnapshotSignature& signature)
+{
+    auto stmt = pDatabase->Prepare(SelectSignatureQuery);
+    if (!stmt || !stmt.Bind(yearStart, yearEnd) || !stmt.Step()) {
+        pLogger->error("Failed to read the snapshot signature {0}", stmt.ErrorMessage());
+        return false;
+    }
+
+    signature = stmt.RowAs<SnapshotSignature, std::int64_t, std::int64_t, std::int64_t>();
+    return true;
+}
+
+bool TimeEntrySnapshotStore::WriteSnapshot(int year,
+    std::int64_t yearStart,
+    std::int64_t yearEnd,
+    const SnapshotSignature& signature)
+{
+    std::vector<TimeEntry> entries;
+    entries.reserve(static_cast<std::size_t>(signature.rowCount));
+    if (!mRepository.GetRange(yearStart, yearEnd, entries)) {
+        return false;
+    }
+
+    const auto file = GetSnapshotPath(year);
+    if (!TimeEntrySnapshot::Write(file, year, yearStart, yearEnd, signature, entries)) {
+        pLogger->error("Failed to write snapshot {0}", file.u8string());
+        return false;
+    }
+
+    TimeEntrySnapshot snapshot;
+    if (!snapshot.Open(file)) {
+        pLogger->error("Failed to open snapshot {0}", file.u8string());
+        return false;
+    }
+
+    pLogger->info("Wrote snapshot {0} with {1} time entries", file.u8string(), entries.size());
+    mSnapshots.emplace(year, std::move(snapshot));
+    return true;
+}
+
+bool TimeEntrySnapshotStore::RewriteSnapshot(int year)
+{
+    // the segment was already answered from SQLite, the snapshot is only replaced for the next query
+    pLogger->warn("Snapshot {0} is corrupt, rewriting it", GetSnapshotPath(year).u8string());
+    mSnapshots.erase(year);
+
+    std::int64_t yearStart = 0;
+    std::int64_t yearEnd = 0;
+    SnapshotSignature signature;
+    if (!GetYearBounds(year, yearStart, yearEnd) || !GetSignature(yearStart, yearEnd, signature)) {
+        return false;
+    }
+
+    if (signature.rowCount == 0) {
+        std::error_code ec;
+        std::filesystem::remove(GetSnapshotPath(year), ec);
+        return true;
+    }
+
+    return WriteSnapshot(year, yearStart, yearEnd, signature);
+}
+
+bool TimeEntrySnapshotStore::SumLive(std::int64_t from,
+    std::int64_t to,
+    std::optional<std::int64_t> employerId,
+    std::int64_t& totalDuration)
+{
+    totalDuration = 0;
+    auto sum = [&](const std::string& query, std::int64_t sumFrom, std::int64_t sumTo) {
+        auto stmt = pDatabase->Prepare(query);
+        if (!stmt || !stmt.Bind(sumFrom, sumTo, employerId) || !stmt.Step()) {
+            pLogger->error("Failed to sum time entries {0}", stmt.ErrorMessage());
+            return false;
+        }
+
+        totalDuration += stmt.Column<std::int64_t>(0);
+        return true;
+    };
+
+    if (pArchive == nullptr) {
+        return sum(SumDurationsQuery, from, to);
+    }
+
+    return pArchive->ForEachSource(
+        from, to, [&](const std::string& schema, std::int64_t sourceFrom, std::int64_t sourceTo) {
+            const std::string query =
+                schema == "main" ? SumDurationsQuery : fmt::format(SumArchivedDurationsQuery, schema);
+            return sum(query, sourceFrom, sourceTo);
+        });
+}
+} // namespace app::Core
@@ -0,0 +1,113 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "time_entry_repository.h"
+#include "time_entry_snapshot.h"
+
+namespace app::Core
+{
+class Database;
+class TimeEntryArchive;
+
+// Serves time entry reports from the snapshot files of closed years and from SQLite for everything else.
+//
+// Snapshots are named <database name>-<year>.snapshot and sit next to the database file. Years follow local time,
+// the same as the daily totals. Open only maps the snapshots that exist. Refresh (re)writes the snapshots of closed
+// years that are missing or no longer match their rows, which reads those rows and is the expensive part.
+class TimeEntrySnapshotStore final
+{
+public:
+    TimeEntrySnapshotStore(std::shared_ptr<Database> database,
+        const std::filesystem::path& databaseFile,
+        std::shared_ptr<spdlog::logger> logger);
+    TimeEntrySnapshotStore(const TimeEntrySnapshotStore&) = delete;
+    ~TimeEntrySnapshotStore() = default;
+
+    TimeEntrySnapshotStore& operator=(const TimeEntrySnapshotStore&) = delete;
+
+    // Serves the years that have no snapshot from their archive files. Archived rows never change, so Refresh
+    // leaves the snapshots of archived years alone.
+    void SetArchive(std::shared_ptr<TimeEntryArchive> archive);
+
+    bool Open();
+    bool Refresh();
+    void Close();
+
+    std::filesystem::path GetSnapshotPath(int year) const;
+
+    // Sums the durations of the entries starting in [from, to), optionally for one employer.
+    // A snapshot that turns out to be corrupt is answered from SQLite instead and rewritten.
+    bool SumDurations(std::int64_t from,
+        std::int64_t to,
+        std::optional<std::int64_t> employerId,
+        std::int64_t& totalDuration);
+
+    // Reads the entries starting in [from, to) ordered by start time.
+    // Entries served from a snapshot have empty descriptions.
+    bool GetRange(std::int64_t from, std::int64_t to, std::vector<TimeEntry>& entries);
+
+private:
+    // Splits [from, to) into consecutive pieces that are either covered by one snapshot or have to come from
+    // SQLite (snapshot is null), and stops at the first piece the callback fails
+    bool ForEachSegment(std::int64_t from,
+        std::int64_t to,
+        const std::function<bool(const TimeEntrySnapshot* snapshot, std::int64_t from, std::int64_t to)>& callback);
+
+    bool GetCurrentYear(int& year);
+    bool GetYearBounds(int year, std::int64_t& yearStart, std::int64_t& yearEnd);
+    bool GetSignature(std::int64_t yearStart, std::int64_t yearEnd, SnapshotSignature& signature);
+    bool WriteSnapshot(int year, std::int64_t yearStart, std::int64_t yearEnd, const SnapshotSignature& signature);
+
+    // Replaces a snapshot that failed to decode, the callers have already answered from SQLite
+    bool RewriteSnapshot(int year);
+
+    bool SumLive(std::int64_t from,
+        std::int64_t to,
+        std::optional<std::int64_t> employerId,
+        std::int64_t& totalDuration);
+
+    std::shared_ptr<Database> pDatabase;
+    std::shared_ptr<TimeEntryArchive> pArchive;
+    std::shared_ptr<spdlog::logger> pLogger;
+    TimeEntryRepository mRepository;
+    std::filesystem::path mDirectory;
+    std::string mDatabaseName;
+    std::map<int, TimeEntrySnapshot> mSnapshots;
+
+    static const std::string SelectCurrentYearQuery;
+    static const std::string SelectYearBoundsQuery;
+    static const std::string SelectFirstYearQuery;
+    static const std::string SelectSignatureQuery;
+    static const std::string SumDurationsQuery;
+    static const std::string SumArchivedDurationsQuery;
+};
+} // namespace app::Core
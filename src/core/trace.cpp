@@ -0,0 +1,156 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "trace.h"
+
+#ifdef TKS_TRACE
+
+#include <algorithm>
+#include <fstream>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/fmt/fmt.h>
+
+namespace app::Core
+{
+TraceBuffer::TraceBuffer(std::uint32_t threadId)
+    : mThreadId(threadId)
+    , pThreadName(nullptr)
+    , mCount(0)
+    , mSlots()
+{
+}
+
+void TraceBuffer::SetThreadName(const char* name)
+{
+    pThreadName.store(name, std::memory_order_release);
+}
+
+const char* TraceBuffer::GetThreadName() const
+{
+    return pThreadName.load(std::memory_order_acquire);
+}
+
+std::uint32_t TraceBuffer::GetThreadId() const
+{
+    return mThreadId;
+}
+
+void TraceBuffer::Collect(std::vector<TraceEvent>& events) const
+{
+    const std::size_t end = mCount.load(std::memory_order_acquire);
+    const std::size_t begin = end > Capacity ? end - Capacity : 0;
+    const std::size_t first = events.size();
+
+    for (std::size_t index = begin; index < end; index++) {
+        const Slot& slot = mSlots[index & (Capacity - 1)];
+        events.push_back(TraceEvent{ slot.name.load(std::memory_order_relaxed),
+            mThreadId,
+            slot.start.load(std::memory_order_relaxed),
+            slot.duration.load(std::memory_order_relaxed) });
+    }
+
+    // the owner may have kept recording during the copy. Event n is written only after event n - 1 was
+    // published, so anything the copy could have seen half written sits below the published count minus the
+    // capacity.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const std::size_t published = mCount.load(std::memory_order_relaxed);
+    const std::size_t firstIntact = published >= Capacity ? published - Capacity + 1 : 0;
+    if (firstIntact > begin) {
+        const std::size_t overwritten = std::min(firstIntact - begin, end - begin);
+        events.erase(events.begin() + static_cast<std::ptrdiff_t>(first),
+            events.begin() + static_cast<std::ptrdiff_t>(first + overwritten));
+    }
+}
+
+Tracer& Tracer::GetInstance()
+{
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::Tracer()
+    : mMutex()
+    , mBuffers()
+    , mStart(Now())
+{
+}
+
+void Tracer::SetThreadName(const char* name)
+{
+    GetThreadBuffer().SetThreadName(name);
+}
+
+TraceBuffer* Tracer::RegisterThread()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBuffers.push_back(std::make_unique<TraceBuffer>(static_cast<std::uint32_t>(mBuffers.size() + 1)));
+    return mBuffers.back().get();
+}
+
+bool Tracer::WriteJson(const std::filesystem::path& file, std::shared_ptr<spdlog::logger> logger)
+{
+    std::vector<TraceEvent> events;
+    std::vector<std::pair<std::uint32_t, const char*>> threadNames;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto& buffer : mBuffers) {
+            buffer->Collect(events);
+            if (const char* name = buffer->GetThreadName()) {
+                threadNames.emplace_back(buffer->GetThreadId(), name);
+            }
+        }
+    }
+
+    std::ofstream output(file, std::ios::out | std::ios::trunc | std::ios::binary);
+    output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool isFirst = true;
+    for (const auto& [threadId, name] : threadNames) {
+        output << fmt::format("{0}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{1},"
+                              "\"args\":{{\"name\":{2}}}}}",
+            isFirst ? "" : ",\n",
+            threadId,
+            nlohmann::json(name).dump());
+        isFirst = false;
+    }
+
+    // timestamps are microseconds since the tracer was created
+    for (const auto& event : events) {
+        output << fmt::format("{0}{{\"name\":{1},\"ph\":\"X\",\"pid\":1,\"tid\":{2},\"ts\":{3:.3f},\"dur\":{4:.3f}}}",
+            isFirst ? "" : ",\n",
+            nlohmann::json(event.name).dump(),
+            event.threadId,
+            static_cast<double>(event.start - mStart) / 1000.0,
+            static_cast<double>(event.duration) / 1000.0);
+        isFirst = false;
+    }
+
+    output << "\n]}\n";
+    if (!output) {
+        logger->error("Failed to write trace to {0}", file.u8string());
+        return false;
+    }
+
+    logger->info("Wrote {0} trace events to {1}", events.size(), file.u8string());
+    return true;
+}
+} // namespace app::Core
+
+#endif // TKS_TRACE
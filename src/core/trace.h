@@ -0,0 +1,169 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+// TKS_TRACE_SCOPE("area/operation") records how long the enclosing scope took, on the calling thread, as a Chrome
+// trace event. Names must be string literals, only the pointer is stored. Tracing is built in with the
+// TASKIES_ENABLE_TRACING CMake option (which defines TKS_TRACE), otherwise the macros expand to nothing.
+
+#ifdef TKS_TRACE
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#define TKS_TRACE_CONCAT_INNER(a, b) a##b
+#define TKS_TRACE_CONCAT(a, b) TKS_TRACE_CONCAT_INNER(a, b)
+#define TKS_TRACE_SCOPE(name) const ::app::Core::TraceScope TKS_TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TKS_TRACE_THREAD_NAME(name) ::app::Core::Tracer::GetInstance().SetThreadName(name)
+
+namespace app::Core
+{
+struct TraceEvent {
+    const char* name;
+    std::uint32_t threadId;
+    std::int64_t start;
+    std::int64_t duration;
+};
+
+// Ring of the most recent events of one thread. Only the owning thread writes, so recording takes no lock; a
+// reader copies the ring and drops any slot the owner may have overwritten while it was copying.
+class TraceBuffer final
+{
+public:
+    static constexpr std::size_t Capacity = 1 << 15;
+
+    explicit TraceBuffer(std::uint32_t threadId);
+    TraceBuffer(const TraceBuffer&) = delete;
+    ~TraceBuffer() = default;
+
+    TraceBuffer& operator=(const TraceBuffer&) = delete;
+
+    void Record(const char* name, std::int64_t start, std::int64_t duration)
+    {
+        const std::size_t index = mCount.load(std::memory_order_relaxed);
+        // keeps the slot writes after the publication of the previous event, see Collect
+        std::atomic_thread_fence(std::memory_order_release);
+
+        Slot& slot = mSlots[index & (Capacity - 1)];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start.store(start, std::memory_order_relaxed);
+        slot.duration.store(duration, std::memory_order_relaxed);
+        mCount.store(index + 1, std::memory_order_release);
+    }
+
+    void SetThreadName(const char* name);
+    const char* GetThreadName() const;
+    std::uint32_t GetThreadId() const;
+
+    void Collect(std::vector<TraceEvent>& events) const;
+
+private:
+    struct Slot {
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<std::int64_t> start{ 0 };
+        std::atomic<std::int64_t> duration{ 0 };
+    };
+
+    std::uint32_t mThreadId;
+    std::atomic<const char*> pThreadName;
+    std::atomic<std::size_t> mCount;
+    std::array<Slot, Capacity> mSlots;
+};
+
+class Tracer final
+{
+public:
+    static Tracer& GetInstance();
+
+    Tracer(const Tracer&) = delete;
+
+    Tracer& operator=(const Tracer&) = delete;
+
+    TraceBuffer& GetThreadBuffer()
+    {
+        thread_local TraceBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            buffer = RegisterThread();
+        }
+        return *buffer;
+    }
+
+    void SetThreadName(const char* name);
+
+    // Writes the buffered events of every thread in Chrome trace_event format, for chrome://tracing or Perfetto
+    bool WriteJson(const std::filesystem::path& file, std::shared_ptr<spdlog::logger> logger);
+
+    static std::int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+private:
+    Tracer();
+
+    TraceBuffer* RegisterThread();
+
+    std::mutex mMutex;
+    // buffers outlive their threads, so events of finished threads still make it into the dump
+    std::vector<std::unique_ptr<TraceBuffer>> mBuffers;
+    std::int64_t mStart;
+};
+
+class TraceScope final
+{
+public:
+    explicit TraceScope(const char* name)
+        : pName(name)
+        , mStart(Tracer::Now())
+    {
+    }
+    TraceScope(const TraceScope&) = delete;
+
+    ~TraceScope()
+    {
+        const std::int64_t end = Tracer::Now();
+        Tracer::GetInstance().GetThreadBuffer().Record(pName, mStart, end - mStart);
+    }
+
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* pName;
+    std::int64_t mStart;
+};
+} // namespace app::Core
+
+#else
+
+#define TKS_TRACE_SCOPE(name) ((void)0)
+#define TKS_TRACE_THREAD_NAME(name) ((void)0)
+
+#endif // TKS_TRACE
@@ -0,0 +1,106 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#include "diagnosticsdialog.h"
+
+#include <filesystem>
+
+#include "../common/common.h"
+#include "../core/metrics.h"
+
+namespace app::UI
+{
+// clang-format off
+wxBEGIN_EVENT_TABLE(DiagnosticsDialog, wxDialog)
+EVT_BUTTON(DiagnosticsDialog::IDC_REFRESH, DiagnosticsDialog::OnRefresh)
+EVT_BUTTON(DiagnosticsDialog::IDC_SAVE, DiagnosticsDialog::OnSave)
+wxEND_EVENT_TABLE()
+
+DiagnosticsDialog::DiagnosticsDialog(wxWindow* parent, std::shared_ptr<spdlog::logger> logger, const wxString& name)
+    : wxDialog(parent,
+          wxID_ANY,
+          "Diagnostics",
+          wxDefaultPosition,
+          wxDefaultSize,
+          wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER,
+          name)
+    , pLogger(logger)
+    , pMetricsText(nullptr)
+// clang-format on
+{
+    CreateControls();
+    RefreshMetrics();
+
+    SetSize(FromDIP(wxSize(760, 520)));
+    CentreOnParent();
+}
+
+void DiagnosticsDialog::SaveMetrics(wxWindow* parent, std::shared_ptr<spdlog::logger> logger)
+{
+    wxFileDialog saveDialog(parent,
+        "Save metrics",
+        wxEmptyString,
+        "taskies-metrics.json",
+        "JSON files (*.json)|*.json",
+        wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (saveDialog.ShowModal() != wxID_OK) {
+        return;
+    }
+
+    const std::filesystem::path file(saveDialog.GetPath().ToStdWstring());
+    if (!Core::MetricsRegistry::GetInstance().WriteJson(file, logger)) {
+        wxMessageBox("Failed to save the metrics", Common::GetProgramName(), wxICON_ERROR | wxOK_DEFAULT, parent);
+    }
+}
+
+void DiagnosticsDialog::CreateControls()
+{
+    auto mainSizer = new wxBoxSizer(wxVERTICAL);
+
+    pMetricsText = new wxTextCtrl(
+        this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY | wxHSCROLL);
+    pMetricsText->SetFont(wxFont(wxFontInfo(9).Family(wxFONTFAMILY_TELETYPE)));
+    mainSizer->Add(pMetricsText, wxSizerFlags(1).Expand().Border(wxALL, FromDIP(5)));
+
+    auto buttonSizer = new wxBoxSizer(wxHORIZONTAL);
+    buttonSizer->Add(new wxButton(this, IDC_REFRESH, "Refresh"), wxSizerFlags().Border(wxALL, FromDIP(5)));
+    buttonSizer->Add(new wxButton(this, IDC_SAVE, "Save as JSON..."), wxSizerFlags().Border(wxALL, FromDIP(5)));
+    buttonSizer->AddStretchSpacer();
+    buttonSizer->Add(new wxButton(this, wxID_CLOSE, "Close"), wxSizerFlags().Border(wxALL, FromDIP(5)));
+    mainSizer->Add(buttonSizer, wxSizerFlags().Expand());
+
+    SetEscapeId(wxID_CLOSE);
+    SetSizer(mainSizer);
+}
+
+void DiagnosticsDialog::RefreshMetrics()
+{
+    pMetricsText->SetValue(wxString::FromUTF8(Core::MetricsRegistry::GetInstance().Format()));
+}
+
+void DiagnosticsDialog::OnRefresh(wxCommandEvent& WXUNUSED(event))
+{
+    RefreshMetrics();
+}
+
+void DiagnosticsDialog::OnSave(wxCommandEvent& WXUNUSED(event))
+{
+    SaveMetrics(this, pLogger);
+}
+} // namespace app::UI
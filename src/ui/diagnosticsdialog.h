@@ -0,0 +1,57 @@
+// Productivity tool to help you track the time you spend on tasks
+// Copyright (C) 2022 spw32
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact:
+//     spw32 at proton dot me
+
+#pragma once
+
+#include <memory>
+
+#include <wx/wxprec.h>
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+namespace app::UI
+{
+// Shows the process metrics as a table and saves them as JSON for attaching to bug reports
+class DiagnosticsDialog final : public wxDialog
+{
+public:
+    DiagnosticsDialog(wxWindow* parent, std::shared_ptr<spdlog::logger> logger, const wxString& name = "diagdlg");
+    virtual ~DiagnosticsDialog() = default;
+
+    // Asks for a file name and writes the metrics there, shared with the main frame menu
+    static void SaveMetrics(wxWindow* parent, std::shared_ptr<spdlog::logger> logger);
+
+private:
+    wxDECLARE_EVENT_TABLE();
+
+    void CreateControls();
+    void RefreshMetrics();
+
+    void OnRefresh(wxCommandEvent& event);
+    void OnSave(wxCommandEvent& event);
+
+    std::shared_ptr<spdlog::logger> pLogger;
+    wxTextCtrl* pMetricsText;
+
+    enum { IDC_REFRESH = wxID_HIGHEST + 1, IDC_SAVE };
+};
+} // namespace app::UI
@@ -24,17 +24,23 @@
 #include "../common/common.h"
 #include "../core/environment.h"
 #include "../core/configuration.h"
+#include "diagnosticsdialog.h"
 
 namespace app::UI
 {
 // clang-format off
 wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
+EVT_MENU(static_cast<int>(MenuIds::Help_Diagnostics), MainFrame::OnDiagnostics)
+EVT_MENU(static_cast<int>(MenuIds::Help_SaveMetrics), MainFrame::OnSaveMetrics)
 wxEND_EVENT_TABLE()
 
 MainFrame::MainFrame(std::shared_ptr<Core::Environment> env,
     std::shared_ptr<Core::Configuration> cfg,
     std::shared_ptr<spdlog::logger> logger,
     const wxString& name)
+    : pLogger(logger)
+    , pEnv(env)
+    , pCfg(cfg)
 // clang-format on
 {
     if (!wxPersistenceManager::Get().RegisterAndRestore(this)) {
@@ -60,9 +66,17 @@ void MainFrame::CreateControls() {
 
     auto exitMenuItem = fileMenu->Append(wxID_EXIT, "Exit", "Exit the program");
 
+    /* Help */
+    auto helpMenu = new wxMenu();
+    helpMenu->Append(static_cast<int>(MenuIds::Help_Diagnostics), "Diagnostics...", "Show performance metrics");
+    helpMenu->Append(static_cast<int>(MenuIds::Help_SaveMetrics),
+        "Save Metrics as JSON...",
+        "Save performance metrics to attach to a bug report");
+
     /* Menu bar */
     auto menuBar = new wxMenuBar();
     menuBar->Append(fileMenu, "File");
+    menuBar->Append(helpMenu, "Help");
 
     SetMenuBar(menuBar);
 
@@ -74,4 +88,15 @@ void MainFrame::CreateControls() {
     auto starterLabel = new wxStaticText(mainPanel, wxID_ANY, "wxWidgets Quick Starter");
     mainSizer->Add(starterLabel, wxSizerFlags().Center());
 }
+
+void MainFrame::OnDiagnostics(wxCommandEvent& WXUNUSED(event))
+{
+    DiagnosticsDialog diagnostics(this, pLogger);
+    diagnostics.ShowModal();
+}
+
+void MainFrame::OnSaveMetrics(wxCommandEvent& WXUNUSED(event))
+{
+    DiagnosticsDialog::SaveMetrics(this, pLogger);
+}
 } // namespace app::UI
@@ -29,7 +29,8 @@
 namespace app
 {
 enum class MenuIds : int {
-
+    Help_Diagnostics = wxID_HIGHEST + 100,
+    Help_SaveMetrics,
 };
 
 namespace Core
@@ -56,6 +57,9 @@ class MainFrame : public wxFrame
 
     void CreateControls();
 
+    void OnDiagnostics(wxCommandEvent& event);
+    void OnSaveMetrics(wxCommandEvent& event);
+
     std::shared_ptr<spdlog::logger> pLogger;
     std::shared_ptr<Core::Environment> pEnv;
     std::shared_ptr<Core::Configuration> pCfg;
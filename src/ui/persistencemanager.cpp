@@ -19,191 +19,239 @@
 
 #include "persistencemanager.h"
 
-#include "../core/environment.h"
+#include "../core/database.h"
+#include "../core/database_worker.h"
+#include "../core/metrics.h"
+#include "../core/trace.h"
 
 namespace app::UI
 {
-const std::string PersistenceManager::PersistenceSelectQuery = "SELECT value FROM persistent_objects WHERE key = ?;";
-const std::string PersistenceManager::PersistenceInsertQuery =
-    "INSERT OR REPLACE INTO persistent_objects(key, value) VALUES(?, ?);";
-
-PersistenceManager::PersistenceManager(std::shared_ptr<Core::Environment> env, std::shared_ptr<spdlog::logger> logger)
-    : pEnv(env)
+const int PersistenceManager::FlushDelayMilliseconds = 2000;
+
+PersistenceManager::PersistenceManager(std::shared_ptr<Core::DatabaseWorker> databaseWorker,
+    std::shared_ptr<spdlog::logger> logger)
+    : bLoaded(false)
+    , mValues()
+    , mDirtyKeys()
+    , mFlushTimer()
+    , pDatabaseWorker(databaseWorker)
     , pLogger(logger)
-    , pDb(nullptr)
 {
-    auto databaseFile = pEnv->GetDatabasePath().string();
-    int rc = sqlite3_open(databaseFile.c_str(), &pDb);
-    if (rc == SQLITE_ERROR) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to open database {0}", std::string(err));
-    }
+    mFlushTimer.Bind(wxEVT_TIMER, &PersistenceManager::OnFlushTimer, this);
 }
 
 PersistenceManager::~PersistenceManager()
 {
-    sqlite3_close(pDb);
+    mFlushTimer.Stop();
+    Flush();
 }
 
-bool PersistenceManager::RestoreValue(const wxPersistentObject& who, const wxString& name, bool* value)
+void PersistenceManager::Load(std::function<void(bool)> onLoaded)
 {
-    sqlite3_stmt* stmt = nullptr;
+    auto logger = pLogger;
+    pDatabaseWorker->Submit(
+        [logger](std::shared_ptr<Core::Database> database) {
+            auto values = std::make_shared<StoredValues>();
+            const bool read = Core::PersistentObjectRepository(database, logger).ReadAll(*values);
+            return std::make_pair(read, values);
+        },
+        [this, onLoaded](std::pair<bool, std::shared_ptr<StoredValues>> result) {
+            TKS_TRACE_SCOPE("persistence/apply_loaded");
+            for (auto& [key, stored] : *result.second) {
+                Value value;
+                if (auto text = std::get_if<std::string>(&stored)) {
+                    value = wxString::FromUTF8(text->data(), text->size());
+                } else if (auto number = std::get_if<long>(&stored)) {
+                    value = *number;
+                } else {
+                    value = std::get<bool>(stored);
+                }
+
+                // anything saved while the load was in flight is newer than what was read
+                mValues.emplace(std::move(key), std::move(value));
+            }
+
+            bLoaded = true;
+            auto& storedValues = Core::MetricsRegistry::GetInstance().GetGauge("persistence.values");
+            storedValues.Set(static_cast<std::int64_t>(mValues.size()));
+            onLoaded(result.first);
+        });
+}
 
-    bool ret = ReadValue(who, name, stmt);
+void PersistenceManager::Flush()
+{
+    TKS_TRACE_SCOPE("persistence/flush");
+    mFlushTimer.Stop();
 
-    if (ret) {
-        *value = (sqlite3_column_int(stmt, 0) > 0);
+    if (mDirtyKeys.empty()) {
+        return;
     }
-    sqlite3_finalize(stmt);
-    return ret;
+
+    auto values = std::make_shared<StoredValues>();
+    values->reserve(mDirtyKeys.size());
+    for (const auto& key : mDirtyKeys) {
+        const Value& value = mValues.at(key);
+        if (auto text = std::get_if<wxString>(&value)) {
+            values->emplace_back(key, text->ToStdString(wxConvUTF8));
+        } else if (auto number = std::get_if<long>(&value)) {
+            values->emplace_back(key, *number);
+        } else {
+            values->emplace_back(key, std::get<bool>(value));
+        }
+    }
+    mDirtyKeys.clear();
+    Core::MetricsRegistry::GetInstance().GetGauge("persistence.dirty_keys").Set(0);
+
+    auto logger = pLogger;
+    pDatabaseWorker->Submit(
+        [logger, values](std::shared_ptr<Core::Database> database) {
+            return Core::PersistentObjectRepository(database, logger).Write(*values);
+        },
+        [this, values](bool written) {
+            if (written) {
+                return;
+            }
+
+            // the newest value of each key is still in memory, write them again with the next flush
+            for (const auto& stored : *values) {
+                mDirtyKeys.insert(stored.first);
+            }
+            mFlushTimer.StartOnce(FlushDelayMilliseconds);
+        });
 }
 
-bool PersistenceManager::RestoreValue(const wxPersistentObject& who, const wxString& name, int* value)
+bool PersistenceManager::RestoreValue(const wxPersistentObject& who, const wxString& name, bool* value)
 {
-    sqlite3_stmt* stmt = nullptr;
+    long number = 0;
+    if (!RestoreValue(who, name, &number)) {
+        return false;
+    }
 
-    bool ret = ReadValue(who, name, stmt);
+    *value = number != 0;
+    return true;
+}
 
-    if (ret) {
-        *value = sqlite3_column_int(stmt, 0);
+bool PersistenceManager::RestoreValue(const wxPersistentObject& who, const wxString& name, int* value)
+{
+    long number = 0;
+    if (!RestoreValue(who, name, &number)) {
+        return false;
     }
-    sqlite3_finalize(stmt);
-    return ret;
+
+    *value = static_cast<int>(number);
+    return true;
 }
 
 bool PersistenceManager::RestoreValue(const wxPersistentObject& who, const wxString& name, long* value)
 {
-    sqlite3_stmt* stmt = nullptr;
+    Value* stored = FindValue(who, name);
+    if (stored == nullptr) {
+        return false;
+    }
 
-    bool ret = ReadValue(who, name, stmt);
+    if (auto text = std::get_if<wxString>(stored)) {
+        // values written before native storage are text, convert them once
+        long number = 0;
+        if (!text->ToLong(&number)) {
+            return false;
+        }
+        *stored = number;
+    }
 
-    if (ret) {
-        *value = static_cast<long>(sqlite3_column_int(stmt, 0));
+    if (auto flag = std::get_if<bool>(stored)) {
+        *value = *flag ? 1 : 0;
+    } else {
+        *value = std::get<long>(*stored);
     }
-    sqlite3_finalize(stmt);
-    return ret;
+    return true;
 }
 
 bool PersistenceManager::RestoreValue(const wxPersistentObject& who, const wxString& name, wxString* value)
 {
-    sqlite3_stmt* stmt = nullptr;
-
-    bool ret = ReadValue(who, name, stmt);
+    Value* stored = FindValue(who, name);
+    if (stored == nullptr) {
+        return false;
+    }
 
-    if (ret) {
-        const unsigned char* res = sqlite3_column_text(stmt, 0);
-        *value = std::string(reinterpret_cast<const char*>(res), sqlite3_column_bytes(stmt, 0));
+    if (auto text = std::get_if<wxString>(stored)) {
+        *value = *text;
+    } else if (auto flag = std::get_if<bool>(stored)) {
+        *value = *flag ? "1" : "0";
+    } else {
+        *value = wxString::Format("%ld", std::get<long>(*stored));
     }
-    sqlite3_finalize(stmt);
-    return ret;
+    return true;
 }
 
 bool PersistenceManager::SaveValue(const wxPersistentObject& who, const wxString& name, bool value)
 {
-    SaveValue(GetKey(who, name), std::to_string(value));
+    StoreValue(GetKey(who, name), value);
     return true;
 }
 
 bool PersistenceManager::SaveValue(const wxPersistentObject& who, const wxString& name, int value)
 {
-    SaveValue(GetKey(who, name), std::to_string(value));
+    StoreValue(GetKey(who, name), static_cast<long>(value));
     return true;
 }
 
 bool PersistenceManager::SaveValue(const wxPersistentObject& who, const wxString& name, long value)
 {
-    SaveValue(GetKey(who, name), std::to_string(value));
+    StoreValue(GetKey(who, name), value);
     return true;
 }
 
 bool PersistenceManager::SaveValue(const wxPersistentObject& who, const wxString& name, wxString value)
 {
-    SaveValue(GetKey(who, name), value.ToStdString());
+    StoreValue(GetKey(who, name), std::move(value));
     return true;
 }
 
-bool PersistenceManager::ReadValue(const wxPersistentObject& who, const wxString& name, sqlite3_stmt* stmt)
+PersistenceManager::Value* PersistenceManager::FindValue(const wxPersistentObject& who, const wxString& name)
 {
-    int rc = sqlite3_prepare_v2(pDb, PersistenceSelectQuery.c_str(), -1, &stmt, nullptr);
-    if (rc == SQLITE_ERROR) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return false;
-    }
-
-    auto key = GetKey(who, name).ToStdString();
-
-    rc = sqlite3_bind_text(stmt, 1, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
-    if (rc == SQLITE_ERROR) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return false;
-    }
+    static auto& hits = Core::MetricsRegistry::GetInstance().GetCounter("persistence.restore.hits");
+    static auto& misses = Core::MetricsRegistry::GetInstance().GetCounter("persistence.restore.misses");
 
-    rc = sqlite3_step(stmt);
-    if (rc == SQLITE_ERROR) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Error when executing statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return false;
+    if (!bLoaded) {
+        misses.Add();
+        return nullptr;
     }
 
-    if (rc != SQLITE_DONE) {
-        pLogger->error("Error! Result returned more than result, but expected one");
-        return false;
+    auto value = mValues.find(GetKey(who, name));
+    if (value == mValues.end()) {
+        misses.Add();
+        return nullptr;
     }
 
-    return true;
+    hits.Add();
+    return &value->second;
 }
 
-wxString PersistenceManager::GetKey(const wxPersistentObject& who, const wxString& name)
+std::string PersistenceManager::GetKey(const wxPersistentObject& who, const wxString& name)
 {
-    return who.GetKind() << wxCONFIG_PATH_SEPARATOR << who.GetName() << wxCONFIG_PATH_SEPARATOR << name;
+    wxString key = who.GetKind() << wxCONFIG_PATH_SEPARATOR << who.GetName() << wxCONFIG_PATH_SEPARATOR << name;
+    return key.ToStdString(wxConvUTF8);
 }
 
-void PersistenceManager::SaveValue(const wxString& key, const std::string& value)
+void PersistenceManager::StoreValue(std::string key, Value value)
 {
-    sqlite3_stmt* stmt = nullptr;
-
-    int rc = sqlite3_prepare_v2(pDb, PersistenceSelectQuery.c_str(), -1, &stmt, nullptr);
-    if (rc == SQLITE_ERROR) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return;
-    }
-
-    rc = sqlite3_bind_text(
-        stmt, 1, key.ToStdString().c_str(), static_cast<int>(key.ToStdString().size()), SQLITE_TRANSIENT);
-    if (rc == SQLITE_ERROR) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return;
-    }
+    static auto& saves = Core::MetricsRegistry::GetInstance().GetCounter("persistence.saves");
+    static auto& dirtyKeys = Core::MetricsRegistry::GetInstance().GetGauge("persistence.dirty_keys");
 
-    rc = sqlite3_bind_text(
-        stmt, 2, value.c_str(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
-    if (rc == SQLITE_ERROR) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Failed to prepare statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return;
-    }
+    // repeated saves to the same key only update the pending value
+    mDirtyKeys.insert(key);
+    mValues.insert_or_assign(std::move(key), std::move(value));
+    saves.Add();
+    dirtyKeys.Set(static_cast<std::int64_t>(mDirtyKeys.size()));
 
-    rc = sqlite3_step(stmt);
-    if (rc == SQLITE_ERROR) {
-        const char* err = sqlite3_errmsg(pDb);
-        pLogger->error("Error when executing statement {0}", std::string(err));
-        sqlite3_finalize(stmt);
-        return;
+    if (!mFlushTimer.IsRunning()) {
+        mFlushTimer.StartOnce(FlushDelayMilliseconds);
     }
+}
 
-    if (rc != SQLITE_DONE) {
-        pLogger->error("Error! Result returned more than result, but expected one");
-        return;
-    }
+void PersistenceManager::OnFlushTimer(wxTimerEvent& WXUNUSED(event))
+{
+    TKS_TRACE_SCOPE("ui/flush_timer");
+    Flush();
 }
 } // namespace app::UI
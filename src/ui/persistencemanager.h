@@ -19,7 +19,14 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include <wx/wxprec.h>
 #ifndef WX_PRECOMP
@@ -27,23 +34,33 @@
 #endif
 
 #include <wx/persist.h>
-#include <sqlite3.h>
+#include <wx/timer.h>
 #include <spdlog/spdlog.h>
 
+#include "../core/persistent_object_repository.h"
+
 namespace app
 {
 namespace Core
 {
-class Environment;
+class Database;
+class DatabaseWorker;
 } // namespace Core
 namespace UI
 {
 class PersistenceManager : public wxPersistenceManager
 {
 public:
-    PersistenceManager(std::shared_ptr<Core::Environment> env, std::shared_ptr<spdlog::logger> logger);
+    PersistenceManager(std::shared_ptr<Core::DatabaseWorker> databaseWorker, std::shared_ptr<spdlog::logger> logger);
     virtual ~PersistenceManager();
 
+    // Reads every persisted value into memory on the database worker so restores do not touch the database.
+    // Restores find nothing until the values arrive, onLoaded is then called on the UI thread.
+    void Load(std::function<void(bool)> onLoaded);
+
+    // Hands all values saved since the last flush to the database worker, which writes them in one transaction
+    void Flush();
+
     bool RestoreValue(const wxPersistentObject& who, const wxString& name, bool* value) override;
     bool RestoreValue(const wxPersistentObject& who, const wxString& name, int* value) override;
     bool RestoreValue(const wxPersistentObject& who, const wxString& name, long* value) override;
@@ -55,16 +72,25 @@ class PersistenceManager : public wxPersistenceManager
     bool SaveValue(const wxPersistentObject& who, const wxString& name, wxString value) override;
 
 private:
-    bool ReadValue(const wxPersistentObject& who, const wxString& name, sqlite3_stmt* stmt);
-    wxString GetKey(const wxPersistentObject& who, const wxString& name);
-    void SaveValue(const wxString& key, const std::string& value);
+    using Value = std::variant<bool, long, wxString>;
+
+    // wxString stays on the UI thread, the worker only sees UTF-8
+    using StoredValues = Core::PersistentValues;
+
+    Value* FindValue(const wxPersistentObject& who, const wxString& name);
+    std::string GetKey(const wxPersistentObject& who, const wxString& name);
+    void StoreValue(std::string key, Value value);
+
+    void OnFlushTimer(wxTimerEvent& event);
 
-    sqlite3* pDb;
-    std::shared_ptr<Core::Environment> pEnv;
+    bool bLoaded;
+    std::unordered_map<std::string, Value> mValues;
+    std::unordered_set<std::string> mDirtyKeys;
+    wxTimer mFlushTimer;
+    std::shared_ptr<Core::DatabaseWorker> pDatabaseWorker;
     std::shared_ptr<spdlog::logger> pLogger;
 
-    static const std::string PersistenceSelectQuery;
-    static const std::string PersistenceInsertQuery;
+    static const int FlushDelayMilliseconds;
 };
 } // namespace UI
 } // namespace app
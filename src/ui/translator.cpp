@@ -25,6 +25,9 @@
 
 #include <nlohmann/json.hpp>
 
+#include "../core/metrics.h"
+#include "../core/trace.h"
+
 namespace app::UI
 {
 
@@ -36,8 +39,15 @@ Translator& Translator::GetInstance()
     return instance;
 }
 
+Translator::Translator()
+    : mLocale()
+    , mLanguages()
+{
+}
+
 bool Translator::Load(const std::string& locale, const std::filesystem::path& langPath)
 {
+    TKS_TRACE_SCOPE("translation/load");
     mLocale = locale;
 
     if (!std::filesystem::exists(langPath)) {
@@ -83,6 +93,11 @@ bool Translator::Load(const std::string& locale, const std::filesystem::path& la
 
 std::string Translator::Translate(const std::string& key)
 {
+    static auto& lookups = Core::MetricsRegistry::GetInstance().GetCounter("translation.lookups");
+    static auto& fallbacks = Core::MetricsRegistry::GetInstance().GetCounter("translation.fallbacks");
+    static auto& misses = Core::MetricsRegistry::GetInstance().GetCounter("translation.misses");
+    lookups.Add();
+
     // find language we have selected
     auto lang = mLanguages.find(mLocale);
     if (lang == mLanguages.end()) {
@@ -91,6 +106,7 @@ std::string Translator::Translate(const std::string& key)
 
     // could not find default language, just return key
     if (lang == mLanguages.end()) {
+        misses.Add();
         return key;
     }
 
@@ -99,14 +115,17 @@ std::string Translator::Translate(const std::string& key)
     if (translation == lang->second.translations.end()) { // could not find translation, default to en-US
         auto english = mLanguages.find(DefaultLanguage);
         if (english == mLanguages.end()) {
+            misses.Add();
             return key;
         }
 
         auto englishTranslation = english->second.translations.find(key);
         if (englishTranslation == english->second.translations.end()) {
+            misses.Add();
             return key;
         }
 
+        fallbacks.Add();
         return englishTranslation->second;
     } else {
         return translation->second;
@@ -50,9 +50,8 @@ std::int64_t UnixTimestamp()
 
 std::string ToISODateTime(std::int64_t unixTimestamp)
 {
-    auto now = std::chrono::system_clock::now();
-    auto date = date::format("%F %T", date::floor<std::chrono::seconds>(now));
-    return date;
+    const date::sys_seconds timePoint{ std::chrono::seconds(unixTimestamp) };
+    return date::format("%F %T", timePoint);
 }
 
 int VoidPointerToInt(void* value)